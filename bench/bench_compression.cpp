@@ -0,0 +1,88 @@
+// Reading compressed responses: the plain body, against a gzip body decoded
+// a chunk at a time while the reader parses it (what get_req does), and a
+// gzip body decoded whole before parsing. Given a server, also the bytes a
+// client reads with and without compression.
+//
+//   bench_compression [server_url username password]
+
+#include "common.h"
+#include "content_coding.h"
+#include "json_reader.h"
+#include "uboat/uboat.h"
+#include <cstdio>
+#include <zlib.h>
+
+using namespace uboat;
+
+namespace {
+
+constexpr int ITERATIONS = 10;
+
+std::string gzip(const std::string &body) {
+    z_stream stream{};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8,
+                 Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, body.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(body.data()));
+    stream.avail_in = static_cast<uInt>(body.size());
+    stream.next_out = reinterpret_cast<Bytef *>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+template <class Data>
+void compare(const std::string &name, const std::string &body,
+             const char *key) {
+    detail::Body compressed{gzip(body), detail::ContentCoding::Gzip};
+    std::printf("%s, %zu KiB, %zu KiB gzip\n", name.c_str(),
+                body.size() / 1024, compressed.bytes.size() / 1024);
+
+    bench::print("  plain body", bench::measure(ITERATIONS, [&] {
+                     detail::read_response<Data>(body, key).value();
+                 }));
+    bench::print("  gzip, decoded while parsing",
+                 bench::measure(ITERATIONS, [&] {
+                     detail::read_response<Data>(compressed, key).value();
+                 }));
+    bench::print("  gzip, decoded whole", bench::measure(ITERATIONS, [&] {
+                     auto decoded = detail::decode(compressed).value();
+                     detail::read_response<Data>(decoded, key).value();
+                 }));
+}
+
+void transfer(const char *name, const OSClient &client) {
+    for (int i = 0; i < ITERATIONS; ++i) {
+        client.getArtists();
+        client.getAlbumList2("alphabeticalByName", "500");
+    }
+    auto stats = client.request_stats();
+    std::printf("  %-28s %10zu wire bytes %10zu decoded bytes\n", name,
+                stats.total.wire_bytes, stats.total.decoded_bytes);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    bench::print_header();
+
+    compare<artist::Artists>("getArtists, 20000 artists",
+                             bench::artists_response(20000), "artists");
+    compare<search::SearchResult3>(
+        "search3, 1000 artists, 2000 albums, 20000 songs",
+        bench::search3_response(1000, 2000, 20000), "searchResult3");
+    compare<playlist::PlaylistWithSongs>("getPlaylist, 10000 songs",
+                                         bench::playlist_response(10000),
+                                         "playlist");
+
+    if (argc == 4) {
+        std::printf("\n%s, getArtists and getAlbumList2 x %d\n", argv[1],
+                    ITERATIONS);
+        transfer("compression",
+                 OSClient(argv[1], argv[2], argv[3], "bench"));
+        transfer("no compression", OSClient(argv[1], argv[2], argv[3], "bench",
+                                            {.compression = false}));
+    }
+}
@@ -0,0 +1,125 @@
+// Per-song cost of from_json(const json &, media::Child &): the former
+// set_if_contains version, with a lookup per field, against the field table
+// walking the members once.
+
+#include "common.h"
+#include "uboat/uboat.h"
+#include <cstdio>
+#include <nlohmann/json.hpp>
+
+using namespace uboat;
+using json = nlohmann::json;
+
+namespace legacy {
+
+void set_if_contains(const json &j, const std::string &key, auto &v) {
+    if (j.contains(key))
+        j.at(key).get_to(v);
+}
+
+void parse(const json &j, misc::ReplayGain &r) {
+    set_if_contains(j, "trackGain", r.trackGain);
+    set_if_contains(j, "albumGain", r.albumGain);
+    set_if_contains(j, "trackPeak", r.trackPeak);
+    set_if_contains(j, "albumPeak", r.albumPeak);
+    set_if_contains(j, "baseGain", r.baseGain);
+    set_if_contains(j, "fallbackGain", r.fallbackGain);
+}
+
+void parse(const json &j, artist::ArtistID3 &a) {
+    j.at("id").get_to(a.id);
+    j.at("name").get_to(a.name);
+    set_if_contains(j, "coverArt", a.coverArt);
+    set_if_contains(j, "artistImageUrl", a.artistImageUrl);
+    set_if_contains(j, "albumCount", a.albumCount);
+    set_if_contains(j, "userRating", a.userRating);
+    set_if_contains(j, "starred", a.starred);
+    set_if_contains(j, "musicBrainzId", a.musicBrainzId);
+    set_if_contains(j, "sortName", a.sortName);
+    set_if_contains(j, "roles", a.roles);
+}
+
+void parse(const json &j, std::vector<artist::ArtistID3> &v) {
+    for (auto &e : j)
+        parse(e, v.emplace_back());
+}
+
+void parse(const json &j, media::Child &c) {
+    j.at("id").get_to(c.id);
+    set_if_contains(j, "parent", c.parent);
+    j.at("isDir").get_to(c.isDir);
+    j.at("title").get_to(c.title);
+    set_if_contains(j, "album", c.album);
+    set_if_contains(j, "artist", c.artist);
+    set_if_contains(j, "track", c.track);
+    set_if_contains(j, "year", c.year);
+    set_if_contains(j, "genre", c.genre);
+    set_if_contains(j, "coverArt", c.coverArt);
+    set_if_contains(j, "size", c.size);
+    set_if_contains(j, "contentType", c.contentType);
+    set_if_contains(j, "suffix", c.suffix);
+    set_if_contains(j, "transcodedContentType", c.transcodedContentType);
+    set_if_contains(j, "transcodedSuffix", c.transcodedSuffix);
+    set_if_contains(j, "duration", c.duration);
+    set_if_contains(j, "bitRate", c.bitRate);
+    set_if_contains(j, "bitDepth", c.bitDepth);
+    set_if_contains(j, "samplingRate", c.samplingRate);
+    set_if_contains(j, "channelCount", c.channelCount);
+    set_if_contains(j, "path", c.path);
+    set_if_contains(j, "isVideo", c.isVideo);
+    set_if_contains(j, "userRating", c.userRating);
+    set_if_contains(j, "averageRating", c.averageRating);
+    set_if_contains(j, "playCount", c.playCount);
+    set_if_contains(j, "discNumber", c.discNumber);
+    set_if_contains(j, "created", c.created);
+    set_if_contains(j, "starred", c.starred);
+    set_if_contains(j, "albumId", c.albumId);
+    set_if_contains(j, "artistId", c.artistId);
+    set_if_contains(j, "type", c.type);
+    set_if_contains(j, "mediaType", c.mediaType);
+    set_if_contains(j, "bookmarkPosition", c.bookmarkPosition);
+    set_if_contains(j, "originalWidth", c.originalWidth);
+    set_if_contains(j, "originalHeight", c.originalHeight);
+    set_if_contains(j, "played", c.played);
+    set_if_contains(j, "bpm", c.bpm);
+    set_if_contains(j, "comment", c.comment);
+    set_if_contains(j, "sortName", c.sortName);
+    set_if_contains(j, "musicBrainzId", c.musicBrainzId);
+    set_if_contains(j, "genres", c.genres);
+    if (j.contains("artists"))
+        parse(j.at("artists"), c.artists);
+    set_if_contains(j, "displayArtist", c.displayArtist);
+    if (j.contains("albumArtists"))
+        parse(j.at("albumArtists"), c.albumArtists);
+    set_if_contains(j, "displayAlbumArtist", c.displayAlbumArtist);
+    if (j.contains("replayGain"))
+        parse(j.at("replayGain"), c.replayGain);
+}
+
+} // namespace legacy
+
+int main() {
+    constexpr std::size_t SONGS = 20000;
+    constexpr int ITERATIONS = 10;
+
+    auto songs = json::parse(bench::search3_response(0, 0, SONGS))
+        ["subsonic-response"]["searchResult3"]["song"];
+
+    auto print = [](const char *name, const bench::Result &r) {
+        std::printf("%-24s %10.0f ns %8zu allocations %8zu bytes\n", name,
+                    r.ms * 1e6 / SONGS, r.heap.allocations / SONGS,
+                    r.heap.bytes / SONGS);
+    };
+
+    std::printf("from_json of %zu songs, per song\n", SONGS);
+    print("set_if_contains", bench::measure(ITERATIONS, [&] {
+              std::vector<media::Child> v(SONGS);
+              for (std::size_t i = 0; i < SONGS; ++i)
+                  legacy::parse(songs[i], v[i]);
+          }));
+    print("field table", bench::measure(ITERATIONS, [&] {
+              std::vector<media::Child> v(SONGS);
+              for (std::size_t i = 0; i < SONGS; ++i)
+                  from_json(songs[i], v[i]);
+          }));
+}
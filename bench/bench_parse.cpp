@@ -0,0 +1,83 @@
+// Parsing of large responses: nlohmann::json document + from_json, against
+// the streaming reader filling the models directly (with the backend chosen
+// by UBOAT_USE_SIMDJSON), and filling the view models.
+
+#include "common.h"
+#include "json_reader.h"
+#include "string_arena.h"
+#include <cstdio>
+#include <nlohmann/json.hpp>
+#include <type_traits>
+
+using namespace uboat;
+using json = nlohmann::json;
+
+namespace {
+
+constexpr int ITERATIONS = 10;
+
+// what get_req did before the streaming reader
+template <class Data> Data parse_dom(const std::string &body, const char *key) {
+    json j = json::parse(body);
+    return j["subsonic-response"][key].template get<Data>();
+}
+
+template <class Data> Data parse_sax(const std::string &body, const char *key) {
+    return detail::read_response<Data>(body, key).value().data;
+}
+
+// what the View endpoints do, the strings go to one arena
+template <class View>
+void parse_view(const std::string &body, const char *key) {
+    detail::StringArena strings;
+    detail::read_response<View>(body, key, detail::ReadContext{&strings})
+        .value();
+}
+
+// \param count number of items in the parsed data, to check both agree
+// \tparam View the view model of Data, if any
+template <class Data, class View = void, class Count>
+void compare(const std::string &name, const std::string &body, const char *key,
+             Count count) {
+    std::printf("%s, %zu KiB\n", name.c_str(), body.size() / 1024);
+    if (count(parse_dom<Data>(body, key)) != count(parse_sax<Data>(body, key)))
+        std::printf("  results differ!\n");
+
+    bench::print("  json document + from_json", bench::measure(ITERATIONS, [&] {
+                     parse_dom<Data>(body, key);
+                 }));
+    bench::print("  streaming reader", bench::measure(ITERATIONS, [&] {
+                     parse_sax<Data>(body, key);
+                 }));
+    if constexpr (!std::is_void_v<View>)
+        bench::print("  streaming reader, views",
+                     bench::measure(ITERATIONS,
+                                    [&] { parse_view<View>(body, key); }));
+}
+
+} // namespace
+
+int main() {
+    bench::print_header();
+
+    compare<artist::Artists>("getArtists, 20000 artists",
+                             bench::artists_response(20000), "artists",
+                             [](const artist::Artists &a) {
+                                 std::size_t n = 0;
+                                 for (auto &i : a.index)
+                                     n += i.artist.size();
+                                 return n;
+                             });
+
+    compare<album::AlbumList2, album::AlbumList2View>(
+        "getAlbumList2, 500 albums", bench::album_list2_response(500),
+        "albumList2",
+        [](const album::AlbumList2 &a) { return a.album.size(); });
+
+    compare<search::SearchResult3, search::SearchResult3View>(
+        "search3, 1000 artists, 2000 albums, 20000 songs",
+        bench::search3_response(1000, 2000, 20000), "searchResult3",
+        [](const search::SearchResult3 &s) {
+            return s.artist.size() + s.album.size() + s.song.size();
+        });
+}
@@ -0,0 +1,116 @@
+// Decoding a large playlist and artist index into the models, then freeing
+// them: the models with one allocation per string and vector, against the
+// pmr models in a monotonic arena released at once. The arena never reuses
+// the storage of the vectors grown while reading, so it takes about twice
+// the bytes. Given a server, also the whole request, where the transfer
+// adds the same time to both.
+//
+//   bench_pmr [server_url username password]
+
+#include "common.h"
+#include "json_reader.h"
+#include "uboat/uboat.h"
+#include <cstdio>
+#include <memory_resource>
+#include <vector>
+
+using namespace uboat;
+
+namespace {
+
+constexpr int ITERATIONS = 10;
+
+void run(std::size_t songs) {
+    auto body = bench::playlist_response(songs);
+    std::printf("getPlaylist, %zu songs, %zu KiB\n", songs, body.size() / 1024);
+
+    using Playlist = playlist::PlaylistWithSongs;
+    bench::print("  std models", bench::measure(ITERATIONS, [&] {
+                     auto r = detail::read_response<Playlist>(body, "playlist");
+                     if (r.value().data.entry.size() != songs)
+                         std::printf("  wrong song count!\n");
+                 }));
+
+    bench::print("  pmr models, monotonic arena",
+                 bench::measure(ITERATIONS, [&] {
+                     std::pmr::monotonic_buffer_resource arena;
+                     auto r = detail::read_response<pmr::PlaylistWithSongs>(
+                         body, "playlist",
+                         detail::ReadContext{.resource = &arena});
+                     if (r.value().data.entry.size() != songs)
+                         std::printf("  wrong song count!\n");
+                 }));
+
+    // a buffer kept for the next responses, as a batch job would, the
+    // arena only allocates once it is full
+    std::vector<std::byte> buffer(body.size() * 4);
+    bench::print("  pmr models, reused buffer",
+                 bench::measure(ITERATIONS, [&] {
+                     std::pmr::monotonic_buffer_resource arena(buffer.data(),
+                                                               buffer.size());
+                     auto r = detail::read_response<pmr::PlaylistWithSongs>(
+                         body, "playlist",
+                         detail::ReadContext{.resource = &arena});
+                     if (r.value().data.entry.size() != songs)
+                         std::printf("  wrong song count!\n");
+                 }));
+}
+
+void run_artists(std::size_t artists) {
+    auto body = bench::artists_response(artists);
+    std::printf("getArtists, %zu artists, %zu KiB\n", artists,
+                body.size() / 1024);
+
+    bench::print("  std models", bench::measure(ITERATIONS, [&] {
+                     detail::read_response<artist::Artists>(body, "artists")
+                         .value();
+                 }));
+    bench::print("  pmr models, monotonic arena",
+                 bench::measure(ITERATIONS, [&] {
+                     std::pmr::monotonic_buffer_resource arena;
+                     detail::read_response<pmr::Artists>(
+                         body, "artists",
+                         detail::ReadContext{.resource = &arena})
+                         .value();
+                 }));
+}
+
+void requests(const OSClient &client) {
+    bench::print("  getArtists, std models", bench::measure(ITERATIONS, [&] {
+                     client.getArtists().value();
+                 }));
+    bench::print("  getArtists, pmr models", bench::measure(ITERATIONS, [&] {
+                     std::pmr::monotonic_buffer_resource arena;
+                     client.getArtists(&arena).value();
+                 }));
+    bench::print("  getAlbumList2 500, std models",
+                 bench::measure(ITERATIONS, [&] {
+                     client.getAlbumList2("alphabeticalByName", "500").value();
+                 }));
+    bench::print("  getAlbumList2 500, pmr models",
+                 bench::measure(ITERATIONS, [&] {
+                     std::pmr::monotonic_buffer_resource arena;
+                     client.getAlbumList2(&arena, "alphabeticalByName", "500")
+                         .value();
+                 }));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    bench::print_header();
+    run(1000);
+    run(10000);
+    run(50000);
+    run_artists(20000);
+
+    if (argc == 4) {
+        std::printf("\n%s, whole requests\n", argv[1]);
+        OSClient client(argv[1], argv[2], argv[3], "bench");
+        if (!client.authenticate()) {
+            std::printf("  could not authenticate\n");
+            return 1;
+        }
+        requests(client);
+    }
+}
@@ -0,0 +1,113 @@
+// Building the url of a request: the former way, encoding the auth params
+// again for each request and concatenating temporaries, the empty params
+// included, against the auth params encoded once and the endpoint params
+// with a value appended to a buffer reused by the thread. Each run builds
+// REQUESTS urls.
+
+#include "common.h"
+#include "request_query.h"
+#include "uboat/uboat.h"
+#include <cctype>
+#include <cstdio>
+#include <map>
+#include <string>
+
+using namespace uboat;
+
+namespace {
+
+constexpr int ITERATIONS = 10;
+constexpr int REQUESTS = 10000;
+
+using Params = std::multimap<std::string, std::string>;
+
+const std::string SERVER_URL = "https://music.example.org/rest/";
+const std::string USERNAME = "karl";
+const std::string TOKEN = "26719a1196d2a940705a59634eb18eab";
+const std::string SALT = "c19b2d";
+const std::string CLIENT_NAME = "uboat bench";
+
+namespace legacy {
+
+std::string url_encode(const std::string &value) {
+    static constexpr char HEX[] = "0123456789ABCDEF";
+    std::string encoded;
+    encoded.reserve(value.size());
+    for (unsigned char c : value) {
+        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            encoded += static_cast<char>(c);
+        } else {
+            encoded += '%';
+            encoded += HEX[c >> 4];
+            encoded += HEX[c & 0x0F];
+        }
+    }
+    return encoded;
+}
+
+std::string request_url(const std::string &endpoint, const Params &params) {
+    std::string url = SERVER_URL + endpoint + "?u=" + url_encode(USERNAME) +
+                      "&t=" + url_encode(TOKEN) + "&s=" + url_encode(SALT) +
+                      "&v=" + url_encode(API_VERSION) +
+                      "&c=" + url_encode(CLIENT_NAME) + "&f=json";
+    for (auto const &param : params)
+        url += "&" + url_encode(param.first) + "=" + url_encode(param.second);
+    return url;
+}
+
+} // namespace legacy
+
+// what OSClient::request() does
+std::string request_url(const std::string &auth_query,
+                        const std::string &endpoint, const Params &params) {
+    thread_local std::string buffer;
+    buffer.assign(SERVER_URL);
+    buffer += endpoint;
+    buffer += '?';
+    buffer += auth_query;
+    detail::append_params(buffer, params, detail::empty_param(endpoint));
+    return buffer;
+}
+
+void compare(const char *name, const std::string &endpoint,
+             const Params &params) {
+    auto auth_query = detail::auth_query(USERNAME, TOKEN, SALT, CLIENT_NAME);
+    std::printf("%s, %d requests\n", name, REQUESTS);
+
+    std::size_t size = 0;
+    bench::print("  encoded per request", bench::measure(ITERATIONS, [&] {
+                     for (int i = 0; i < REQUESTS; ++i)
+                         size += legacy::request_url(endpoint, params).size();
+                 }));
+    bench::print("  auth params encoded once",
+                 bench::measure(ITERATIONS, [&] {
+                     for (int i = 0; i < REQUESTS; ++i)
+                         size += request_url(auth_query, endpoint, params)
+                                     .size();
+                 }));
+    if (size == 0)
+        std::printf("  no url built!\n");
+}
+
+} // namespace
+
+int main() {
+    bench::print_header();
+
+    compare("getAlbum", "getAlbum", {{"id", "3f1c9a0e2b7d4c55"}});
+    compare("getAlbumList2", "getAlbumList2",
+            {{"type", "alphabeticalByName"},
+             {"size", "500"},
+             {"offset", "1000"},
+             {"fromYear", ""},
+             {"toYear", ""},
+             {"genre", ""}});
+    compare("search3", "search3",
+            {{"query", "George Harrison"},
+             {"artistCount", "20"},
+             {"artistOffset", ""},
+             {"albumCount", "20"},
+             {"albumOffset", ""},
+             {"songCount", "20"},
+             {"songOffset", ""}});
+}
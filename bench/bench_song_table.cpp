@@ -0,0 +1,107 @@
+// Bulk queries over 100k songs: std::vector<media::Child> (row layout)
+// against SongTable (one column per field), and reading a response into
+// either.
+
+#include "common.h"
+#include "json_reader.h"
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+
+using namespace uboat;
+
+namespace {
+
+constexpr std::size_t SONGS = 100000;
+constexpr int ITERATIONS = 20;
+
+const char *const GENRES[] = {"Rock", "Jazz",       "Pop",  "Classical",
+                              "Folk", "Electronic", "Soul", "Hip-Hop"};
+
+// keeps results alive so the loops are not optimized away
+volatile std::size_t g_sink;
+
+} // namespace
+
+int main() {
+    bench::print_header();
+
+    auto body = bench::search3_response(0, 0, SONGS);
+    std::printf("search3, %zu songs, %zu KiB\n", SONGS, body.size() / 1024);
+
+    std::vector<media::Child> rows;
+    bench::print("  read into media::Child", bench::measure(1, [&] {
+                     rows = detail::read_response<search::SearchResult3>(
+                                body, "searchResult3")
+                                .value()
+                                .data.song;
+                 }));
+
+    SongTable table;
+    bench::print("  read into SongTable", bench::measure(1, [&] {
+                     table = detail::read_response<detail::SongTableData>(
+                                 body, "searchResult3")
+                                 .value()
+                                 .data.songs;
+                 }));
+
+    // spread the values the queries look at
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        rows[i].year = 1960 + i % 60;
+        rows[i].genre = GENRES[i % 8];
+        rows[i].playCount = (i * 2654435761u) % 1000;
+    }
+    table.clear();
+    for (auto &song : rows)
+        table.append(song);
+
+    std::printf("total duration\n");
+    bench::print("  rows", bench::measure(ITERATIONS, [&] {
+                     std::size_t total = 0;
+                     for (auto &song : rows)
+                         total += song.duration;
+                     g_sink = total;
+                 }));
+    bench::print("  columns", bench::measure(ITERATIONS, [&] {
+                     g_sink = table.totalDuration();
+                 }));
+
+    std::printf("filter by year, 1970-1979\n");
+    bench::print("  rows", bench::measure(ITERATIONS, [&] {
+                     std::vector<std::size_t> found;
+                     for (std::size_t i = 0; i < rows.size(); ++i)
+                         if (rows[i].year >= 1970 && rows[i].year <= 1979)
+                             found.push_back(i);
+                     g_sink = found.size();
+                 }));
+    bench::print("  columns", bench::measure(ITERATIONS, [&] {
+                     g_sink = table.filterByYear(1970, 1979).size();
+                 }));
+
+    std::printf("filter by genre\n");
+    bench::print("  rows", bench::measure(ITERATIONS, [&] {
+                     std::vector<std::size_t> found;
+                     for (std::size_t i = 0; i < rows.size(); ++i)
+                         if (rows[i].genre == "Jazz")
+                             found.push_back(i);
+                     g_sink = found.size();
+                 }));
+    bench::print("  columns", bench::measure(ITERATIONS, [&] {
+                     g_sink = table.filterByGenre("Jazz").size();
+                 }));
+
+    std::printf("sort by playCount\n");
+    bench::print("  rows", bench::measure(ITERATIONS, [&] {
+                     std::vector<std::size_t> order(rows.size());
+                     std::iota(order.begin(), order.end(), 0);
+                     std::stable_sort(order.begin(), order.end(),
+                                      [&](std::size_t a, std::size_t b) {
+                                          return rows[a].playCount >
+                                                 rows[b].playCount;
+                                      });
+                     g_sink = order.front();
+                 }));
+    bench::print("  columns", bench::measure(ITERATIONS, [&] {
+                     g_sink = table.sortByPlayCount().front();
+                 }));
+}
@@ -0,0 +1,107 @@
+// Memory of a 100k-song library held as media::Child, whose repeated fields
+// are Symbols, against the same songs with a std::string per field as the
+// models had before.
+
+#include "common.h"
+#include "json_reader.h"
+#include <cstdio>
+
+using namespace uboat;
+
+namespace plain {
+
+struct ItemGenre {
+    std::string name;
+};
+
+struct Child {
+    std::string id;
+    std::string parent;
+    bool isDir;
+    std::string title;
+    std::string album;
+    std::string artist;
+    std::size_t track;
+    std::size_t year;
+    std::string genre;
+    std::string coverArt;
+    std::size_t size;
+    std::string contentType;
+    std::string suffix;
+    std::string transcodedContentType;
+    std::string transcodedSuffix;
+    std::size_t duration;
+    std::size_t bitRate;
+    std::size_t bitDepth;
+    std::size_t samplingRate;
+    std::size_t channelCount;
+    std::string path;
+    bool isVideo;
+    std::size_t userRating;
+    std::size_t averageRating;
+    std::size_t playCount;
+    std::size_t discNumber;
+    std::string created;
+    std::string starred;
+    std::string albumId;
+    std::string artistId;
+    std::string type;
+    std::string mediaType;
+    std::size_t bookmarkPosition;
+    std::size_t originalWidth;
+    std::size_t originalHeight;
+    std::string played;
+    std::size_t bpm;
+    std::string comment;
+    std::string sortName;
+    std::string musicBrainzId;
+    std::vector<ItemGenre> genres;
+    std::vector<artist::ArtistID3> artists;
+    std::string displayArtist;
+    std::vector<artist::ArtistID3> albumArtists;
+    std::string displayAlbumArtist;
+    misc::ReplayGain replayGain;
+};
+
+struct Songs {
+    std::vector<Child> song;
+};
+
+} // namespace plain
+
+template <> struct uboat::detail::Model<plain::ItemGenre> {
+    static constexpr auto fields = name_fields<plain::ItemGenre>();
+};
+
+template <> struct uboat::detail::Model<plain::Child> {
+    static constexpr auto fields = child_fields<plain::Child>();
+};
+
+template <> struct uboat::detail::Model<plain::Songs> {
+    static constexpr auto fields = song_fields<plain::Songs>();
+};
+
+namespace {
+
+constexpr std::size_t SONGS = 100000;
+
+template <class Songs> void report(const char *name, const std::string &body) {
+    bench::reset_heap();
+    auto songs =
+        detail::read_response<Songs>(body, "searchResult3").value().data;
+    std::printf("  %-32s %10zu KiB\n", name, bench::in_use() / 1024);
+}
+
+} // namespace
+
+int main() {
+    auto body = bench::search3_response(0, 0, SONGS);
+    std::printf("%zu songs, memory in use after reading\n", SONGS);
+
+    report<plain::Songs>("std::string fields", body);
+    report<search::SearchResult3>("Symbol fields", body);
+
+    auto stats = symbol_stats();
+    std::printf("  %-32s %10zu KiB, %zu strings\n", "of which symbol table",
+                stats.bytes / 1024, stats.count);
+}
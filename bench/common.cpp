@@ -0,0 +1,225 @@
+#include "common.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+namespace {
+std::atomic<std::size_t> g_allocations{0};
+std::atomic<std::size_t> g_bytes{0};
+std::atomic<std::size_t> g_in_use{0};
+std::atomic<std::size_t> g_peak{0};
+std::atomic<std::size_t> g_base{0}; /* bytes in use at reset_heap() */
+
+void *allocate(std::size_t size, std::size_t alignment = 0) {
+    if (size == 0)
+        size = 1;
+    // aligned_alloc needs a multiple of the alignment
+    void *p = alignment == 0
+                  ? std::malloc(size)
+                  : std::aligned_alloc(alignment,
+                                       (size + alignment - 1) / alignment *
+                                           alignment);
+    if (!p)
+        throw std::bad_alloc();
+
+    auto usable = malloc_usable_size(p);
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(usable, std::memory_order_relaxed);
+    auto in_use =
+        g_in_use.fetch_add(usable, std::memory_order_relaxed) + usable;
+    auto peak = g_peak.load(std::memory_order_relaxed);
+    while (in_use > peak &&
+           !g_peak.compare_exchange_weak(peak, in_use,
+                                         std::memory_order_relaxed))
+        ;
+    return p;
+}
+
+void deallocate(void *p) {
+    if (!p)
+        return;
+    g_in_use.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+    std::free(p);
+}
+} // namespace
+
+void *operator new(std::size_t size) { return allocate(size); }
+void *operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void *p) noexcept { deallocate(p); }
+void operator delete[](void *p) noexcept { deallocate(p); }
+void operator delete(void *p, std::size_t) noexcept { deallocate(p); }
+void operator delete[](void *p, std::size_t) noexcept { deallocate(p); }
+
+// used by std::pmr::new_delete_resource()
+void *operator new(std::size_t size, std::align_val_t a) {
+    return allocate(size, static_cast<std::size_t>(a));
+}
+void *operator new[](std::size_t size, std::align_val_t a) {
+    return allocate(size, static_cast<std::size_t>(a));
+}
+void operator delete(void *p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    deallocate(p);
+}
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+    deallocate(p);
+}
+
+namespace bench {
+
+void reset_heap() {
+    g_allocations = 0;
+    g_bytes = 0;
+    g_base = g_in_use.load();
+    g_peak = g_base.load();
+}
+
+Heap heap() {
+    return Heap{g_allocations.load(), g_bytes.load(),
+                g_peak.load() - g_base.load()};
+}
+
+std::ptrdiff_t in_use() {
+    return static_cast<std::ptrdiff_t>(g_in_use.load()) -
+           static_cast<std::ptrdiff_t>(g_base.load());
+}
+
+void print_header() {
+    std::printf("%-36s %12s %14s %14s %14s\n", "", "time (ms)", "allocations",
+                "allocated (KiB)", "peak (KiB)");
+}
+
+void print(const std::string &name, const Result &r) {
+    std::printf("%-36s %12.3f %14zu %14zu %14zu\n", name.c_str(), r.ms,
+                r.heap.allocations, r.heap.bytes / 1024, r.heap.peak / 1024);
+}
+
+namespace {
+
+std::string envelope(const std::string &key, const std::string &data) {
+    return R"({"subsonic-response":{"status":"ok","version":"1.16.1",)"
+           R"("type":"navidrome","serverVersion":"0.53.0",)"
+           R"("openSubsonic":true,")" +
+           key + "\":" + data + "}}";
+}
+
+std::string artist(std::size_t i) {
+    auto id = std::to_string(i);
+    return R"({"id":"ar)" + id + R"(","name":"Artist )" + id +
+           R"(","coverArt":"ar-)" + id +
+           R"(_0","artistImageUrl":"https://example.org/artist/)" + id +
+           R"(.jpg","albumCount":)" + std::to_string(i % 12 + 1) +
+           R"(,"userRating":0,"musicBrainzId":"5a3f2b1c-0000-4000-8000-)" +
+           id + R"(","sortName":"artist )" + id +
+           R"(","roles":["artist","albumartist"]})";
+}
+
+std::string album(std::size_t i) {
+    auto id = std::to_string(i);
+    auto artist_id = std::to_string(i / 4);
+    return R"({"id":"al)" + id + R"(","name":"Album )" + id +
+           R"(","artist":"Artist )" + artist_id + R"(","artistId":"ar)" +
+           artist_id + R"(","coverArt":"al-)" + id +
+           R"(_0","songCount":12,"duration":2940,"playCount":3,)"
+           R"("created":"2024-01-18T20:17:42.471Z","year":)" +
+           std::to_string(1960 + i % 60) +
+           R"(,"genre":"Rock","genres":[{"name":"Rock"}],)"
+           R"("artists":[{"id":"ar)" +
+           artist_id + R"(","name":"Artist )" + artist_id +
+           R"("}],"displayArtist":"Artist )" + artist_id +
+           R"(","releaseTypes":["Album"],"moods":[],"sortName":"album )" + id +
+           R"(","originalReleaseDate":{},"releaseDate":{"year":2002},)"
+           R"("isCompilation":false,"discTitles":[]})";
+}
+
+std::string song(std::size_t i) {
+    auto id = std::to_string(i);
+    auto album_id = std::to_string(i / 12);
+    auto artist_id = std::to_string(i / 48);
+    return R"({"id":"s)" + id + R"(","parent":"al)" + album_id +
+           R"(","isDir":false,"title":"Song )" + id +
+           R"(","album":"Album )" + album_id + R"(","artist":"Artist )" +
+           artist_id + R"(","track":)" + std::to_string(i % 12 + 1) +
+           R"(,"year":2002,"genre":"Rock","coverArt":"mf-)" + id +
+           R"(_0","size":9453125,"contentType":"audio/flac","suffix":"flac",)"
+           R"("duration":245,"bitRate":1011,"bitDepth":16,)"
+           R"("samplingRate":44100,"channelCount":2,"path":"Artist )" +
+           artist_id + "/Album " + album_id + "/" + id +
+           R"( - Song.flac","isVideo":false,"userRating":0,)"
+           R"("playCount":7,"discNumber":1,)"
+           R"("created":"2024-01-18T20:17:42.471Z","albumId":"al)" +
+           album_id + R"(","artistId":"ar)" + artist_id +
+           R"(","type":"music","mediaType":"song","bpm":0,"comment":"",)"
+           R"("sortName":"song )" +
+           id + R"(","musicBrainzId":"","genres":[{"name":"Rock"}],)"
+           R"("artists":[{"id":"ar)" +
+           artist_id + R"(","name":"Artist )" + artist_id +
+           R"("}],"displayArtist":"Artist )" + artist_id +
+           R"(","albumArtists":[{"id":"ar)" + artist_id +
+           R"(","name":"Artist )" + artist_id +
+           R"("}],"displayAlbumArtist":"Artist )" + artist_id +
+           R"(","replayGain":{"trackGain":-6,"trackPeak":1}})";
+}
+
+template <class F> std::string list(std::size_t n, F &&item) {
+    std::string s = "[";
+    for (std::size_t i = 0; i < n; ++i) {
+        if (i > 0)
+            s += ',';
+        s += item(i);
+    }
+    return s + "]";
+}
+
+} // namespace
+
+std::string artists_response(std::size_t artists) {
+    // indexed by the first letter, like servers do
+    std::string index = "[";
+    std::size_t per_index = (artists + 25) / 26;
+    for (std::size_t first = 0, letter = 0; first < artists; ++letter) {
+        auto n = std::min(per_index, artists - first);
+        if (letter > 0)
+            index += ',';
+        index += R"({"name":")" + std::string(1, char('A' + letter)) +
+                 R"(","artist":)" +
+                 list(n, [first](std::size_t i) { return artist(first + i); }) +
+                 "}";
+        first += n;
+    }
+    index += "]";
+    return envelope("artists",
+                    R"({"ignoredArticles":"The El La Los Las Le Les",)"
+                    R"("index":)" +
+                        index + "}");
+}
+
+std::string search3_response(std::size_t artists, std::size_t albums,
+                             std::size_t songs) {
+    return envelope("searchResult3",
+                    R"({"artist":)" + list(artists, artist) +
+                        R"(,"album":)" + list(albums, album) +
+                        R"(,"song":)" + list(songs, song) + "}");
+}
+
+std::string album_list2_response(std::size_t albums) {
+    return envelope("albumList2", R"({"album":)" + list(albums, album) + "}");
+}
+
+std::string playlist_response(std::size_t songs) {
+    return envelope("playlist",
+                    R"({"id":"pl1","name":"Everything","comment":"",)"
+                    R"("owner":"karl","public":true,"songCount":)" +
+                        std::to_string(songs) +
+                        R"(,"duration":)" + std::to_string(songs * 245) +
+                        R"(,"created":"2024-01-18T20:17:42.471Z",)"
+                        R"("changed":"2024-01-18T20:17:42.471Z",)"
+                        R"("coverArt":"pl-pl1_0","allowedUser":[],"entry":)" +
+                        list(songs, song) + "}");
+}
+
+} // namespace bench
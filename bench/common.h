@@ -0,0 +1,55 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace bench {
+
+/// heap usage counted by the replaced operator new and delete
+struct Heap {
+    std::size_t allocations; /* number of allocations */
+    std::size_t bytes;       /* bytes allocated */
+    std::size_t peak;        /* max bytes in use at once */
+};
+
+/// reset the counters, the peak starts from the bytes in use now
+void reset_heap();
+Heap heap();
+/// bytes in use now, more or less than at reset_heap()
+std::ptrdiff_t in_use();
+
+struct Result {
+    double ms;       /* mean time of one run */
+    Heap heap;       /* mean allocations of one run, and the overall peak */
+};
+
+/// run fn iterations times
+template <class F> Result measure(int iterations, F &&fn) {
+    reset_heap();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        fn();
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    auto h = heap();
+    return Result{elapsed.count() / iterations,
+                  Heap{h.allocations / iterations, h.bytes / iterations,
+                       h.peak}};
+}
+
+void print_header();
+void print(const std::string &name, const Result &r);
+
+/// synthetic response bodies, shaped like the ones of Navidrome
+std::string artists_response(std::size_t artists);
+std::string search3_response(std::size_t artists, std::size_t albums,
+                             std::size_t songs);
+std::string album_list2_response(std::size_t albums);
+std::string playlist_response(std::size_t songs);
+
+} // namespace bench
+
+#endif /* BENCH_COMMON_H */
@@ -0,0 +1,79 @@
+//===-- uboat/album_pages.h - paged album list -----------------*- C++-*---===//
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+//===-----------------------------------------------------------------------------===//
+///
+/// \album_pages.h
+/// This file contains the declaration of the AlbumPages class, an input
+/// range over a whole album list of the server, fetched page by page with
+/// getAlbumList2 while it is read.
+///
+//===----------------------------------------------------------------------------===//
+//
+
+#ifndef UBOAT_ALBUM_PAGES_H
+#define UBOAT_ALBUM_PAGES_H
+
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <string>
+
+#include "uboat/paged_range.h"
+#include "uboat/uboat.h"
+
+namespace uboat {
+
+/// Options of an AlbumPages range
+struct AlbumPagesOptions {
+    /// the list type, see OSClient::getAlbumList2()
+    std::string type = "alphabeticalByName";
+    /// albums per request, at most 500
+    std::size_t page_size = 500;
+    /// pages requested ahead of the one being read, 0 to request each page
+    /// only once the previous one is read
+    std::size_t prefetch = 1;
+    std::string fromYear;
+    std::string toYear;
+    std::string genre;
+};
+
+/// The albums of an album list, as an input range. The first page is
+/// requested by begin(), the next ones in the background while the current
+/// one is read, so the network latency overlaps with the processing. A
+/// failed request ends the range early, see error().
+///
+///     uboat::AlbumPages albums(client);
+///     for (const uboat::album::AlbumID3 &album : albums)
+///         ...
+class AlbumPages {
+    using Range = detail::PagedRange<album::AlbumID3, album::AlbumList2>;
+
+public:
+    static constexpr std::size_t MAX_PAGE_SIZE = 500;
+
+    using iterator = Range::iterator;
+
+    /// \param client must outlive the range
+    explicit AlbumPages(const OSClient &client, AlbumPagesOptions options = {});
+    AlbumPages(AlbumPages &&) = default;
+    AlbumPages &operator=(AlbumPages &&) = default;
+
+    /// the iterator at the current album, only the first call requests
+    /// anything
+    iterator begin() { return m_range.begin(); }
+    std::default_sentinel_t end() const { return {}; }
+
+    /// the error of the request which ended the range, if any
+    const std::optional<server::Error> &error() const {
+        return m_range.error();
+    }
+
+private:
+    Range m_range;
+};
+
+} // namespace uboat
+
+#endif /* UBOAT_ALBUM_PAGES_H */
@@ -0,0 +1,113 @@
+//===-- uboat/crawler.h - library snapshot crawler -------------*- C++-*---===//
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+//===-----------------------------------------------------------------------------===//
+///
+/// \crawler.h
+/// This file contains the declaration of the Crawler class, which copies
+/// the artists, albums and songs of a server into a Snapshot, fetching the
+/// albums in parallel.
+///
+//===----------------------------------------------------------------------------===//
+//
+
+#ifndef UBOAT_CRAWLER_H
+#define UBOAT_CRAWLER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "uboat/uboat.h"
+
+namespace uboat {
+
+/// A local copy of the library
+struct Snapshot {
+    std::vector<artist::ArtistID3> artists;
+    /// the albums with their songs, in the order of the album list. Albums
+    /// added by a LibrarySync come last.
+    std::vector<album::AlbumID3WithSongs> albums;
+    /// ids of the albums listed but not fetched, because their request failed
+    /// or the crawl was stopped
+    std::vector<std::string> missing;
+    /// the whole album list was read and every album fetched
+    bool complete;
+    /// when the library last changed before the copy, as getIndexes reports
+    /// it (ms since the epoch). 0 if unknown or the copy is not complete.
+    std::int64_t lastModified;
+};
+
+/// Counters of a crawl
+struct CrawlProgress {
+    std::size_t listed;      /* albums found in the album list so far */
+    std::size_t fetched;     /* albums fetched with getAlbum */
+    std::size_t resumed;     /* albums read from the checkpoint instead */
+    std::size_t failed;      /* getAlbum requests which failed */
+    std::size_t concurrency; /* getAlbum requests currently allowed at once */
+};
+
+/// Options of a Crawler
+struct CrawlerOptions {
+    /// bounds of the getAlbum requests in flight, between which the crawler
+    /// adapts their number to the latency of the server
+    std::size_t min_concurrency = 1;
+    std::size_t max_concurrency = 16;
+    /// the concurrency is halved when a request takes longer than this, and
+    /// grows while they take less
+    std::chrono::milliseconds target_latency{1000};
+    /// albums per getAlbumList2 request, and requests made ahead
+    std::size_t page_size = 500;
+    std::size_t prefetch = 1;
+    /// file recording the fetched albums, so an interrupted crawl resumes
+    /// where it stopped. It is removed once a crawl is complete. Empty for
+    /// none.
+    std::filesystem::path checkpoint;
+    /// called after each album, one call at a time, from the threads of the
+    /// crawler
+    std::function<void(const CrawlProgress &)> on_progress;
+};
+
+/// Copies the library of a server: getArtists, then the albums of the
+/// "alphabeticalByName" album list, fetched with getAlbum on a pool of
+/// threads while the list is still being read. The requests are made with
+/// the asynchronous endpoints, which the response cache never answers.
+///
+///     uboat::Crawler crawler(client, {.checkpoint = "crawl.checkpoint"});
+///     auto snapshot = crawler.run();
+class Crawler {
+public:
+    /// \param client must outlive the crawler
+    explicit Crawler(const OSClient &client, CrawlerOptions options = {});
+
+    /// crawl the library
+    /// \return the snapshot, possibly incomplete, or the error of the
+    /// getArtists or getAlbumList2 request ending the crawl
+    std::expected<Snapshot, server::Error> run();
+
+    /// make run() return soon, with the albums fetched so far. Can be called
+    /// from any thread.
+    void stop() { m_stopped = true; }
+
+    CrawlProgress progress() const;
+
+private:
+    const OSClient *m_client;
+    CrawlerOptions m_options;
+    std::atomic<bool> m_stopped = false;
+
+    mutable std::mutex m_mutex;
+    CrawlProgress m_progress{};
+};
+
+} // namespace uboat
+
+#endif /* UBOAT_CRAWLER_H */
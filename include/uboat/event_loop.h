@@ -0,0 +1,97 @@
+//===-- uboat/event_loop.h - curl multi event loop ------------*- C++-*---===//
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+//===-----------------------------------------------------------------------------===//
+///
+/// \event_loop.h
+/// This file contains the declaration of the EventLoop class which drives
+/// the asynchronous requests of OSClient. All transfers of a loop share one
+/// curl multi handle, so hundreds of requests can be in flight on a single
+/// thread.
+///
+//===----------------------------------------------------------------------------===//
+//
+
+#ifndef UBOAT_EVENT_LOOP_H
+#define UBOAT_EVENT_LOOP_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace uboat {
+
+/// Result of one HTTP transfer
+struct TransferResult {
+    long status_code;     /* HTTP status, 0 if no response was received */
+    std::string body;     /* response body, as received */
+    std::string error;    /* transport error message, empty on success */
+    std::string encoding; /* Content-Encoding of body, empty if none */
+};
+
+/// An event loop running HTTP transfers on a curl multi handle.
+///
+/// A loop either owns a worker thread, started on the first submit(), or is
+/// driven by the caller through poll(). Completion callbacks run on the
+/// thread driving the loop and should not block. They may release the last
+/// reference to the loop, which is then freed once the poll() running them
+/// returns.
+class EventLoop {
+public:
+    using Callback = std::function<void(TransferResult)>;
+
+    /// \param own_thread run the loop on a thread owned by the loop, if false
+    /// the caller has to drive it with poll()
+    /// \param max_host_connections max number of parallel connections to one
+    /// host, further transfers wait in curl's queue
+    explicit EventLoop(bool own_thread = true,
+                       long max_host_connections = 16);
+    ~EventLoop();
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    /// Queue a GET transfer, safe to call from any thread
+    /// \param url the full request url with the query string
+    /// \param done called once with the result
+    /// \param timeout abort the transfer after this long, 0 for no timeout
+    /// \param accept_encoding value of the Accept-Encoding header, not sent
+    /// if empty. The body is not decoded, see TransferResult::encoding.
+    /// \param form if not empty, the transfer is a POST of this
+    /// application/x-www-form-urlencoded body instead
+    /// \return an id identifying the transfer
+    std::uint64_t submit(std::string url, Callback done,
+                         std::chrono::milliseconds timeout = {},
+                         std::string accept_encoding = {},
+                         std::string form = {});
+
+    /// Abort a transfer, its callback gets a "request cancelled" error.
+    /// Does nothing if the transfer already completed. Safe to call from any
+    /// thread.
+    void cancel(std::uint64_t id);
+
+    /// Run fn on the loop's thread after delay, safe to call from any thread
+    void call_after(std::chrono::milliseconds delay, std::function<void()> fn);
+
+    /// Run the loop once: start queued transfers, wait up to timeout for
+    /// network activity, complete finished transfers and run due timers.
+    /// Must only be called from one thread at a time, and not at all on a
+    /// loop owning its thread.
+    /// \return the number of completed transfers
+    std::size_t poll(std::chrono::milliseconds timeout);
+
+    /// Number of transfers submitted but not completed yet
+    std::size_t in_flight() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace uboat
+
+#endif /* UBOAT_EVENT_LOOP_H */
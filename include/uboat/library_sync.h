@@ -0,0 +1,81 @@
+//===-- uboat/library_sync.h - incremental library sync --------*- C++-*---===//
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+//===-----------------------------------------------------------------------------===//
+///
+/// \library_sync.h
+/// This file contains the declaration of the LibrarySync class, which
+/// brings a Snapshot up to date with its server, fetching only the albums
+/// added or changed since the snapshot was taken.
+///
+//===----------------------------------------------------------------------------===//
+//
+
+#ifndef UBOAT_LIBRARY_SYNC_H
+#define UBOAT_LIBRARY_SYNC_H
+
+#include <chrono>
+#include <cstddef>
+#include <expected>
+#include <string>
+#include <vector>
+
+#include "uboat/crawler.h"
+#include "uboat/uboat.h"
+
+namespace uboat {
+
+/// Changes of the albums found by a sync, as album ids
+struct SyncDiff {
+    std::vector<std::string> added;   /* albums new on the server */
+    std::vector<std::string> removed; /* albums gone from the server */
+    std::vector<std::string> updated; /* albums changed on the server */
+
+    bool empty() const {
+        return added.empty() && removed.empty() && updated.empty();
+    }
+};
+
+/// Options of a LibrarySync
+struct SyncOptions {
+    /// bounds of the getAlbum requests in flight, see CrawlerOptions
+    std::size_t min_concurrency = 1;
+    std::size_t max_concurrency = 16;
+    std::chrono::milliseconds target_latency{1000};
+    /// albums per getAlbumList2 request, and requests made ahead
+    std::size_t page_size = 500;
+    std::size_t prefetch = 1;
+};
+
+/// Keeps a Snapshot up to date. A sync first asks getIndexes whether the
+/// library changed since Snapshot::lastModified, which costs one request
+/// when it did not. Otherwise the "newest" album list is read, without the
+/// songs, and compared with the snapshot: only the albums new, or whose
+/// created, changed, song count, duration or other listed fields differ, are
+/// fetched again with getAlbum. As for Crawler, the response cache never
+/// answers the requests.
+///
+///     uboat::LibrarySync sync(client);
+///     auto diff = sync.sync(snapshot);
+class LibrarySync {
+public:
+    /// \param client must outlive the sync
+    explicit LibrarySync(const OSClient &client, SyncOptions options = {});
+
+    /// update snapshot. The albums which could not be fetched keep their old
+    /// copy, if any, and are listed in Snapshot::missing; the watermark then
+    /// stays where it was, so the next sync tries them again.
+    /// \return the changes applied, or the error of the getIndexes,
+    /// getAlbumList2 or getArtists request ending the sync, leaving snapshot
+    /// as it was
+    std::expected<SyncDiff, server::Error> sync(Snapshot &snapshot) const;
+
+private:
+    const OSClient *m_client;
+    SyncOptions m_options;
+};
+
+} // namespace uboat
+
+#endif /* UBOAT_LIBRARY_SYNC_H */
@@ -0,0 +1,158 @@
+//===-- uboat/paged_range.h - ranges fetched page by page ------*- C++-*---===//
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+//===-----------------------------------------------------------------------------===//
+///
+/// \paged_range.h
+/// This file contains the PagedRange class template, an input range over a
+/// list the server returns in pages of an offset and a size, shared by
+/// AlbumPages and SearchCursor.
+///
+//===----------------------------------------------------------------------------===//
+//
+
+#ifndef UBOAT_PAGED_RANGE_H
+#define UBOAT_PAGED_RANGE_H
+
+#include <cstddef>
+#include <deque>
+#include <expected>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "uboat/task.h"
+#include "uboat/uboat.h"
+
+namespace uboat {
+
+namespace detail {
+
+/// The items of type T of a list fetched as Result pages, as an input range.
+/// The first page is requested by begin(), the next ones ahead of the one
+/// being read. A short page ends the range, and so does a failed request,
+/// see error().
+template <class T, class Result> class PagedRange {
+public:
+    using Page = future<std::expected<Result, server::Error>>;
+    /// request the page of size items from offset
+    using Fetch = std::function<Page(std::size_t offset, std::size_t size)>;
+    /// the items of a page
+    using Extract = std::vector<T> &(*)(Result &page);
+
+    class iterator {
+    public:
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+
+        const T &operator*() const { return m_range->m_page[m_range->m_index]; }
+        const T *operator->() const { return &**this; }
+        iterator &operator++() {
+            if (++m_range->m_index == m_range->m_page.size())
+                m_range->next_page();
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+        bool operator==(std::default_sentinel_t) const {
+            return m_range->m_index >= m_range->m_page.size();
+        }
+
+    private:
+        friend class PagedRange;
+        explicit iterator(PagedRange *range) : m_range(range) {}
+
+        PagedRange *m_range = nullptr;
+    };
+
+    /// \param page_size items per request, at least 1
+    /// \param prefetch pages requested ahead of the one being read, 0 to
+    /// request each page only once the previous one is read
+    PagedRange(Fetch fetch, Extract extract, std::size_t page_size,
+               std::size_t prefetch)
+        : m_fetch(std::move(fetch)), m_extract(extract),
+          m_page_size(page_size), m_prefetch(prefetch) {}
+    PagedRange(PagedRange &&) = default;
+    PagedRange &operator=(PagedRange &&) = default;
+    ~PagedRange() { drop(); }
+
+    /// the iterator at the current item, only the first call requests
+    /// anything
+    iterator begin() {
+        if (!m_started) {
+            m_started = true;
+            next_page();
+        }
+        return iterator(this);
+    }
+    std::default_sentinel_t end() const { return {}; }
+
+    /// the error of the request which ended the range, if any
+    const std::optional<server::Error> &error() const { return m_error; }
+
+private:
+    /// request the page after the last one requested
+    void request() {
+        m_pending.push_back(m_fetch(m_offset, m_page_size));
+        m_offset += m_page_size;
+    }
+
+    /// move to the next page, waiting for it if it has not arrived yet
+    void next_page() {
+        m_page.clear();
+        m_index = 0;
+        if (m_last)
+            return;
+
+        if (m_pending.empty())
+            request();
+        auto page = std::move(m_pending.front());
+        m_pending.pop_front();
+        // the next pages are on their way while this one is read
+        while (m_pending.size() < m_prefetch)
+            request();
+
+        auto result = page.get();
+        if (!result) {
+            m_error = std::move(result.error());
+            m_last = true;
+        } else {
+            // a short page is the end of the list
+            auto &items = m_extract(*result);
+            m_last = items.size() < m_page_size;
+            m_page = std::move(items);
+        }
+        if (m_last)
+            drop();
+    }
+
+    /// cancel the pages requested past the end of the list
+    void drop() {
+        for (auto &page : m_pending)
+            page.cancel();
+        m_pending.clear();
+    }
+
+    Fetch m_fetch;
+    Extract m_extract;
+    std::size_t m_page_size;
+    std::size_t m_prefetch;
+
+    std::deque<Page> m_pending; /* requested, oldest first */
+    std::size_t m_offset = 0;   /* of the next page to request */
+    bool m_started = false;
+    bool m_last = false; /* no page after the current one */
+    std::vector<T> m_page;
+    std::size_t m_index = 0; /* of the current item in m_page */
+    std::optional<server::Error> m_error;
+};
+
+} // namespace detail
+
+} // namespace uboat
+
+#endif /* UBOAT_PAGED_RANGE_H */
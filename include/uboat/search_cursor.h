@@ -0,0 +1,107 @@
+//===-- uboat/search_cursor.h - paged search results -----------*- C++-*---===//
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+//===-----------------------------------------------------------------------------===//
+///
+/// \search_cursor.h
+/// This file contains the declaration of the SearchCursor class, the artists,
+/// albums and songs matching a search3 query as three input ranges, each
+/// fetched page by page while it is read.
+///
+//===----------------------------------------------------------------------------===//
+//
+
+#ifndef UBOAT_SEARCH_CURSOR_H
+#define UBOAT_SEARCH_CURSOR_H
+
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <string>
+
+#include "uboat/paged_range.h"
+#include "uboat/uboat.h"
+
+namespace uboat {
+
+/// Options of a SearchCursor
+struct SearchCursorOptions {
+    /// results of a kind per request
+    std::size_t page_size = 20;
+    /// pages of a kind requested ahead of the one being read, 0 to request
+    /// each page only once the previous one is read
+    std::size_t prefetch = 1;
+    std::string musicFolderId;
+};
+
+/// The results of one kind (artist::ArtistID3, album::AlbumID3 or
+/// media::Child) of a SearchCursor, as an input range. Its requests only ask
+/// search3 for this kind, with a count of 0 for the others. A failed request
+/// ends the range early, see error().
+template <class T> class SearchResults {
+    using Range = detail::PagedRange<T, search::SearchResult3>;
+
+public:
+    using iterator = typename Range::iterator;
+
+    SearchResults(const SearchResults &) = delete;
+    SearchResults &operator=(const SearchResults &) = delete;
+
+    /// the iterator at the current result, only the first call requests
+    /// anything
+    iterator begin() { return m_range.begin(); }
+    std::default_sentinel_t end() const { return {}; }
+
+    /// the error of the request which ended the range, if any
+    const std::optional<server::Error> &error() const {
+        return m_range.error();
+    }
+
+private:
+    friend class SearchCursor;
+
+    SearchResults(const OSClient &client, const std::string &query,
+                  const SearchCursorOptions &options);
+
+    Range m_range;
+};
+
+extern template class SearchResults<artist::ArtistID3>;
+extern template class SearchResults<album::AlbumID3>;
+extern template class SearchResults<media::Child>;
+
+/// A search3 query, with a separate range of results per kind, so scrolling
+/// through the songs does not fetch artists and albums again. The ranges are
+/// read independently, and their next pages are requested in the background
+/// while the current ones are read.
+///
+///     uboat::SearchCursor search(client, "harrison");
+///     for (const uboat::media::Child &song : search.songs())
+///         ...
+class SearchCursor {
+public:
+    /// \param client must outlive the cursor
+    SearchCursor(const OSClient &client, std::string query,
+                 SearchCursorOptions options = {});
+    SearchCursor(const SearchCursor &) = delete;
+    SearchCursor &operator=(const SearchCursor &) = delete;
+
+    const std::string &query() const { return m_query; }
+
+    SearchResults<artist::ArtistID3> &artists() { return m_artists; }
+    SearchResults<album::AlbumID3> &albums() { return m_albums; }
+    SearchResults<media::Child> &songs() { return m_songs; }
+
+private:
+    const std::string m_query;
+    const SearchCursorOptions m_options;
+
+    SearchResults<artist::ArtistID3> m_artists;
+    SearchResults<album::AlbumID3> m_albums;
+    SearchResults<media::Child> m_songs;
+};
+
+} // namespace uboat
+
+#endif /* UBOAT_SEARCH_CURSOR_H */
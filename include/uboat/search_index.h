@@ -0,0 +1,113 @@
+//===-- uboat/search_index.h - local search over a snapshot ----*- C++-*---===//
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+//===-----------------------------------------------------------------------------===//
+///
+/// \search_index.h
+/// This file contains the declaration of the SearchIndex class, which
+/// answers search3 queries from a Snapshot of the library, without asking
+/// the server.
+///
+//===----------------------------------------------------------------------------===//
+//
+
+#ifndef UBOAT_SEARCH_INDEX_H
+#define UBOAT_SEARCH_INDEX_H
+
+#include <chrono>
+#include <cstddef>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "uboat/crawler.h"
+#include "uboat/uboat.h"
+
+namespace uboat {
+
+namespace detail {
+class InvertedIndex;
+}
+
+/// Results of each kind a search returns, as the counts and offsets of
+/// search3
+struct SearchCounts {
+    std::size_t artistCount = 20;
+    std::size_t artistOffset = 0;
+    std::size_t albumCount = 20;
+    std::size_t albumOffset = 0;
+    std::size_t songCount = 20;
+    std::size_t songOffset = 0;
+};
+
+/// Options of a SearchIndex
+struct SearchIndexOptions {
+    /// how long the snapshot is trusted to be up to date, once the server
+    /// said so, by the search3() asking the server when it is not
+    std::chrono::milliseconds check_interval{60000};
+};
+
+/// An index of the names and sort names of the artists and albums, and of
+/// the titles and sort names of the songs of a Snapshot. A query matches the
+/// entries holding each of its words, the last ones typed possibly cut
+/// short, so it can be run at every keystroke:
+///
+///     uboat::SearchIndex index(std::move(snapshot));
+///     auto result = index.search3("goldb var");
+///
+/// Entries holding the words whole, or starting with them, rank first.
+/// Letters are only folded to lower case in ASCII.
+class SearchIndex {
+public:
+    explicit SearchIndex(Snapshot snapshot, SearchIndexOptions options = {});
+    ~SearchIndex();
+
+    SearchIndex(const SearchIndex &) = delete;
+    SearchIndex &operator=(const SearchIndex &) = delete;
+
+    /// search the snapshot. Safe to call from several threads.
+    /// \param query Search query. Returns all on empty query
+    search::SearchResult3 search3(std::string_view query,
+                                  const SearchCounts &counts = {}) const;
+
+    /// search the snapshot, unless it is out of date: then the query is sent
+    /// to the server. Whether the library changed since the snapshot is
+    /// asked to getIndexes at most once per check_interval, and a snapshot
+    /// found out of date, incomplete or without Snapshot::lastModified stays
+    /// so. When the server cannot be reached, the snapshot answers.
+    /// \param client the server of the snapshot
+    /// \return the result, or the error of the search3 request
+    std::expected<search::SearchResult3, server::Error>
+    search3(const OSClient &client, const std::string &query,
+            const SearchCounts &counts = {}) const;
+
+    /// whether the snapshot is known to be out of date
+    bool stale() const;
+
+    const Snapshot &snapshot() const { return m_snapshot; }
+
+private:
+    bool check(const OSClient &client) const;
+
+    Snapshot m_snapshot;
+    SearchIndexOptions m_options;
+    std::vector<const media::Child *> m_songs; /* of the snapshot, in order */
+
+    std::unique_ptr<detail::InvertedIndex> m_artist_index;
+    std::unique_ptr<detail::InvertedIndex> m_album_index;
+    std::unique_ptr<detail::InvertedIndex> m_song_index;
+
+    mutable std::mutex m_mutex;
+    mutable bool m_stale;
+    /// time of the last check, see search3()
+    mutable std::optional<std::chrono::steady_clock::time_point> m_checked;
+};
+
+} // namespace uboat
+
+#endif /* UBOAT_SEARCH_INDEX_H */
@@ -0,0 +1,245 @@
+//===-- uboat/song_table.h - columnar song table --------------*- C++-*---===//
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+//===-----------------------------------------------------------------------------===//
+///
+/// \song_table.h
+/// This file contains the declaration of the SongTable class, holding songs
+/// column by column instead of as media::Child structs, for bulk queries over
+/// whole playlists or libraries.
+///
+//===----------------------------------------------------------------------------===//
+//
+
+#ifndef UBOAT_SONG_TABLE_H
+#define UBOAT_SONG_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace uboat {
+
+namespace media {
+struct Child;
+} // namespace media
+
+namespace detail {
+template <class T> struct Type;
+} // namespace detail
+
+/// Strings of a column stored back to back
+class TextColumn {
+public:
+    std::size_t size() const { return m_ends.size(); }
+
+    std::string_view operator[](std::size_t row) const {
+        auto begin = row == 0 ? 0 : m_ends[row - 1];
+        return std::string_view(m_chars).substr(begin, m_ends[row] - begin);
+    }
+
+    void push_back(std::string_view s) {
+        m_chars += s;
+        m_ends.push_back(m_chars.size());
+    }
+
+    /// replace the last string
+    void set_back(std::string_view s) {
+        m_chars.resize(size() < 2 ? 0 : m_ends[size() - 2]);
+        m_chars += s;
+        m_ends.back() = m_chars.size();
+    }
+
+    /// add all strings of other
+    void append(const TextColumn &other);
+
+    void reserve(std::size_t rows) { m_ends.reserve(rows); }
+    void clear() {
+        m_chars.clear();
+        m_ends.clear();
+    }
+
+private:
+    std::string m_chars;
+    std::vector<std::size_t> m_ends; /* end of every string in m_chars */
+};
+
+/// Strings of a column with few distinct values, stored once in a
+/// dictionary and referenced by code from the rows. Code 0 is "".
+class DictionaryColumn {
+public:
+    using Code = std::uint32_t;
+
+    DictionaryColumn() { intern({}); }
+
+    DictionaryColumn(const DictionaryColumn &other);
+    DictionaryColumn &operator=(const DictionaryColumn &other);
+    DictionaryColumn(DictionaryColumn &&) = default;
+    DictionaryColumn &operator=(DictionaryColumn &&) = default;
+
+    std::size_t size() const { return m_codes.size(); }
+
+    std::string_view operator[](std::size_t row) const {
+        return *m_values[m_codes[row]];
+    }
+
+    /// code of every row
+    std::span<const Code> codes() const { return m_codes; }
+
+    /// distinct values, indexed by code
+    std::string_view value(Code code) const { return *m_values[code]; }
+    std::size_t distinct() const { return m_values.size(); }
+
+    /// \return the code of s, if a row has it
+    std::optional<Code> find(std::string_view s) const;
+
+    void push_back(std::string_view s) { m_codes.push_back(intern(s)); }
+
+    /// replace the last string
+    void set_back(std::string_view s) { m_codes.back() = intern(s); }
+
+    /// add all strings of other
+    void append(const DictionaryColumn &other);
+
+    void reserve(std::size_t rows) { m_codes.reserve(rows); }
+    void clear();
+
+private:
+    struct Hash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+
+    Code intern(std::string_view s);
+
+    std::vector<Code> m_codes;
+    std::unordered_map<std::string, Code, Hash, std::equal_to<>> m_index;
+    std::vector<const std::string *> m_values; /* keys of m_index */
+};
+
+/// Songs stored as one contiguous column per field. Scans over a field only
+/// touch that field's column, and the low-cardinality strings (genre, artist,
+/// album, ...) are dictionary encoded so filtering compares integers.
+///
+/// The table keeps the fields of media::Child used for browsing and bulk
+/// queries; the nested lists (genres, artists, replayGain) are left out.
+/// OSClient reads the songs of responses straight into the columns, see
+/// getRandomSongsTable() and friends.
+class SongTable {
+public:
+    using Row = std::uint32_t;
+
+    std::size_t size() const { return m_duration.size(); }
+    bool empty() const { return size() == 0; }
+
+    void reserve(std::size_t rows);
+    void clear();
+
+    /// add a song as the last row
+    void append(const media::Child &song);
+    /// add all rows of other
+    void append(const SongTable &other);
+
+    /// the song at row, with the fields kept by the table
+    media::Child row(std::size_t row) const;
+
+    // columns, indexed by row
+
+    const TextColumn &id() const { return m_id; }
+    const DictionaryColumn &parent() const { return m_parent; }
+    const TextColumn &title() const { return m_title; }
+    const DictionaryColumn &album() const { return m_album; }
+    const DictionaryColumn &artist() const { return m_artist; }
+    std::span<const std::uint32_t> track() const { return m_track; }
+    std::span<const std::uint32_t> year() const { return m_year; }
+    const DictionaryColumn &genre() const { return m_genre; }
+    const TextColumn &coverArt() const { return m_coverArt; }
+    /// the size field of media::Child, in bytes
+    std::span<const std::uint64_t> fileSize() const { return m_size; }
+    const DictionaryColumn &contentType() const { return m_contentType; }
+    const DictionaryColumn &suffix() const { return m_suffix; }
+    std::span<const std::uint32_t> duration() const { return m_duration; }
+    std::span<const std::uint32_t> bitRate() const { return m_bitRate; }
+    std::span<const std::uint32_t> bitDepth() const { return m_bitDepth; }
+    std::span<const std::uint32_t> samplingRate() const {
+        return m_samplingRate;
+    }
+    std::span<const std::uint32_t> channelCount() const {
+        return m_channelCount;
+    }
+    const TextColumn &path() const { return m_path; }
+    std::span<const std::uint32_t> userRating() const { return m_userRating; }
+    std::span<const std::uint32_t> playCount() const { return m_playCount; }
+    std::span<const std::uint32_t> discNumber() const { return m_discNumber; }
+    const TextColumn &created() const { return m_created; }
+    const DictionaryColumn &albumId() const { return m_albumId; }
+    const DictionaryColumn &artistId() const { return m_artistId; }
+    const DictionaryColumn &type() const { return m_type; }
+    const DictionaryColumn &mediaType() const { return m_mediaType; }
+    std::span<const std::uint32_t> bpm() const { return m_bpm; }
+    const DictionaryColumn &displayArtist() const { return m_displayArtist; }
+
+    // queries
+
+    /// sum of the durations, in seconds
+    std::uint64_t totalDuration() const;
+
+    /// \return the rows with from <= year <= to, in order
+    std::vector<Row> filterByYear(std::size_t from, std::size_t to) const;
+
+    /// \return the rows of genre, in order
+    std::vector<Row> filterByGenre(std::string_view genre) const;
+
+    /// \return all rows, most played first, rows of equal playCount in order
+    std::vector<Row> sortByPlayCount() const;
+
+private:
+    friend struct detail::Type<SongTable>;
+
+    /// add a row of empty strings and zeros
+    void push_default();
+
+    /// call f with the member pointer of every column
+    template <class F> static void for_each_column(F &&f);
+
+    TextColumn m_id;
+    DictionaryColumn m_parent;
+    TextColumn m_title;
+    DictionaryColumn m_album;
+    DictionaryColumn m_artist;
+    std::vector<std::uint32_t> m_track;
+    std::vector<std::uint32_t> m_year;
+    DictionaryColumn m_genre;
+    TextColumn m_coverArt;
+    std::vector<std::uint64_t> m_size;
+    DictionaryColumn m_contentType;
+    DictionaryColumn m_suffix;
+    std::vector<std::uint32_t> m_duration;
+    std::vector<std::uint32_t> m_bitRate;
+    std::vector<std::uint32_t> m_bitDepth;
+    std::vector<std::uint32_t> m_samplingRate;
+    std::vector<std::uint32_t> m_channelCount;
+    TextColumn m_path;
+    std::vector<std::uint32_t> m_userRating;
+    std::vector<std::uint32_t> m_playCount;
+    std::vector<std::uint32_t> m_discNumber;
+    TextColumn m_created;
+    DictionaryColumn m_albumId;
+    DictionaryColumn m_artistId;
+    DictionaryColumn m_type;
+    DictionaryColumn m_mediaType;
+    std::vector<std::uint32_t> m_bpm;
+    DictionaryColumn m_displayArtist;
+};
+
+} // namespace uboat
+
+#endif /* UBOAT_SONG_TABLE_H */
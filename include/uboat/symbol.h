@@ -0,0 +1,81 @@
+//===-- uboat/symbol.h - interned strings ----------------------*- C++-*---===//
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+//===-----------------------------------------------------------------------------===//
+///
+/// \symbol.h
+/// This file contains the declaration of the Symbol class, an interned
+/// string used by the models for the values repeated all over a library
+/// (genres, artist and album names, content types, ...).
+///
+//===----------------------------------------------------------------------------===//
+//
+
+#ifndef UBOAT_SYMBOL_H
+#define UBOAT_SYMBOL_H
+
+#include <compare>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+namespace uboat {
+
+/// An immutable string stored once per process: equal symbols share one copy
+/// in a global, thread-safe table, and a symbol itself is one pointer.
+/// Symbols are never freed, so they are meant for values with few distinct
+/// strings, not for ids or titles.
+class Symbol {
+public:
+    /// the empty string
+    Symbol() = default;
+    explicit Symbol(std::string_view s);
+
+    Symbol &operator=(std::string_view s) { return *this = Symbol(s); }
+
+    const std::string &str() const { return m_value ? *m_value : EMPTY; }
+    operator const std::string &() const { return str(); }
+    operator std::string_view() const { return str(); }
+
+    const char *c_str() const { return str().c_str(); }
+    const char *data() const { return str().data(); }
+    std::size_t size() const { return str().size(); }
+    bool empty() const { return m_value == nullptr; }
+
+    /// equal symbols are the same string, compared by address
+    friend bool operator==(const Symbol &a, const Symbol &b) {
+        return a.m_value == b.m_value;
+    }
+    friend bool operator==(const Symbol &a, std::string_view b) {
+        return a.str() == b;
+    }
+    friend std::strong_ordering operator<=>(const Symbol &a,
+                                            const Symbol &b) {
+        return a.str() <=> b.str();
+    }
+    friend std::strong_ordering operator<=>(const Symbol &a,
+                                            std::string_view b) {
+        return std::string_view(a.str()) <=> b;
+    }
+
+private:
+    static inline const std::string EMPTY;
+
+    const std::string *m_value = nullptr; /* in the table, null for "" */
+};
+
+std::ostream &operator<<(std::ostream &os, const Symbol &s);
+
+/// Size of the symbol table
+struct SymbolStats {
+    std::size_t count; /* distinct strings */
+    std::size_t bytes; /* heap used by the table and the strings */
+};
+
+SymbolStats symbol_stats();
+
+} // namespace uboat
+
+#endif /* UBOAT_SYMBOL_H */
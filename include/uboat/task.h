@@ -0,0 +1,359 @@
+//===-- uboat/task.h - awaitable futures and coroutine tasks --*- C++-*---===//
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+//===-----------------------------------------------------------------------------===//
+///
+/// \task.h
+/// This file contains uboat::future, the result of the asynchronous OSClient
+/// endpoints, which can be waited for like a std::future or co_await-ed, and
+/// uboat::task, a lazily started coroutine.
+///
+/// Coroutines awaiting a future are resumed on the thread driving the
+/// client's EventLoop. Cancelling a task (directly or through a timeout)
+/// cancels the requests it is awaiting, and the tasks it is awaiting.
+///
+//===----------------------------------------------------------------------------===//
+//
+
+#ifndef UBOAT_TASK_H
+#define UBOAT_TASK_H
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <utility>
+
+#include "uboat/event_loop.h"
+
+namespace uboat {
+
+template <class T> class task;
+
+namespace detail {
+
+/// shared state between a future and the producer of its value
+template <class T> class future_state {
+public:
+    void set_value(T value) {
+        std::coroutine_handle<> waiter;
+        {
+            std::lock_guard lock(m_mutex);
+            m_value.emplace(std::move(value));
+            waiter = std::exchange(m_waiter, {});
+            m_canceller = nullptr;
+        }
+        m_ready.notify_all();
+        if (waiter)
+            waiter.resume();
+    }
+
+    /// how to cancel the producer, dropped once the value is set
+    void set_canceller(std::function<void()> canceller) {
+        std::lock_guard lock(m_mutex);
+        if (!m_value)
+            m_canceller = std::move(canceller);
+    }
+
+    void cancel() {
+        std::function<void()> canceller;
+        {
+            std::lock_guard lock(m_mutex);
+            canceller = std::move(m_canceller);
+        }
+        if (canceller)
+            canceller();
+    }
+
+    bool ready() {
+        std::lock_guard lock(m_mutex);
+        return m_value.has_value();
+    }
+
+    void wait() {
+        std::unique_lock lock(m_mutex);
+        m_ready.wait(lock, [this] { return m_value.has_value(); });
+    }
+
+    template <class Rep, class Period>
+    bool wait_for(const std::chrono::duration<Rep, Period> &timeout) {
+        std::unique_lock lock(m_mutex);
+        return m_ready.wait_for(lock, timeout,
+                                [this] { return m_value.has_value(); });
+    }
+
+    /// register a coroutine to resume once the value is set
+    /// \return false if the value is already there
+    bool suspend(std::coroutine_handle<> waiter) {
+        std::lock_guard lock(m_mutex);
+        if (m_value)
+            return false;
+        m_waiter = waiter;
+        return true;
+    }
+
+    T take() {
+        std::lock_guard lock(m_mutex);
+        return std::move(*m_value);
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+    std::optional<T> m_value;
+    std::coroutine_handle<> m_waiter;
+    std::function<void()> m_canceller;
+};
+
+/// stop token of the task awaiting something, if the awaiter is a task
+template <class Promise>
+std::stop_token stop_token_of(std::coroutine_handle<Promise> h) {
+    if constexpr (requires { h.promise().stop_token(); })
+        return h.promise().stop_token();
+    else
+        return {};
+}
+
+} // namespace detail
+
+/// The result of an asynchronous request. Use it like a std::future, or
+/// co_await it from a coroutine.
+template <class T> class future {
+public:
+    future() = default;
+    explicit future(std::shared_ptr<detail::future_state<T>> state)
+        : m_state(std::move(state)) {}
+
+    bool valid() const { return m_state != nullptr; }
+
+    /// block until the value is available
+    void wait() const { m_state->wait(); }
+
+    template <class Rep, class Period>
+    std::future_status
+    wait_for(const std::chrono::duration<Rep, Period> &timeout) const {
+        return m_state->wait_for(timeout) ? std::future_status::ready
+                                          : std::future_status::timeout;
+    }
+
+    /// block until the value is available and take it
+    T get() {
+        m_state->wait();
+        auto state = std::move(m_state);
+        return state->take();
+    }
+
+    /// abort the request, the future then holds a "request cancelled" error
+    void cancel() { m_state->cancel(); }
+
+    class awaiter {
+    public:
+        explicit awaiter(std::shared_ptr<detail::future_state<T>> state)
+            : m_state(std::move(state)) {}
+
+        bool await_ready() const { return m_state->ready(); }
+
+        template <class Promise>
+        bool await_suspend(std::coroutine_handle<Promise> h) {
+            // a stopped task stops what it is waiting for, register before
+            // suspending as h may be resumed on another thread right after
+            auto stop = detail::stop_token_of(h);
+            if (stop.stop_possible())
+                m_on_stop.emplace(stop, [state = m_state] { state->cancel(); });
+
+            return m_state->suspend(h);
+        }
+
+        T await_resume() {
+            m_on_stop.reset();
+            return m_state->take();
+        }
+
+    private:
+        std::shared_ptr<detail::future_state<T>> m_state;
+        std::optional<std::stop_callback<std::function<void()>>> m_on_stop;
+    };
+
+    awaiter operator co_await() && { return awaiter(std::move(m_state)); }
+
+private:
+    std::shared_ptr<detail::future_state<T>> m_state;
+};
+
+namespace detail {
+
+template <class T> class task_promise_base {
+public:
+    /// symmetric transfer to the awaiting coroutine, or notify sync_wait()
+    struct final_awaiter {
+        bool await_ready() noexcept { return false; }
+
+        template <class Promise>
+        std::coroutine_handle<>
+        await_suspend(std::coroutine_handle<Promise> h) noexcept {
+            auto &promise = h.promise();
+            if (promise.m_continuation)
+                return promise.m_continuation;
+
+            // the frame may be destroyed as soon as sync_wait() is notified
+            if (auto on_done = std::move(promise.m_on_done))
+                on_done();
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    final_awaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { m_exception = std::current_exception(); }
+
+    std::stop_token stop_token() const { return m_stop_token; }
+
+    void rethrow_if_failed() {
+        if (m_exception)
+            std::rethrow_exception(m_exception);
+    }
+
+    std::coroutine_handle<> m_continuation;
+    std::function<void()> m_on_done;
+    std::exception_ptr m_exception;
+    std::stop_source m_stop_source;
+    std::stop_token m_stop_token = m_stop_source.get_token();
+};
+
+template <class T> class task_promise : public task_promise_base<T> {
+public:
+    task<T> get_return_object();
+    void return_value(T value) { m_value.emplace(std::move(value)); }
+
+    T result() {
+        this->rethrow_if_failed();
+        return std::move(*m_value);
+    }
+
+private:
+    std::optional<T> m_value;
+};
+
+template <> class task_promise<void> : public task_promise_base<void> {
+public:
+    task<void> get_return_object();
+    void return_void() {}
+    void result() { rethrow_if_failed(); }
+};
+
+} // namespace detail
+
+/// A lazily started coroutine. It runs when co_await-ed by another coroutine
+/// or passed to sync_wait(), and inherits the cancellation of the coroutine
+/// awaiting it.
+template <class T = void> class [[nodiscard]] task {
+public:
+    using promise_type = detail::task_promise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    explicit task(handle_type h) : m_handle(h) {}
+    task(task &&other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    task &operator=(task &&other) noexcept {
+        if (this != &other) {
+            if (m_handle)
+                m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+    ~task() {
+        if (m_handle)
+            m_handle.destroy();
+    }
+
+    /// Cancel the task: the requests and tasks it awaits complete with a
+    /// "request cancelled" error. Only has an effect on the outermost task,
+    /// awaited tasks share the cancellation of the task awaiting them.
+    void cancel() { m_handle.promise().m_stop_source.request_stop(); }
+
+    /// Cancel the task if it has not finished after timeout
+    /// \param loop the loop running the timer
+    void cancel_after(EventLoop &loop, std::chrono::milliseconds timeout) {
+        loop.call_after(timeout,
+                        [stop = m_handle.promise().m_stop_source]() mutable {
+                            stop.request_stop();
+                        });
+    }
+
+    class awaiter {
+    public:
+        explicit awaiter(handle_type h) : m_handle(h) {}
+
+        bool await_ready() { return false; }
+
+        /// start the task, it resumes parent when done
+        template <class Promise>
+        std::coroutine_handle<>
+        await_suspend(std::coroutine_handle<Promise> parent) {
+            m_handle.promise().m_continuation = parent;
+            auto stop = detail::stop_token_of(parent);
+            if (stop.stop_possible())
+                m_handle.promise().m_stop_token = stop;
+            return m_handle;
+        }
+
+        T await_resume() { return m_handle.promise().result(); }
+
+    private:
+        handle_type m_handle;
+    };
+
+    awaiter operator co_await() && { return awaiter(m_handle); }
+
+private:
+    template <class U> friend U sync_wait(task<U> t);
+
+    handle_type m_handle;
+};
+
+namespace detail {
+
+template <class T> task<T> task_promise<T>::get_return_object() {
+    return task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+}
+
+inline task<void> task_promise<void>::get_return_object() {
+    return task<void>(
+        std::coroutine_handle<task_promise<void>>::from_promise(*this));
+}
+
+} // namespace detail
+
+/// Run a task and block the calling thread until it finishes.
+/// Must not be called from the thread driving the event loop the task
+/// waits on.
+template <class T> T sync_wait(task<T> t) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+
+    t.m_handle.promise().m_on_done = [&] {
+        std::lock_guard lock(mutex);
+        done = true;
+        cv.notify_all();
+    };
+    t.m_handle.resume();
+
+    std::unique_lock lock(mutex);
+    cv.wait(lock, [&] { return done; });
+    return t.m_handle.promise().result();
+}
+
+} // namespace uboat
+
+#endif /* UBOAT_TASK_H */
@@ -17,13 +17,27 @@
 #ifndef UBOAT_H
 #define UBOAT_H
 
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <expected>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <memory_resource>
 #include <nlohmann/detail/macro_scope.hpp>
 #include <nlohmann/json.hpp>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "uboat/event_loop.h"
+#include "uboat/song_table.h"
+#include "uboat/symbol.h"
+#include "uboat/task.h"
+
 namespace uboat {
 
 static constexpr std::string PROJECT_NAME = "uboat";
@@ -31,6 +45,10 @@ static constexpr std::string VERSION = "0.0.1";
 static constexpr std::string API_VERSION =
     "1.16.1"; /* supported OpenSubsonic API version  */
 
+// Fields repeated across a library (genre, artist and album names, content
+// type, suffix, ...) are Symbols, sharing one copy of every distinct value.
+void from_json(const nlohmann::json &j, Symbol &s);
+
 namespace artist {
 
 /// An artist from ID3 tags.
@@ -78,9 +96,45 @@ struct Artists {
 /// https://opensubsonic.netlify.app/docs/responses/indexes/
 struct Indexes {
     std::string ignoredArticles;
+    std::int64_t lastModified; /* ms since the epoch */
+    std::vector<ArtistID3> shortcut;
     std::vector<IndexID3> index;
 };
 
+/// ArtistID3 referencing the strings of its response, see the View
+/// endpoints of OSClient
+struct ArtistID3View {
+    std::string_view id;
+    std::string_view name;
+    std::string_view coverArt;
+    std::string_view artistImageUrl;
+    std::size_t albumCount;
+    std::size_t userRating;
+    std::string_view starred;
+    std::string_view musicBrainzId;
+    std::string_view sortName;
+    std::vector<std::string_view> roles;
+};
+
+// json parsers
+// ArtistID3
+void from_json(const nlohmann::json &j, ArtistID3 &a);
+
+// ArtistInfo2
+void from_json(const nlohmann::json &j, ArtistInfo2 &a);
+
+// IndexID3
+void from_json(const nlohmann::json &j, IndexID3 &i);
+
+// Artists
+void from_json(const nlohmann::json &j, Artists &a);
+
+// Indexes
+void from_json(const nlohmann::json &j, Indexes &i);
+
+// views to owning models
+ArtistID3 to_owned(const ArtistID3View &a);
+
 } // namespace artist
 
 namespace misc {
@@ -96,12 +150,22 @@ struct Genres {
     std::vector<Genre> genre;
 };
 
+/// https://opensubsonic.netlify.app/docs/responses/musicfolder/
+struct MusicFolder {
+    std::size_t id;
+    std::string name;
+};
+
+struct MusicFolders {
+    std::vector<MusicFolder> musicFolder;
+};
+
 struct RecordLabel {
     std::string name;
 };
 
 struct ItemGenre {
-    std::string name;
+    Symbol name;
 };
 
 struct ItemDate {
@@ -124,18 +188,43 @@ struct ReplayGain {
     size_t fallbackGain;
 };
 
+// views
+struct RecordLabelView {
+    std::string_view name;
+};
+
+struct ItemGenreView {
+    std::string_view name;
+};
+
+struct DiscTitleView {
+    std::size_t disc;
+    std::string_view title;
+};
+
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Genre, value, songCount, albumCount)
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(RecordLabel, name)
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(ItemGenre, name)
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(DiscTitle, disc, title)
 
 // json parsers
+// Genres
+void from_json(const nlohmann::json &j, Genres &g);
+
+// MusicFolders
+void from_json(const nlohmann::json &j, MusicFolders &m);
+
 // ItemDate
 void from_json(const nlohmann::json &j, ItemDate &i);
 
 // ReplayGain
 void from_json(const nlohmann::json &j, ReplayGain &r);
 
+// views to owning models
+RecordLabel to_owned(const RecordLabelView &r);
+ItemGenre to_owned(const ItemGenreView &i);
+DiscTitle to_owned(const DiscTitleView &d);
+
 } // namespace misc
 
 namespace media {
@@ -147,17 +236,17 @@ struct Child {
     std::string parent;
     bool isDir;
     std::string title;
-    std::string album;
-    std::string artist;
+    Symbol album;
+    Symbol artist;
     std::size_t track;
     std::size_t year;
-    std::string genre;
+    Symbol genre;
     std::string coverArt;
     std::size_t size;
-    std::string contentType;
-    std::string suffix;
-    std::string transcodedContentType;
-    std::string transcodedSuffix;
+    Symbol contentType;
+    Symbol suffix;
+    Symbol transcodedContentType;
+    Symbol transcodedSuffix;
     std::size_t duration;
     std::size_t bitRate;
     std::size_t bitDepth;
@@ -173,8 +262,8 @@ struct Child {
     std::string starred;
     std::string albumId;
     std::string artistId;
-    std::string type;
-    std::string mediaType;
+    Symbol type;
+    Symbol mediaType;
     std::size_t bookmarkPosition;
     std::size_t originalWidth;
     std::size_t originalHeight;
@@ -185,9 +274,9 @@ struct Child {
     std::string musicBrainzId;
     std::vector<misc::ItemGenre> genres;
     std::vector<artist::ArtistID3> artists;
-    std::string displayArtist;
+    Symbol displayArtist;
     std::vector<artist::ArtistID3> albumArtists;
-    std::string displayAlbumArtist;
+    Symbol displayAlbumArtist;
     // contributors
     // displayComposer
     // moods
@@ -227,6 +316,61 @@ struct TopSongs {
     std::vector<Child> song;
 };
 
+/// Child referencing the strings of its response, see the View endpoints of
+/// OSClient
+struct ChildView {
+    std::string_view id;
+    std::string_view parent;
+    bool isDir;
+    std::string_view title;
+    std::string_view album;
+    std::string_view artist;
+    std::size_t track;
+    std::size_t year;
+    std::string_view genre;
+    std::string_view coverArt;
+    std::size_t size;
+    std::string_view contentType;
+    std::string_view suffix;
+    std::string_view transcodedContentType;
+    std::string_view transcodedSuffix;
+    std::size_t duration;
+    std::size_t bitRate;
+    std::size_t bitDepth;
+    std::size_t samplingRate;
+    std::size_t channelCount;
+    std::string_view path;
+    bool isVideo;
+    std::size_t userRating;
+    std::size_t averageRating;
+    std::size_t playCount;
+    std::size_t discNumber;
+    std::string_view created;
+    std::string_view starred;
+    std::string_view albumId;
+    std::string_view artistId;
+    std::string_view type;
+    std::string_view mediaType;
+    std::size_t bookmarkPosition;
+    std::size_t originalWidth;
+    std::size_t originalHeight;
+    std::string_view played;
+    std::size_t bpm;
+    std::string_view comment;
+    std::string_view sortName;
+    std::string_view musicBrainzId;
+    std::vector<misc::ItemGenreView> genres;
+    std::vector<artist::ArtistID3View> artists;
+    std::string_view displayArtist;
+    std::vector<artist::ArtistID3View> albumArtists;
+    std::string_view displayAlbumArtist;
+    misc::ReplayGain replayGain;
+};
+
+struct RandomSongsView {
+    std::vector<ChildView> song;
+};
+
 // json parser
 // Child
 void from_json(const nlohmann::json &j, Child &c);
@@ -240,6 +384,16 @@ void from_json(const nlohmann::json &j, RandomSongs &r);
 // NowPlaying
 void from_json(const nlohmann::json &j, NowPlaying &n);
 
+// SimilarSongs2
+void from_json(const nlohmann::json &j, SimilarSongs2 &s);
+
+// TopSongs
+void from_json(const nlohmann::json &j, TopSongs &t);
+
+// views to owning models
+Child to_owned(const ChildView &c);
+RandomSongs to_owned(const RandomSongsView &r);
+
 } // namespace media
 
 namespace album {
@@ -249,7 +403,7 @@ namespace album {
 struct AlbumID3 {
     std::string id;
     std::string name;
-    std::string artist;
+    Symbol artist;
     std::string artistId;
     std::string coverArt;
     std::size_t songCount;
@@ -258,14 +412,15 @@ struct AlbumID3 {
     std::string created;
     std::string starred;
     std::size_t year;
-    std::string genre;
+    Symbol genre;
     std::string played;
+    std::string changed;
     std::size_t userRating;
     std::vector<misc::RecordLabel> recordLabels;
     std::string musicBrainzId;
     std::vector<misc::ItemGenre> genres;
     std::vector<artist::ArtistID3> artists;
-    std::string displayArtist;
+    Symbol displayArtist;
     std::vector<std::string> releaseTypes;
     std::vector<std::string> moods;
     std::string sortName;
@@ -293,6 +448,45 @@ struct AlbumList2 {
     std::vector<AlbumID3> album;
 };
 
+/// AlbumID3 referencing the strings of its response, see the View endpoints
+/// of OSClient
+struct AlbumID3View {
+    std::string_view id;
+    std::string_view name;
+    std::string_view artist;
+    std::string_view artistId;
+    std::string_view coverArt;
+    std::size_t songCount;
+    std::size_t duration;
+    std::size_t playCount;
+    std::string_view created;
+    std::string_view starred;
+    std::size_t year;
+    std::string_view genre;
+    std::string_view played;
+    std::string_view changed;
+    std::size_t userRating;
+    std::vector<misc::RecordLabelView> recordLabels;
+    std::string_view musicBrainzId;
+    std::vector<misc::ItemGenreView> genres;
+    std::vector<artist::ArtistID3View> artists;
+    std::string_view displayArtist;
+    std::vector<std::string_view> releaseTypes;
+    std::vector<std::string_view> moods;
+    std::string_view sortName;
+    misc::ItemDate originalReleaseDate;
+    misc::ItemDate releaseDate;
+    bool isCompilation;
+    std::vector<misc::DiscTitleView> discTitles;
+};
+struct AlbumID3WithSongsView : AlbumID3View {
+    std::vector<media::ChildView> song;
+};
+
+struct AlbumList2View {
+    std::vector<AlbumID3View> album;
+};
+
 // json parsers
 // AlbumID3
 void from_json(const nlohmann::json &j, AlbumID3 &a);
@@ -300,8 +494,16 @@ void from_json(const nlohmann::json &j, AlbumID3 &a);
 // AlbumID3WithSongs
 void from_json(const nlohmann::json &j, AlbumID3WithSongs &a);
 
+// AlbumInfo
+void from_json(const nlohmann::json &j, AlbumInfo &a);
+
 // AlbumList2
 void from_json(const nlohmann::json &j, AlbumList2 &a);
+
+// views to owning models
+AlbumID3 to_owned(const AlbumID3View &a);
+AlbumID3WithSongs to_owned(const AlbumID3WithSongsView &a);
+AlbumList2 to_owned(const AlbumList2View &a);
 } // namespace album
 
 namespace playlist {
@@ -327,6 +529,11 @@ struct Playlists {
 struct PlaylistWithSongs : public Playlist {
     std::vector<media::Child> entry;
 };
+
+// json parsers
+void from_json(const nlohmann::json &j, Playlist &p);
+void from_json(const nlohmann::json &j, Playlists &p);
+void from_json(const nlohmann::json &j, PlaylistWithSongs &p);
 } // namespace playlist
 
 namespace search {
@@ -337,8 +544,207 @@ struct SearchResult3 {
     std::vector<album::AlbumID3> album;
     std::vector<media::Child> song;
 };
+
+struct SearchResult3View {
+    std::vector<artist::ArtistID3View> artist;
+    std::vector<album::AlbumID3View> album;
+    std::vector<media::ChildView> song;
+};
+
+// json parser
+// SearchResult3
+void from_json(const nlohmann::json &j, SearchResult3 &s);
+
+// views to owning models
+SearchResult3 to_owned(const SearchResult3View &s);
 } // namespace search
 
+/// Models allocating from a std::pmr::memory_resource, returned by the
+/// endpoints taking one. A whole response is decoded into the resource,
+/// e.g. a std::pmr::monotonic_buffer_resource, and released with it.
+/// Members are the same as those of the models of the same name. Only the
+/// responses which may list thousands of items have one, the others are
+/// small enough for the default allocator.
+namespace pmr {
+struct ArtistID3 {
+    std::pmr::string id;
+    std::pmr::string name;
+    std::pmr::string coverArt;
+    std::pmr::string artistImageUrl;
+    std::size_t albumCount;
+    std::size_t userRating;
+    std::pmr::string starred;
+    std::pmr::string musicBrainzId;
+    std::pmr::string sortName;
+    std::pmr::vector<std::pmr::string> roles;
+};
+
+struct IndexID3 {
+    std::pmr::string name;
+    std::pmr::vector<ArtistID3> artist;
+};
+
+struct Artists {
+    std::pmr::string ignoredArticles;
+    std::pmr::vector<IndexID3> index;
+};
+
+struct Indexes {
+    std::pmr::string ignoredArticles;
+    std::int64_t lastModified; /* ms since the epoch */
+    std::pmr::vector<ArtistID3> shortcut;
+    std::pmr::vector<IndexID3> index;
+};
+
+struct RecordLabel {
+    std::pmr::string name;
+};
+
+struct ItemGenre {
+    std::pmr::string name;
+};
+
+struct DiscTitle {
+    std::size_t disc;
+    std::pmr::string title;
+};
+
+struct Child {
+    std::pmr::string id;
+    std::pmr::string parent;
+    bool isDir;
+    std::pmr::string title;
+    std::pmr::string album;
+    std::pmr::string artist;
+    std::size_t track;
+    std::size_t year;
+    std::pmr::string genre;
+    std::pmr::string coverArt;
+    std::size_t size;
+    std::pmr::string contentType;
+    std::pmr::string suffix;
+    std::pmr::string transcodedContentType;
+    std::pmr::string transcodedSuffix;
+    std::size_t duration;
+    std::size_t bitRate;
+    std::size_t bitDepth;
+    std::size_t samplingRate;
+    std::size_t channelCount;
+    std::pmr::string path;
+    bool isVideo;
+    std::size_t userRating;
+    std::size_t averageRating;
+    std::size_t playCount;
+    std::size_t discNumber;
+    std::pmr::string created;
+    std::pmr::string starred;
+    std::pmr::string albumId;
+    std::pmr::string artistId;
+    std::pmr::string type;
+    std::pmr::string mediaType;
+    std::size_t bookmarkPosition;
+    std::size_t originalWidth;
+    std::size_t originalHeight;
+    std::pmr::string played;
+    std::size_t bpm;
+    std::pmr::string comment;
+    std::pmr::string sortName;
+    std::pmr::string musicBrainzId;
+    std::pmr::vector<ItemGenre> genres;
+    std::pmr::vector<ArtistID3> artists;
+    std::pmr::string displayArtist;
+    std::pmr::vector<ArtistID3> albumArtists;
+    std::pmr::string displayAlbumArtist;
+    misc::ReplayGain replayGain;
+};
+
+struct NowPlayingEntry : Child {
+    std::pmr::string username;
+    std::size_t minutesAgo;
+    std::size_t playerId;
+    std::pmr::string playerName;
+};
+
+struct RandomSongs {
+    std::pmr::vector<Child> song;
+};
+
+struct NowPlaying {
+    std::pmr::vector<NowPlayingEntry> entry;
+};
+
+struct SimilarSongs2 {
+    std::pmr::vector<Child> song;
+};
+
+struct TopSongs {
+    std::pmr::vector<Child> song;
+};
+
+struct AlbumID3 {
+    std::pmr::string id;
+    std::pmr::string name;
+    std::pmr::string artist;
+    std::pmr::string artistId;
+    std::pmr::string coverArt;
+    std::size_t songCount;
+    std::size_t duration;
+    std::size_t playCount;
+    std::pmr::string created;
+    std::pmr::string starred;
+    std::size_t year;
+    std::pmr::string genre;
+    std::pmr::string played;
+    std::pmr::string changed;
+    std::size_t userRating;
+    std::pmr::vector<RecordLabel> recordLabels;
+    std::pmr::string musicBrainzId;
+    std::pmr::vector<ItemGenre> genres;
+    std::pmr::vector<ArtistID3> artists;
+    std::pmr::string displayArtist;
+    std::pmr::vector<std::pmr::string> releaseTypes;
+    std::pmr::vector<std::pmr::string> moods;
+    std::pmr::string sortName;
+    misc::ItemDate originalReleaseDate;
+    misc::ItemDate releaseDate;
+    bool isCompilation;
+    std::pmr::vector<DiscTitle> discTitles;
+};
+struct AlbumID3WithSongs : AlbumID3 {
+    std::pmr::vector<Child> song;
+};
+
+struct AlbumList2 {
+    std::pmr::vector<AlbumID3> album;
+};
+
+struct Playlist {
+    std::pmr::string id;
+    std::pmr::string name;
+    std::pmr::string comment;
+    std::pmr::string owner;
+    bool isPublic;
+    std::size_t songCount;
+    std::size_t duration;
+    std::pmr::string created;
+    std::pmr::string changed;
+    std::pmr::string coverArt;
+    std::pmr::vector<std::pmr::string> allowedUser;
+};
+struct Playlists {
+    std::pmr::vector<Playlist> playlist;
+};
+struct PlaylistWithSongs : Playlist {
+    std::pmr::vector<Child> entry;
+};
+
+struct SearchResult3 {
+    std::pmr::vector<ArtistID3> artist;
+    std::pmr::vector<AlbumID3> album;
+    std::pmr::vector<Child> song;
+};
+} // namespace pmr
+
 namespace server {
 /// Error
 /// https://opensubsonic.netlify.app/docs/responses/error/
@@ -354,6 +760,13 @@ struct License {
     std::string trialExpires;
 };
 
+/// An OpenSubsonic extension supported by the server
+/// https://opensubsonic.netlify.app/docs/responses/opensubsonicextension/
+struct OpenSubsonicExtension {
+    std::string name;
+    std::vector<int> versions;
+};
+
 template <class Data> struct SubsonicResponse {
     std::string status;
     std::string version;
@@ -371,6 +784,9 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Error, code, message)
 // License
 void from_json(const nlohmann::json &j, License &l);
 
+// OpenSubsonicExtension
+void from_json(const nlohmann::json &j, OpenSubsonicExtension &o);
+
 // SubsonicResponse
 template <class Data>
 void to_json(nlohmann::json &j, const SubsonicResponse<Data> &s) {
@@ -385,18 +801,166 @@ template <class Data>
 void from_json(const nlohmann::json &j, SubsonicResponse<Data> &s);
 } // namespace server
 
-// helper for optional fields
-void set_if_contains(const nlohmann::json &j, const std::string &key, auto &v);
+namespace detail {
+class SessionPool;
+class ResponseCache;
+class SingleFlight;
+class TransferCounters;
+class Credentials;
+class ServerExtensions;
+struct Body;
+} // namespace detail
+
+/// How long a response is served from the cache before and after it is stale
+struct StalePolicy {
+    /// answered from the cache without any request until then
+    std::chrono::milliseconds soft_ttl;
+    /// then still answered from the cache while it is fetched again in the
+    /// background, callers wait for the server past hard_ttl
+    std::chrono::milliseconds hard_ttl;
+
+    bool operator==(const StalePolicy &) const = default;
+};
+
+/// Options of the response cache of an OSClient. The write requests of the
+/// client (star, setRating, the playlist endpoints, ...) update or drop the
+/// cached responses they affect, changes made by other clients are only seen
+/// once the responses expire.
+struct CacheOptions {
+    /// max size of the cached responses, 0 disables the cache
+    std::size_t max_bytes = 0;
+    /// how long the responses of an endpoint are reused, endpoints not listed
+    /// are never cached
+    std::map<std::string, std::chrono::milliseconds> ttl{
+        {"getAlbum", std::chrono::minutes(5)},
+        {"getAlbumInfo2", std::chrono::hours(1)},
+        {"getArtistInfo2", std::chrono::hours(1)}};
+    /// endpoints served stale while they are refreshed, taking precedence
+    /// over ttl. "endpoint?name=value" only applies to the requests with
+    /// that param. A ttl entry other than the default one of its endpoint
+    /// replaces the default policies below of the endpoint.
+    std::map<std::string, StalePolicy> stale{
+        {"getGenres", {std::chrono::minutes(10), std::chrono::hours(24)}},
+        {"getArtists", {std::chrono::minutes(10), std::chrono::hours(24)}},
+        {"getAlbumList2?type=newest",
+         {std::chrono::minutes(1), std::chrono::hours(1)}}};
+    /// directory keeping the responses of these endpoints across runs of the
+    /// client, empty for none. A restarted client answers from it within
+    /// the ttl (or stale period) of the endpoint, counted from when the
+    /// response was stored. Needs max_bytes.
+    std::filesystem::path directory;
+    /// size of the directory above which the oldest responses are dropped
+    std::size_t max_disk_bytes = 64 << 20;
+    /// responses stored longer ago are not used
+    std::chrono::hours max_disk_age{24 * 7};
+};
+
+/// Tuning options of an OSClient
+struct ClientOptions {
+    /// max number of idle keep-alive connections kept by the client
+    std::size_t pool_size = 8;
+    /// idle connections unused for longer than this are closed
+    std::chrono::seconds pool_idle_timeout{60};
+    /// event loop running the asynchronous requests, the client creates its
+    /// own loop (with its own thread) if none is given
+    std::shared_ptr<EventLoop> event_loop;
+    /// abort requests taking longer than this, 0 for no timeout
+    std::chrono::milliseconds request_timeout{0};
+    /// keep the decoded responses of the read endpoints in memory
+    CacheOptions cache;
+    /// ask for compressed responses (gzip, deflate, and zstd when built with
+    /// UBOAT_USE_ZSTD), decoded while they are parsed
+    bool compression = true;
+    /// authenticate with this API key instead of the username and password,
+    /// for the servers with the apiKeyAuthentication extension
+    std::string api_key;
+    /// regenerate the salt and the token of the password authentication
+    /// after this long, without asking the server again; 0 for a new salt
+    /// and token on every request. Unset, they are kept until the next
+    /// authenticate().
+    std::optional<std::chrono::seconds> token_lifetime;
+};
+
+/// Connection pool counters
+struct PoolStats {
+    std::size_t reused; /* requests sent over an already open connection */
+    std::size_t opened; /* connections opened (TCP/TLS handshakes) */
+    std::size_t idle;   /* connections currently idle in the pool */
+};
+
+/// Response cache counters
+struct CacheStats {
+    std::size_t hits;          /* requests answered from the cache */
+    std::size_t misses;        /* cacheable requests sent to the server */
+    std::size_t evictions;     /* entries dropped to stay under max_bytes */
+    std::size_t invalidations; /* entries dropped by write requests */
+    std::size_t patches;       /* entries updated in place by write requests */
+    std::size_t entries;       /* responses currently cached */
+    std::size_t bytes;         /* size charged for them */
+    std::size_t stale_hits;    /* hits past the soft TTL */
+    std::size_t refreshes;     /* requests sent again in the background */
+    std::size_t disk_hits;     /* misses answered from the directory */
+    std::size_t disk_bytes;    /* size of the directory */
+};
+
+/// Sizes of the response bodies read
+struct TransferStats {
+    std::size_t responses;     /* bodies read */
+    std::size_t wire_bytes;    /* their size as received, maybe compressed */
+    std::size_t decoded_bytes; /* their size once decoded */
+    std::size_t forms;         /* requests sent as a POST form */
+};
+
+/// Request counters
+struct RequestStats {
+    std::size_t coalesced; /* calls sharing an identical request in flight */
+    TransferStats total;
+    /// per endpoint, e.g. "getArtists"
+    std::map<std::string, TransferStats, std::less<>> endpoints;
+};
 
 /// OpenSubsonic Client
+///
+/// One client may be shared by any number of threads: its endpoints and
+/// authenticate() may be called concurrently. Each request borrows its own
+/// connection from the client's pool, and the credentials are replaced
+/// atomically by authenticate() and the token rotations.
 class OSClient {
 public:
     OSClient(const std::string &server_url, const std::string &username,
-             const std::string &password, const std::string &client_name);
-    ~OSClient() = default;
-
-    /// Generate MD5 token and try to ping() the server
-    /// **Must be called before any other endpoints**
+             const std::string &password, const std::string &client_name,
+             const ClientOptions &options = {});
+    OSClient(OSClient &&) noexcept;
+    OSClient &operator=(OSClient &&) noexcept;
+    ~OSClient();
+
+    /// Connection reuse counters of the client's connection pool
+    PoolStats pool_stats() const;
+
+    /// Counters of the requests made through the client. Identical read
+    /// requests made while one is in flight wait for its response instead of
+    /// sending their own. The bodies read are counted as received and once
+    /// decoded, see ClientOptions::compression. The requests too long for a
+    /// url are counted as forms once the server takes them.
+    RequestStats request_stats() const;
+
+    /// Counters of the response cache, all 0 when it is disabled
+    CacheStats cache_stats() const;
+
+    /// Drop all cached responses
+    void clear_cache();
+
+    /// The event loop running the asynchronous requests
+    std::shared_ptr<EventLoop> event_loop() const;
+
+    /// Generate a new salt and MD5 token and try to ping() the server
+    /// **Must be called before any other endpoints**, unless the client
+    /// authenticates with an API key, see ClientOptions::api_key. Later
+    /// tokens are generated without asking the server again, see
+    /// ClientOptions::token_lifetime.
+    /// If the server supports the formPost extension, requests with long
+    /// parameter lists (e.g. the songs of createPlaylist()) are then sent as
+    /// POST forms instead of in the url.
     /// \return returns a SubsonicResponse on success
     std::expected<server::SubsonicResponse<server::Error>, server::Error>
     authenticate();
@@ -417,8 +981,31 @@ public:
     /// success.
     std::expected<server::License, server::Error> getLicense() const;
 
+    /// List the OpenSubsonic extensions supported by the server.
+    /// https://opensubsonic.netlify.app/docs/endpoints/getopensubsonicextensions/
+    /// \return the extensions or Error
+    std::expected<std::vector<server::OpenSubsonicExtension>, server::Error>
+    getOpenSubsonicExtensions() const;
+
     // Browsing
 
+    /// Returns all configured top-level music folders.
+    /// https://opensubsonic.netlify.app/docs/endpoints/getmusicfolders/
+    /// \return MusicFolders or Error
+    std::expected<misc::MusicFolders, server::Error> getMusicFolders() const;
+
+    /// Returns an indexed structure of all artists.
+    /// https://opensubsonic.netlify.app/docs/endpoints/getindexes/
+    ///
+    /// \param musicFolderId only artists in the music folder with this id
+    /// \param ifModifiedSince if given, the index is returned only if the
+    /// collection changed since this time (ms since the epoch); otherwise the
+    /// Indexes has no index, and its lastModified tells when it last changed
+    /// \return Indexes or Error
+    std::expected<artist::Indexes, server::Error>
+    getIndexes(const std::string &musicFolderId = "",
+               const std::string &ifModifiedSince = "") const;
+
     /// Returns all genres
     /// https://opensubsonic.netlify.app/docs/endpoints/getgenres/
     /// \return A subsonic-response element with a nested genres element on
@@ -680,32 +1267,388 @@ public:
     scrobble(const std::string &id, const std::string &time = "",
              const std::string &submission = "") const;
 
+    // Endpoints allocating from a memory resource:
+    // Same parameters as the endpoints above, following resource. The data
+    // is allocated from resource, which has to outlive it.
+
+    /// getIndexes() allocating from resource
+    std::expected<pmr::Indexes, server::Error>
+    getIndexes(std::pmr::memory_resource *resource,
+               const std::string &musicFolderId = "",
+               const std::string &ifModifiedSince = "") const;
+
+    /// getArtists() allocating from resource
+    std::expected<pmr::Artists, server::Error>
+    getArtists(std::pmr::memory_resource *resource) const;
+
+    /// getAlbum() allocating from resource
+    std::expected<pmr::AlbumID3WithSongs, server::Error>
+    getAlbum(std::pmr::memory_resource *resource, const std::string &id) const;
+
+    /// getSimilarSongs2() allocating from resource
+    std::expected<pmr::SimilarSongs2, server::Error>
+    getSimilarSongs2(std::pmr::memory_resource *resource,
+                     const std::string &id,
+                     const std::string &count = "") const;
+
+    /// getTopSongs() allocating from resource
+    std::expected<pmr::TopSongs, server::Error>
+    getTopSongs(std::pmr::memory_resource *resource, const std::string &artist,
+                const std::string &count = "") const;
+
+    /// getAlbumList2() allocating from resource
+    std::expected<pmr::AlbumList2, server::Error>
+    getAlbumList2(std::pmr::memory_resource *resource, const std::string &type,
+                  const std::string &size = "", const std::string &offset = "",
+                  const std::string &fromYear = "",
+                  const std::string &toYear = "",
+                  const std::string &genre = "") const;
+
+    /// getRandomSongs() allocating from resource
+    std::expected<pmr::RandomSongs, server::Error>
+    getRandomSongs(std::pmr::memory_resource *resource,
+                   const std::string &size = "", const std::string &genre = "",
+                   const std::string &fromYear = "",
+                   const std::string &toYear = "") const;
+
+    /// getNowPlaying() allocating from resource
+    std::expected<pmr::NowPlaying, server::Error>
+    getNowPlaying(std::pmr::memory_resource *resource) const;
+
+    /// search3() allocating from resource
+    std::expected<pmr::SearchResult3, server::Error>
+    search3(std::pmr::memory_resource *resource, const std::string &query,
+            const std::string &artistCount = "",
+            const std::string &artistOffset = "",
+            const std::string &albumCount = "",
+            const std::string &albumOffset = "",
+            const std::string &songCount = "",
+            const std::string &songOffset = "",
+            const std::string &musicFolderId = "") const;
+
+    /// getPlaylists() allocating from resource
+    std::expected<pmr::Playlists, server::Error>
+    getPlaylists(std::pmr::memory_resource *resource,
+                 const std::string &username = "") const;
+
+    /// getPlaylist() allocating from resource
+    std::expected<pmr::PlaylistWithSongs, server::Error>
+    getPlaylist(std::pmr::memory_resource *resource,
+                const std::string &id) const;
+
+    // Song Table Endpoints:
+    // Same parameters as the endpoints above, the songs of the response are
+    // read straight into the columns of a SongTable, other data is skipped.
+
+    /// songs of getAlbum()
+    std::expected<SongTable, server::Error>
+    getAlbumTable(const std::string &id) const;
+
+    /// songs of getRandomSongs()
+    std::expected<SongTable, server::Error>
+    getRandomSongsTable(const std::string &size = "",
+                        const std::string &genre = "",
+                        const std::string &fromYear = "",
+                        const std::string &toYear = "") const;
+
+    /// songs of search3()
+    std::expected<SongTable, server::Error> search3Table(
+        const std::string &query, const std::string &songCount = "",
+        const std::string &songOffset = "",
+        const std::string &musicFolderId = "") const;
+
+    /// songs of getPlaylist()
+    std::expected<SongTable, server::Error>
+    getPlaylistTable(const std::string &id) const;
+
+    // View Endpoints:
+    // Same parameters as the endpoints above, for read-only batch jobs. The
+    // models hold std::string_views into one buffer per response instead of
+    // a std::string per field. The shared_ptr keeps the buffer alive, copies
+    // of it are cheap. Use to_owned() to keep data beyond the response.
+
+    template <class T>
+    using View = std::expected<std::shared_ptr<const T>, server::Error>;
+
+    /// getAlbum() returning a view
+    View<album::AlbumID3WithSongsView>
+    getAlbumView(const std::string &id) const;
+
+    /// getAlbumList2() returning a view
+    View<album::AlbumList2View> getAlbumList2View(
+        const std::string &type, const std::string &size = "",
+        const std::string &offset = "", const std::string &fromYear = "",
+        const std::string &toYear = "", const std::string &genre = "") const;
+
+    /// getRandomSongs() returning a view
+    View<media::RandomSongsView>
+    getRandomSongsView(const std::string &size = "",
+                       const std::string &genre = "",
+                       const std::string &fromYear = "",
+                       const std::string &toYear = "") const;
+
+    /// search3() returning a view
+    View<search::SearchResult3View> search3View(
+        const std::string &query, const std::string &artistCount = "",
+        const std::string &artistOffset = "",
+        const std::string &albumCount = "", const std::string &albumOffset = "",
+        const std::string &songCount = "", const std::string &songOffset = "",
+        const std::string &musicFolderId = "") const;
+
+    // Asynchronous API Endpoints:
+    // Same parameters and results as the blocking endpoints above. The
+    // requests run on the client's EventLoop, the futures are fulfilled on
+    // the thread driving the loop. A future can be waited for like a
+    // std::future, or co_await-ed from a uboat::task, see task.h.
+
+    template <class T> using Future = future<std::expected<T, server::Error>>;
+
+    // System
+
+    /// Asynchronous ping()
+    Future<server::SubsonicResponse<server::Error>> pingAsync() const;
+
+    /// Asynchronous getLicense()
+    Future<server::License> getLicenseAsync() const;
+
+    /// Asynchronous getOpenSubsonicExtensions()
+    Future<std::vector<server::OpenSubsonicExtension>>
+    getOpenSubsonicExtensionsAsync() const;
+
+    // Browsing
+
+    /// Asynchronous getMusicFolders()
+    Future<misc::MusicFolders> getMusicFoldersAsync() const;
+
+    /// Asynchronous getIndexes()
+    Future<artist::Indexes>
+    getIndexesAsync(const std::string &musicFolderId = "",
+                    const std::string &ifModifiedSince = "") const;
+
+    /// Asynchronous getGenres()
+    Future<misc::Genres> getGenresAsync() const;
+
+    /// Asynchronous getArtists()
+    Future<artist::Artists> getArtistsAsync() const;
+
+    /// Asynchronous getAlbum()
+    Future<album::AlbumID3WithSongs> getAlbumAsync(const std::string &id) const;
+
+    /// Asynchronous getArtistInfo2()
+    Future<artist::ArtistInfo2>
+    getArtistInfo2Async(const std::string &id, const std::string &count = "",
+                        const std::string &includeNotPresent = "false") const;
+
+    /// Asynchronous getAlbumInfo2()
+    Future<album::AlbumInfo> getAlbumInfo2Async(const std::string &id) const;
+
+    /// Asynchronous getSimilarSongs2()
+    Future<media::SimilarSongs2>
+    getSimilarSongs2Async(const std::string &id,
+                          const std::string &count = "") const;
+
+    /// Asynchronous getTopSongs()
+    Future<media::TopSongs>
+    getTopSongsAsync(const std::string &artist,
+                     const std::string &count = "") const;
+
+    // Album/song lists
+
+    /// Asynchronous getAlbumList2()
+    Future<album::AlbumList2> getAlbumList2Async(
+        const std::string &type, const std::string &size = "",
+        const std::string &offset = "", const std::string &fromYear = "",
+        const std::string &toYear = "", const std::string &genre = "") const;
+
+    /// Asynchronous getRandomSongs()
+    Future<media::RandomSongs>
+    getRandomSongsAsync(const std::string &size = "",
+                        const std::string &genre = "",
+                        const std::string &fromYear = "",
+                        const std::string &toYear = "") const;
+
+    /// Asynchronous getNowPlaying()
+    Future<media::NowPlaying> getNowPlayingAsync() const;
+
+    // Searching
+
+    /// Asynchronous search3()
+    Future<search::SearchResult3> search3Async(
+        const std::string &query, const std::string &artistCount = "",
+        const std::string &artistOffset = "",
+        const std::string &albumCount = "", const std::string &albumOffset = "",
+        const std::string &songCount = "", const std::string &songOffset = "",
+        const std::string &musicFolderId = "") const;
+
+    // Playlists
+
+    /// Asynchronous getPlaylists()
+    Future<playlist::Playlists>
+    getPlaylistsAsync(const std::string &username = "") const;
+
+    /// Asynchronous getPlaylist()
+    Future<playlist::PlaylistWithSongs>
+    getPlaylistAsync(const std::string &id) const;
+
+    /// Asynchronous createPlaylist()
+    Future<playlist::PlaylistWithSongs>
+    createPlaylistAsync(const std::string &playlistId, const std::string &name,
+                        const std::vector<std::string> &songId = {}) const;
+
+    /// Asynchronous updatePlaylist()
+    Future<server::SubsonicResponse<server::Error>> updatePlaylistAsync(
+        const std::string &playlistId, const std::string &name = "",
+        const std::string &comment = "", const std::string &isPublic = "",
+        const std::vector<std::string> &songIdToAdd = {},
+        const std::vector<std::string> &songIndexToRemove = {}) const;
+
+    /// Asynchronous deletePlaylist()
+    Future<server::SubsonicResponse<server::Error>>
+    deletePlaylistAsync(const std::string &id) const;
+
+    // Media annotation
+
+    /// Asynchronous star()
+    Future<server::SubsonicResponse<server::Error>>
+    starAsync(const std::string &id = "", const std::string &albumId = "",
+              const std::string &artistId = "") const;
+
+    /// Asynchronous unstar()
+    Future<server::SubsonicResponse<server::Error>>
+    unstarAsync(const std::string &id = "", const std::string &albumId = "",
+                const std::string &artistId = "") const;
+
+    /// Asynchronous setRating()
+    Future<server::SubsonicResponse<server::Error>>
+    setRatingAsync(const std::string &id, const std::string &rating) const;
+
+    /// Asynchronous scrobble()
+    Future<server::SubsonicResponse<server::Error>>
+    scrobbleAsync(const std::string &id, const std::string &time = "",
+                  const std::string &submission = "") const;
+
 private:
     // client information:
     std::string m_server_url; /* url of the server, without trailing "/" */
-    std::string m_username;   /* username for requests */
-    std::string m_password;   /* the user's password, will be encrypted */
-    std::string m_token;      /* MD5 token generated from password and salt */
-    std::string m_salt;       /* random salt */
 
-    // the name of the client using this library ,will be appended by
-    // "uboat-{version}" to be the parameter "c" in requests
-    std::string m_client_name;
+    // username, password or API key, and client name, encoded as the auth
+    // params of the requests
+    std::unique_ptr<detail::Credentials> m_credentials;
+
+    // keep-alive sessions shared by all requests
+    std::unique_ptr<detail::SessionPool> m_pool;
+
+    // event loop running the asynchronous requests
+    std::shared_ptr<EventLoop> m_loop;
+
+    std::chrono::milliseconds m_timeout; /* request timeout, 0 for none */
+
+    // decoded responses of the read endpoints, null when disabled, shared
+    // with the asynchronous write requests updating it when they complete
+    std::shared_ptr<detail::ResponseCache> m_cache;
+
+    // read requests in flight, shared by the identical ones
+    std::unique_ptr<detail::SingleFlight> m_flights;
+
+    // value of the Accept-Encoding header, empty to ask for no compression
+    std::string m_accept_encoding;
+
+    // sizes of the bodies read, shared with the asynchronous requests
+    std::shared_ptr<detail::TransferCounters> m_transfers;
+
+    // extensions of the server, see authenticate()
+    std::unique_ptr<detail::ServerExtensions> m_extensions;
+
+    /// a request as sent
+    struct Request {
+        std::string url;  /* with the query string, unless sent as a form */
+        std::string form; /* the query string, the body of a POST if set */
+    };
 
     /// helper for GET requests
     /// \param endpoint
     /// \param params the request parameters
+    /// \param resource where the pmr models allocate from
     template <class Data>
     std::expected<server::SubsonicResponse<Data>, server::Error>
     get_req(const std::string &endpoint,
             const std::multimap<std::string, std::string> &params,
-            const std::string &key) const;
+            const std::string &key,
+            std::pmr::memory_resource *resource = nullptr) const;
+
+    /// send a request, see request()
+    /// \param endpoint
+    /// \param params the request parameters
+    /// \return the body of the response, as received
+    std::expected<detail::Body, server::Error>
+    fetch(const std::string &endpoint,
+          const std::multimap<std::string, std::string> &params) const;
+
+    /// helper for GET requests returning view models
+    /// \param endpoint
+    /// \param params the request parameters
+    /// \param key the key of the data in the response
+    template <class Data>
+    View<Data>
+    get_view_req(const std::string &endpoint,
+                 const std::multimap<std::string, std::string> &params,
+                 const std::string &key) const;
+
+    /// helper for GET requests reading the songs into a SongTable
+    /// \param endpoint
+    /// \param params the request parameters
+    /// \param key the key of the data in the response
+    std::expected<SongTable, server::Error>
+    get_table_req(const std::string &endpoint,
+                  const std::multimap<std::string, std::string> &params,
+                  const std::string &key) const;
+
+    /// helper for asynchronous GET requests
+    /// \param endpoint
+    /// \param params the request parameters
+    /// \param finish turns the parsed response into the future's value, on
+    /// the thread driving the event loop
+    /// \param cache_update what a successful write request changes in the
+    /// response cache
+    template <class Data, class Result>
+    future<Result> get_req_async(
+        const std::string &endpoint,
+        const std::multimap<std::string, std::string> &params,
+        const std::string &key,
+        Result (*finish)(
+            std::expected<server::SubsonicResponse<Data>, server::Error>),
+        std::function<void(detail::ResponseCache &)> cache_update = {}) const;
+
+    /// fetch a response answered from the cache directory or stale again, in
+    /// the background, and cache the new one. One refresh of a request runs
+    /// at a time.
+    template <class Data>
+    void revalidate(const std::string &endpoint,
+                    const std::multimap<std::string, std::string> &params,
+                    const std::string &key) const;
+
+    /// apply update to the response cache if a write request succeeded
+    void update_cache(
+        bool succeeded,
+        const std::function<void(detail::ResponseCache &)> &update) const;
+
+    /// build a request, its query string goes in a form if it is too long
+    /// for the url and the server takes forms
+    Request
+    request(const std::string &endpoint,
+            const std::multimap<std::string, std::string> &params) const;
 
     /// check the response data
     /// \param r response
     template <class Data>
-    std::expected<Data, server::Error>
-    check(server::SubsonicResponse<Data> &r) const;
+    static std::expected<Data, server::Error>
+    check(server::SubsonicResponse<Data> &r);
+
+    /// check the result of a request
+    /// \param r the response or the error of the request
+    template <class Data>
+    static std::expected<Data, server::Error> check_response(
+        std::expected<server::SubsonicResponse<Data>, server::Error> r);
 };
 } // namespace uboat
 
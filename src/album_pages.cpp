@@ -0,0 +1,25 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "uboat/album_pages.h"
+#include <algorithm>
+#include <ranges>
+#include <utility>
+
+using namespace uboat;
+
+static_assert(std::ranges::input_range<AlbumPages>);
+
+AlbumPages::AlbumPages(const OSClient &client, AlbumPagesOptions options)
+    : m_range(
+          [client = &client, options](std::size_t offset, std::size_t size) {
+              return client->getAlbumList2Async(
+                  options.type, std::to_string(size), std::to_string(offset),
+                  options.fromYear, options.toYear, options.genre);
+          },
+          [](album::AlbumList2 &page) -> std::vector<album::AlbumID3> & {
+              return page.album;
+          },
+          std::clamp<std::size_t>(options.page_size, 1, MAX_PAGE_SIZE),
+          options.prefetch) {}
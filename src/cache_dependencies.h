@@ -0,0 +1,194 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \cache_dependencies.h
+/// What the cached responses depend on, and how they are patched: the songs,
+/// albums, artists and playlists found in the models, and the changes write
+/// requests make to them.
+//
+
+#ifndef UBOAT_CACHE_DEPENDENCIES_H
+#define UBOAT_CACHE_DEPENDENCIES_H
+
+#include "model_fields.h"
+#include "response_cache.h"
+#include "uboat/uboat.h"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace uboat::detail {
+
+// visit(model, f) calls f on every song, album, artist and playlist of a
+// model, nested ones included. Models without any are not visited.
+
+template <class T, class F> void visit(T &, F &) {}
+
+template <class F> void visit(artist::ArtistID3 &a, F &f) { f(a); }
+
+template <class F> void visit(artist::Artists &a, F &f) {
+    for (auto &index : a.index)
+        for (auto &artist : index.artist)
+            visit(artist, f);
+}
+
+template <class F> void visit(artist::ArtistInfo2 &a, F &f) {
+    for (auto &artist : a.similarArtist)
+        visit(artist, f);
+}
+
+template <class F> void visit(media::Child &c, F &f) {
+    f(c);
+    for (auto &a : c.artists)
+        visit(a, f);
+    for (auto &a : c.albumArtists)
+        visit(a, f);
+}
+
+template <class F> void visit(std::vector<media::Child> &songs, F &f) {
+    for (auto &c : songs)
+        visit(c, f);
+}
+
+template <class F> void visit(media::RandomSongs &r, F &f) {
+    visit(r.song, f);
+}
+
+template <class F> void visit(media::SimilarSongs2 &s, F &f) {
+    visit(s.song, f);
+}
+
+template <class F> void visit(media::TopSongs &t, F &f) { visit(t.song, f); }
+
+template <class F> void visit(media::NowPlaying &n, F &f) {
+    for (auto &e : n.entry)
+        visit(static_cast<media::Child &>(e), f);
+}
+
+template <class F> void visit(album::AlbumID3 &a, F &f) {
+    f(a);
+    for (auto &artist : a.artists)
+        visit(artist, f);
+}
+
+template <class F> void visit(album::AlbumID3WithSongs &a, F &f) {
+    visit(static_cast<album::AlbumID3 &>(a), f);
+    visit(a.song, f);
+}
+
+template <class F> void visit(album::AlbumList2 &l, F &f) {
+    for (auto &a : l.album)
+        visit(a, f);
+}
+
+template <class F> void visit(playlist::Playlist &p, F &f) { f(p); }
+
+template <class F> void visit(playlist::Playlists &p, F &f) {
+    for (auto &playlist : p.playlist)
+        visit(playlist, f);
+}
+
+template <class F> void visit(playlist::PlaylistWithSongs &p, F &f) {
+    visit(static_cast<playlist::Playlist &>(p), f);
+    visit(p.entry, f);
+}
+
+template <class F> void visit(search::SearchResult3 &s, F &f) {
+    for (auto &a : s.artist)
+        visit(a, f);
+    for (auto &a : s.album)
+        visit(a, f);
+    visit(s.song, f);
+}
+
+/// collects the dependencies of the entities visited
+struct Collector {
+    std::vector<std::string> &names;
+
+    void add(Entity kind, std::string_view id) {
+        if (!id.empty())
+            names.push_back(ResponseCache::dependency(kind, id));
+    }
+
+    void operator()(media::Child &c) { add(Entity::Song, c.id); }
+    void operator()(album::AlbumID3 &a) { add(Entity::Album, a.id); }
+    void operator()(artist::ArtistID3 &a) { add(Entity::Artist, a.id); }
+    void operator()(playlist::Playlist &p) { add(Entity::Playlist, p.id); }
+};
+
+/// applies a change to the songs, albums and artists visited
+struct Patcher {
+    const Change &change;
+
+    void operator()(playlist::Playlist &) {}
+
+    template <class E> void operator()(E &entity) {
+        if (entity.id != change.id)
+            return;
+        if (change.userRating)
+            entity.userRating = *change.userRating;
+        if (change.starred)
+            entity.starred = *change.starred;
+    }
+};
+
+/// \return the dependencies of a response to a request, see
+/// ResponseCache::dependency()
+template <class Data>
+std::vector<std::string>
+dependencies(const std::string &endpoint,
+             const std::multimap<std::string, std::string> &params,
+             Data &data) {
+    std::vector<std::string> names;
+    Collector collect{names};
+    visit(data, collect);
+
+    // the entity a request is about, also for models not holding it (info,
+    // tables)
+    static const std::map<std::string_view, Entity> SUBJECTS{
+        {"getAlbum", Entity::Album},
+        {"getAlbumInfo2", Entity::Album},
+        {"getArtist", Entity::Artist},
+        {"getArtistInfo2", Entity::Artist},
+        {"getPlaylist", Entity::Playlist}};
+    if (auto s = SUBJECTS.find(endpoint); s != SUBJECTS.end())
+        if (auto id = params.find("id"); id != params.end())
+            collect.add(s->second, id->second);
+
+    // the songs of a table
+    if constexpr (std::is_same_v<Data, SongTableData>)
+        for (std::size_t i = 0; i < data.songs.size(); ++i)
+            collect.add(Entity::Song, data.songs.id()[i]);
+
+    if (endpoint == "getPlaylists")
+        names.emplace_back(ResponseCache::PLAYLISTS);
+
+    std::ranges::sort(names);
+    auto duplicates = std::ranges::unique(names);
+    names.erase(duplicates.begin(), duplicates.end());
+    return names;
+}
+
+/// ResponseCache::Patch of SubsonicResponse<Data>: sets the rating and the
+/// star of the songs, albums and artists with the id of the change
+template <class Data>
+std::shared_ptr<const void> patch(const void *value, const Change &change) {
+    // the columns of a table are not patched, it is read again
+    if constexpr (std::is_same_v<Data, SongTableData>) {
+        return nullptr;
+    } else {
+        auto copy = std::make_shared<server::SubsonicResponse<Data>>(
+            *static_cast<const server::SubsonicResponse<Data> *>(value));
+        Patcher apply{change};
+        visit(copy->data, apply);
+        return copy;
+    }
+}
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_CACHE_DEPENDENCIES_H */
@@ -0,0 +1,83 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \concurrency_limit.h
+/// An adaptive limit on the requests in flight: it grows by one request per
+/// window of requests answered in time, and halves when the latency climbs
+/// above a target (additive increase, multiplicative decrease), so a busy
+/// server gets fewer requests at once.
+//
+
+#ifndef UBOAT_CONCURRENCY_LIMIT_H
+#define UBOAT_CONCURRENCY_LIMIT_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace uboat::detail {
+
+class ConcurrencyLimit {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// \param target latency above which the limit is halved
+    ConcurrencyLimit(std::size_t min, std::size_t max, clock::duration target)
+        : m_min(std::max<std::size_t>(min, 1)),
+          m_max(std::max(m_min, max)), m_target(target),
+          m_limit(static_cast<double>(std::max(m_min, m_max / 4))) {}
+
+    /// wait until one more request is allowed
+    /// \return when it was allowed, for release()
+    clock::time_point acquire() {
+        std::unique_lock lock(m_mutex);
+        m_allowed.wait(lock, [this] { return m_in_flight < limit_locked(); });
+        ++m_in_flight;
+        return clock::now();
+    }
+
+    /// record the end of a request allowed at start
+    void release(clock::time_point start) {
+        auto now = clock::now();
+        {
+            std::lock_guard lock(m_mutex);
+            --m_in_flight;
+            if (now - start <= m_target) {
+                m_limit = std::min(static_cast<double>(m_max),
+                                   m_limit + 1 / m_limit);
+            } else if (start >= m_decreased) {
+                // the requests sent before the last decrease saw the load
+                // which caused it, they do not decrease it again
+                m_limit = std::max(static_cast<double>(m_min), m_limit / 2);
+                m_decreased = now;
+            }
+        }
+        m_allowed.notify_all();
+    }
+
+    std::size_t limit() const {
+        std::lock_guard lock(m_mutex);
+        return limit_locked();
+    }
+
+private:
+    std::size_t limit_locked() const {
+        return static_cast<std::size_t>(m_limit);
+    }
+
+    const std::size_t m_min;
+    const std::size_t m_max;
+    const clock::duration m_target;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_allowed;
+    double m_limit;
+    std::size_t m_in_flight = 0;
+    clock::time_point m_decreased; /* time of the last decrease */
+};
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_CONCURRENCY_LIMIT_H */
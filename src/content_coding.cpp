@@ -0,0 +1,192 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "content_coding.h"
+#include <iterator>
+#include <zlib.h>
+#ifdef UBOAT_USE_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace uboat::detail;
+
+/// One coding, writing the next decoded bytes of its input
+class DecodingBuffer::Decoder {
+public:
+    virtual ~Decoder() = default;
+
+    /// decode up to size bytes into out
+    /// \return the number of bytes decoded, 0 at the end of the body or on
+    /// failure
+    virtual std::size_t read(char *out, std::size_t size) = 0;
+
+    bool failed = false;
+};
+
+namespace {
+
+class ZlibDecoder : public DecodingBuffer::Decoder {
+public:
+    /// \param window_bits as for inflateInit2(): 16 + 15 for gzip, 15 for
+    /// zlib, -15 for raw deflate
+    ZlibDecoder(std::string_view input, int window_bits) {
+        m_stream.next_in =
+            reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+        m_stream.avail_in = static_cast<uInt>(input.size());
+        m_done = inflateInit2(&m_stream, window_bits) != Z_OK;
+        failed = m_done;
+    }
+
+    ~ZlibDecoder() override { inflateEnd(&m_stream); }
+
+    std::size_t read(char *out, std::size_t size) override {
+        if (m_done)
+            return 0;
+        m_stream.next_out = reinterpret_cast<Bytef *>(out);
+        m_stream.avail_out = static_cast<uInt>(size);
+        while (m_stream.avail_out == size) {
+            auto rc = inflate(&m_stream, Z_NO_FLUSH);
+            if (rc == Z_STREAM_END) {
+                m_done = true;
+                break;
+            }
+            // Z_BUF_ERROR: the input ended before the body did
+            if (rc != Z_OK) {
+                failed = m_done = true;
+                return 0;
+            }
+        }
+        return size - m_stream.avail_out;
+    }
+
+private:
+    z_stream m_stream{};
+    bool m_done;
+};
+
+// "deflate" is meant to be zlib data, some servers send raw deflate data
+int deflate_window_bits(std::string_view input) {
+    if (input.size() >= 2) {
+        auto cmf = static_cast<unsigned char>(input[0]);
+        auto flg = static_cast<unsigned char>(input[1]);
+        if ((cmf & 0x0F) == Z_DEFLATED && ((cmf << 8) | flg) % 31 == 0)
+            return MAX_WBITS;
+    }
+    return -MAX_WBITS;
+}
+
+#ifdef UBOAT_USE_ZSTD
+class ZstdDecoder : public DecodingBuffer::Decoder {
+public:
+    explicit ZstdDecoder(std::string_view input)
+        : m_stream(ZSTD_createDStream()), m_input{input.data(), input.size(),
+                                                  0} {
+        failed = m_stream == nullptr;
+    }
+
+    ~ZstdDecoder() override { ZSTD_freeDStream(m_stream); }
+
+    std::size_t read(char *out, std::size_t size) override {
+        if (failed)
+            return 0;
+        ZSTD_outBuffer output{out, size, 0};
+        while (output.pos == 0) {
+            auto consumed = m_input.pos;
+            auto rc = ZSTD_decompressStream(m_stream, &output, &m_input);
+            if (ZSTD_isError(rc)) {
+                failed = true;
+                return 0;
+            }
+            if (output.pos == 0 && m_input.pos == consumed) {
+                // the end of the input, the last frame must be complete
+                failed = !m_complete;
+                return 0;
+            }
+            m_complete = rc == 0;
+        }
+        return output.pos;
+    }
+
+private:
+    ZSTD_DStream *m_stream;
+    ZSTD_inBuffer m_input;
+    bool m_complete = false;
+};
+#endif
+
+std::unique_ptr<DecodingBuffer::Decoder> decoder(std::string_view input,
+                                                 ContentCoding coding) {
+    switch (coding) {
+    case ContentCoding::Gzip:
+        return std::make_unique<ZlibDecoder>(input, 16 + MAX_WBITS);
+    case ContentCoding::Deflate:
+        return std::make_unique<ZlibDecoder>(input,
+                                             deflate_window_bits(input));
+#ifdef UBOAT_USE_ZSTD
+    case ContentCoding::Zstd:
+        return std::make_unique<ZstdDecoder>(input);
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+} // namespace
+
+std::string_view uboat::detail::accept_encoding() {
+#ifdef UBOAT_USE_ZSTD
+    return "zstd, gzip, deflate";
+#else
+    return "gzip, deflate";
+#endif
+}
+
+std::optional<ContentCoding>
+uboat::detail::content_coding(std::string_view header) {
+    if (header.empty() || header == "identity")
+        return ContentCoding::Identity;
+    if (header == "gzip" || header == "x-gzip")
+        return ContentCoding::Gzip;
+    if (header == "deflate")
+        return ContentCoding::Deflate;
+#ifdef UBOAT_USE_ZSTD
+    if (header == "zstd")
+        return ContentCoding::Zstd;
+#endif
+    return std::nullopt;
+}
+
+DecodingBuffer::DecodingBuffer(std::string_view input, ContentCoding coding)
+    : m_decoder(decoder(input, coding)),
+      m_chunk(std::make_unique<char[]>(CHUNK_SIZE)),
+      m_failed(m_decoder == nullptr) {}
+
+DecodingBuffer::~DecodingBuffer() = default;
+
+DecodingBuffer::int_type DecodingBuffer::underflow() {
+    if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+    if (m_failed)
+        return traits_type::eof();
+
+    auto size = m_decoder->read(m_chunk.get(), CHUNK_SIZE);
+    m_failed = m_decoder->failed;
+    if (size == 0)
+        return traits_type::eof();
+    m_decoded += size;
+    setg(m_chunk.get(), m_chunk.get(), m_chunk.get() + size);
+    return traits_type::to_int_type(*gptr());
+}
+
+std::expected<std::string, std::string>
+uboat::detail::decode(const Body &body) {
+    if (body.coding == ContentCoding::Identity)
+        return body.bytes;
+
+    DecodingBuffer buffer(body.bytes, body.coding);
+    std::string decoded(std::istreambuf_iterator<char>(&buffer), {});
+    if (buffer.failed())
+        return std::unexpected("invalid compressed body");
+    return decoded;
+}
@@ -0,0 +1,71 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \content_coding.h
+/// Compressed response bodies: the codings asked for in Accept-Encoding,
+/// and a std::streambuf decoding a body a chunk at a time while the reader
+/// parses it, so the decoded body is never held whole in memory.
+//
+
+#ifndef UBOAT_CONTENT_CODING_H
+#define UBOAT_CONTENT_CODING_H
+
+#include <cstddef>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+namespace uboat::detail {
+
+enum class ContentCoding { Identity, Gzip, Deflate, Zstd };
+
+/// the value of the Accept-Encoding header, the codings this build decodes
+std::string_view accept_encoding();
+
+/// the coding named by a Content-Encoding header, nullopt if this build
+/// cannot decode it
+std::optional<ContentCoding> content_coding(std::string_view header);
+
+/// A response body as it came over the wire
+struct Body {
+    std::string bytes;
+    ContentCoding coding = ContentCoding::Identity;
+};
+
+/// Input stream buffer decoding a compressed body
+class DecodingBuffer : public std::streambuf {
+public:
+    /// \param input must outlive the buffer
+    DecodingBuffer(std::string_view input, ContentCoding coding);
+    ~DecodingBuffer() override;
+
+    /// the input is not a valid body of its coding, or is cut short
+    bool failed() const { return m_failed; }
+
+    /// bytes decoded so far
+    std::size_t decoded() const { return m_decoded; }
+
+    class Decoder;
+
+protected:
+    int_type underflow() override;
+
+private:
+    static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+    std::unique_ptr<Decoder> m_decoder;
+    std::unique_ptr<char[]> m_chunk;
+    std::size_t m_decoded = 0;
+    bool m_failed = false;
+};
+
+/// decode a whole body
+/// \return the decoded body, or why it could not be decoded
+std::expected<std::string, std::string> decode(const Body &body);
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_CONTENT_CODING_H */
@@ -0,0 +1,200 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "uboat/crawler.h"
+#include "concurrency_limit.h"
+#include "model_fields.h"
+#include "uboat/album_pages.h"
+#include "work_stealing_pool.h"
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+using namespace uboat;
+using json = nlohmann::json;
+
+namespace {
+
+using Albums = std::unordered_map<std::string, album::AlbumID3WithSongs>;
+
+// The checkpoint has a line of JSON per fetched album, appended as they
+// arrive. A line cut short by an interruption is skipped.
+
+Albums read_checkpoint(const std::filesystem::path &path) {
+    Albums albums;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        auto j = json::parse(line, nullptr, false);
+        if (j.is_discarded())
+            continue;
+        try {
+            album::AlbumID3WithSongs album{};
+            detail::read_document(j, album);
+            auto id = album.id;
+            albums.insert_or_assign(std::move(id), std::move(album));
+        } catch (const json::exception &) {
+            continue;
+        }
+    }
+    return albums;
+}
+
+// start the lines appended after a partial one on a line of their own
+void end_line(const std::filesystem::path &path) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::ate);
+    if (file && file.tellg() > 0) {
+        file.seekg(-1, std::ios::end);
+        if (file.get() != '\n') {
+            file.seekp(0, std::ios::end);
+            file << '\n';
+        }
+    }
+}
+
+void write_checkpoint(std::ofstream &out,
+                      const album::AlbumID3WithSongs &album) {
+    if (out.is_open())
+        out << detail::write_document(album).dump() << '\n' << std::flush;
+}
+
+} // namespace
+
+Crawler::Crawler(const OSClient &client, CrawlerOptions options)
+    : m_client(&client), m_options(std::move(options)) {}
+
+CrawlProgress Crawler::progress() const {
+    std::lock_guard lock(m_mutex);
+    return m_progress;
+}
+
+std::expected<Snapshot, server::Error> Crawler::run() {
+    m_stopped = false;
+    Albums albums;
+    std::ofstream checkpoint;
+    if (!m_options.checkpoint.empty()) {
+        albums = read_checkpoint(m_options.checkpoint);
+        end_line(m_options.checkpoint);
+        checkpoint.open(m_options.checkpoint, std::ios::app);
+    }
+    {
+        std::lock_guard lock(m_mutex);
+        m_progress = CrawlProgress{};
+    }
+
+    // an ifModifiedSince in the future only asks for the time of the last
+    // change. It is read first, so changes made during the crawl are seen by
+    // the next sync. Like everything else it is fetched asynchronously, past
+    // the response cache, whose copies may be older than the library.
+    auto indexes =
+        m_client
+            ->getIndexesAsync(
+                "", std::to_string(std::numeric_limits<std::int64_t>::max()))
+            .get();
+
+    auto artists = m_client->getArtistsAsync().get();
+    if (!artists)
+        return std::unexpected(artists.error());
+
+    detail::ConcurrencyLimit limit(m_options.min_concurrency,
+                                   m_options.max_concurrency,
+                                   m_options.target_latency);
+    // the callback gets the counters in order, and may read them itself
+    std::mutex report_mutex;
+    auto report = [&] {
+        std::lock_guard report_lock(report_mutex);
+        CrawlProgress progress;
+        {
+            std::lock_guard lock(m_mutex);
+            m_progress.concurrency = limit.limit();
+            progress = m_progress;
+        }
+        if (m_options.on_progress)
+            m_options.on_progress(progress);
+    };
+
+    auto fetch = [&](const std::string &id) {
+        if (m_stopped)
+            return;
+        auto start = limit.acquire();
+        auto album = m_client->getAlbumAsync(id).get();
+        limit.release(start);
+        {
+            std::lock_guard lock(m_mutex);
+            if (album) {
+                write_checkpoint(checkpoint, *album);
+                albums.insert_or_assign(id, std::move(*album));
+                ++m_progress.fetched;
+            } else {
+                ++m_progress.failed;
+            }
+        }
+        report();
+    };
+
+    // the albums are fetched while the next pages of the list arrive
+    std::vector<std::string> order;
+    std::optional<server::Error> error;
+    {
+        detail::WorkStealingPool pool(m_options.max_concurrency);
+        AlbumPages pages(*m_client, {.type = "alphabeticalByName",
+                                     .page_size = m_options.page_size,
+                                     .prefetch = m_options.prefetch});
+        std::unordered_set<std::string> listed;
+        for (const album::AlbumID3 &album : pages) {
+            if (m_stopped)
+                break;
+            // an album moving in the list while it is read shows up twice
+            if (!listed.insert(album.id).second)
+                continue;
+            order.push_back(album.id);
+
+            bool resumed;
+            {
+                std::lock_guard lock(m_mutex);
+                ++m_progress.listed;
+                resumed = albums.contains(album.id);
+                if (resumed)
+                    ++m_progress.resumed;
+            }
+            if (resumed)
+                report();
+            else
+                pool.submit([&fetch, id = album.id] { fetch(id); });
+        }
+        error = pages.error();
+        pool.wait();
+    }
+    if (error)
+        return std::unexpected(*error);
+
+    Snapshot snapshot{};
+    for (auto &index : artists->index)
+        for (auto &artist : index.artist)
+            snapshot.artists.push_back(std::move(artist));
+    for (auto &id : order) {
+        auto it = albums.find(id);
+        if (it == albums.end())
+            snapshot.missing.push_back(id);
+        else
+            snapshot.albums.push_back(std::move(it->second));
+    }
+    snapshot.complete = !m_stopped && snapshot.missing.empty();
+    // a sync of a partial copy has to read the whole album list again
+    snapshot.lastModified =
+        snapshot.complete && indexes ? indexes->lastModified : 0;
+
+    // the next crawl starts over
+    if (snapshot.complete && checkpoint.is_open()) {
+        checkpoint.close();
+        std::error_code ec;
+        std::filesystem::remove(m_options.checkpoint, ec);
+    }
+    return snapshot;
+}
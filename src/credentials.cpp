@@ -0,0 +1,99 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "credentials.h"
+#include "request_query.h"
+#include <openssl/evp.h>
+#include <random>
+
+using namespace uboat::detail;
+
+namespace {
+
+constexpr std::size_t SALT_SIZE = 10;
+
+// random characters for a salt, from a generator seeded once per thread
+std::string random_salt() {
+    static constexpr std::string_view CHARACTERS =
+        "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    thread_local std::mt19937 gen(std::random_device{}());
+    std::uniform_int_distribution<std::size_t> distribution(
+        0, CHARACTERS.size() - 1);
+
+    std::string salt(SALT_SIZE, '\0');
+    for (auto &c : salt)
+        c = CHARACTERS[distribution(gen)];
+    return salt;
+}
+
+// the digest of data with md, in lower case hex
+std::string hex_digest(std::string_view data, const EVP_MD *md) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int size = 0;
+    EVP_Digest(data.data(), data.size(), digest, &size, md, nullptr);
+
+    static constexpr char HEX[] = "0123456789abcdef";
+    std::string hex(size * 2, '\0');
+    for (unsigned int i = 0; i < size; ++i) {
+        hex[2 * i] = HEX[digest[i] >> 4];
+        hex[2 * i + 1] = HEX[digest[i] & 0x0F];
+    }
+    return hex;
+}
+
+} // namespace
+
+std::string uboat::detail::md5_token(std::string_view password,
+                                     std::string_view salt) {
+    std::string password_salt;
+    password_salt.reserve(password.size() + salt.size());
+    password_salt.append(password).append(salt);
+    return hex_digest(password_salt, EVP_md5());
+}
+
+Credentials::Credentials(std::string username, std::string password,
+                         std::string api_key, std::string client_name,
+                         std::optional<clock::duration> token_lifetime)
+    : m_username(std::move(username)), m_password(std::move(password)),
+      m_api_key(std::move(api_key)), m_client_name(std::move(client_name)),
+      m_token_lifetime(token_lifetime) {
+    // an API key is enough, a password needs authenticate() first
+    m_current.store(std::make_shared<const Token>(
+        m_api_key.empty() ? auth_query(m_username, "", "", m_client_name)
+                          : api_key_query(m_api_key, m_client_name),
+        clock::time_point::max()));
+}
+
+std::string Credentials::identity() const {
+    // the key itself is not written to the cache directory
+    if (api_key())
+        return "apiKey:" + hex_digest(m_api_key, EVP_sha256());
+    return "u:" + m_username;
+}
+
+void Credentials::rotate() { m_current.store(make_token()); }
+
+std::shared_ptr<const std::string> Credentials::query() const {
+    auto token = m_current.load();
+    if (clock::now() >= token->expires) {
+        auto fresh = make_token();
+        // a rotation by another request wins, either token is valid
+        if (m_current.compare_exchange_strong(token, fresh))
+            token = std::move(fresh);
+    }
+    return std::shared_ptr<const std::string>(token, &token->query);
+}
+
+std::shared_ptr<const Credentials::Token> Credentials::make_token() const {
+    if (api_key())
+        return std::make_shared<const Token>(
+            api_key_query(m_api_key, m_client_name), clock::time_point::max());
+
+    auto salt = random_salt();
+    auto query = auth_query(m_username, md5_token(m_password, salt), salt,
+                            m_client_name);
+    auto expires = m_token_lifetime ? clock::now() + *m_token_lifetime
+                                    : clock::time_point::max();
+    return std::make_shared<const Token>(std::move(query), expires);
+}
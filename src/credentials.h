@@ -0,0 +1,74 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \credentials.h
+/// The auth params of the requests of one client, encoded once. With a
+/// password, its salt and token are regenerated locally, on a schedule or
+/// for every request, and swapped atomically so the requests reading them
+/// never wait for one another or for a rotation.
+//
+
+#ifndef UBOAT_CREDENTIALS_H
+#define UBOAT_CREDENTIALS_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace uboat::detail {
+
+/// the token of the password authentication for salt
+/// \return the MD5 of password and salt, in lower case hex
+std::string md5_token(std::string_view password, std::string_view salt);
+
+class Credentials {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// \param api_key if not empty, sent instead of the username and the
+    /// password (the apiKeyAuthentication extension)
+    /// \param token_lifetime regenerate the salt and the token after this
+    /// long, 0 for every request, never if unset
+    Credentials(std::string username, std::string password,
+                std::string api_key, std::string client_name,
+                std::optional<clock::duration> token_lifetime);
+
+    /// generate a new salt and token, their lifetime starts now
+    void rotate();
+
+    /// the encoded auth params of the next request, rotated first if due.
+    /// Safe to call from any thread.
+    std::shared_ptr<const std::string> query() const;
+
+    /// whether requests authenticate with an API key
+    bool api_key() const { return !m_api_key.empty(); }
+
+    /// who the requests are made as, telling apart the users of a server:
+    /// the username, or a digest of the API key
+    std::string identity() const;
+
+private:
+    struct Token {
+        std::string query;         /* encoded auth params */
+        clock::time_point expires; /* rotated from then on */
+    };
+
+    std::shared_ptr<const Token> make_token() const;
+
+    const std::string m_username;
+    const std::string m_password;
+    const std::string m_api_key;
+    const std::string m_client_name;
+    const std::optional<clock::duration> m_token_lifetime;
+
+    // the token of the next requests, without salt and token until the
+    // first rotate(), replaced whole by the rotations
+    mutable std::atomic<std::shared_ptr<const Token>> m_current;
+};
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_CREDENTIALS_H */
@@ -0,0 +1,445 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "disk_cache.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+
+using namespace uboat::detail;
+
+// the index file is a Header followed by a power of two Slots, an open
+// addressing hash table of the records by the hash of their key
+struct DiskCache::Header {
+    char magic[8];
+    std::uint32_t capacity; /* slots */
+    std::uint32_t used;     /* slots not empty, removed ones included */
+    std::uint32_t segment;  /* segment appended to */
+    std::uint32_t reserved;
+    std::uint64_t bytes; /* size of all segments */
+};
+
+struct DiskCache::Slot {
+    std::uint64_t hash; /* of the key, EMPTY or REMOVED */
+    std::uint64_t offset;
+    std::uint32_t segment;
+    std::uint32_t size; /* of the record */
+    std::int64_t written;
+};
+
+namespace {
+
+constexpr char MAGIC[8] = {'u', 'b', 'o', 'a', 't', 'i', 'x', '1'};
+constexpr std::uint32_t RECORD_MAGIC = 0x7562'6f73;
+constexpr std::uint32_t INITIAL_CAPACITY = 1024;
+
+constexpr std::uint64_t EMPTY = 0;
+constexpr std::uint64_t REMOVED = 1;
+
+// a segment file holds records, each the header, the key and the body in
+// its coding
+struct Record {
+    std::uint32_t magic;
+    std::uint32_t key_size;
+    std::uint32_t body_size;
+    std::uint32_t coding; /* ContentCoding of the body */
+    std::int64_t written; /* seconds since the epoch */
+};
+
+// FNV-1a, moved out of the two reserved values
+std::uint64_t hash(std::string_view key) {
+    std::uint64_t h = 0xcbf2'9ce4'8422'2325;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 0x100'0000'01b3;
+    }
+    return h <= REMOVED ? h + 2 : h;
+}
+
+std::int64_t now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// \return the number of a segment file name, if it is one
+std::optional<std::uint32_t> segment_number(const std::filesystem::path &p) {
+    auto name = p.filename().string();
+    if (!name.starts_with("segment-"))
+        return std::nullopt;
+    try {
+        return static_cast<std::uint32_t>(std::stoul(name.substr(8)));
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+} // namespace
+
+std::size_t DiskCache::index_size(std::uint32_t capacity) {
+    return sizeof(Header) + capacity * sizeof(Slot);
+}
+
+DiskCache::DiskCache(std::filesystem::path directory, std::size_t max_bytes,
+                     std::chrono::seconds max_age)
+    : m_directory(std::move(directory)), m_max_bytes(max_bytes),
+      m_max_age(max_age) {
+    std::lock_guard lock(m_mutex);
+    open();
+}
+
+DiskCache::~DiskCache() {
+    unmap_index();
+    for (auto [number, fd] : m_segments)
+        ::close(fd);
+}
+
+void DiskCache::open() {
+    // without a usable directory the cache stays unmapped and empty
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    if (ec)
+        return;
+
+    auto path = m_directory / "index";
+    int fd = ::open(path.c_str(), O_RDWR);
+    struct stat st;
+    if (fd >= 0 && ::fstat(fd, &st) == 0 &&
+        static_cast<std::size_t>(st.st_size) >= sizeof(Header)) {
+        map_index(fd, st.st_size);
+        if (m_map && (std::memcmp(header().magic, MAGIC, sizeof(MAGIC)) != 0 ||
+                      !std::has_single_bit(header().capacity) ||
+                      index_size(header().capacity) != m_map_size ||
+                      header().used * 2 > header().capacity))
+            unmap_index();
+    } else if (fd >= 0) {
+        ::close(fd);
+    }
+
+    if (!m_map) {
+        // a missing or damaged index loses the records
+        for (auto const &entry :
+             std::filesystem::directory_iterator(m_directory, ec))
+            if (segment_number(entry.path()))
+                std::filesystem::remove(entry.path(), ec);
+        create_index(path, INITIAL_CAPACITY);
+        return;
+    }
+
+    // segments of an interrupted compaction are not referenced
+    std::vector<std::uint32_t> referenced{header().segment};
+    for (std::uint32_t i = 0; i < header().capacity; ++i)
+        if (slots()[i].hash > REMOVED)
+            referenced.push_back(slots()[i].segment);
+    for (auto const &entry :
+         std::filesystem::directory_iterator(m_directory, ec))
+        if (auto n = segment_number(entry.path());
+            n && std::ranges::find(referenced, *n) == referenced.end())
+            std::filesystem::remove(entry.path(), ec);
+}
+
+void DiskCache::create_index(const std::filesystem::path &path,
+                             std::uint32_t capacity) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return;
+    if (::ftruncate(fd, index_size(capacity)) != 0) {
+        ::close(fd);
+        return;
+    }
+    map_index(fd, index_size(capacity));
+    if (!m_map)
+        return;
+
+    // the file is zero filled, all slots are EMPTY
+    auto &h = header();
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.capacity = capacity;
+}
+
+void DiskCache::map_index(int fd, std::size_t size) {
+    void *map =
+        ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        ::close(fd);
+        return;
+    }
+    m_index_fd = fd;
+    m_map = map;
+    m_map_size = size;
+}
+
+void DiskCache::unmap_index() {
+    if (m_map)
+        ::munmap(m_map, m_map_size);
+    if (m_index_fd >= 0)
+        ::close(m_index_fd);
+    m_map = nullptr;
+    m_map_size = 0;
+    m_index_fd = -1;
+}
+
+DiskCache::Header &DiskCache::header() const {
+    return *static_cast<Header *>(m_map);
+}
+
+DiskCache::Slot *DiskCache::slots() const {
+    return reinterpret_cast<Slot *>(static_cast<char *>(m_map) +
+                                    sizeof(Header));
+}
+
+DiskCache::Slot *DiskCache::probe(std::uint64_t hash) const {
+    // at most half of the slots are used, the probe always ends
+    auto mask = header().capacity - 1;
+    Slot *removed = nullptr;
+    for (auto i = hash & mask;; i = (i + 1) & mask) {
+        auto *slot = &slots()[i];
+        if (slot->hash == hash)
+            return slot;
+        if (slot->hash == EMPTY)
+            return removed ? removed : slot;
+        if (slot->hash == REMOVED && !removed)
+            removed = slot;
+    }
+}
+
+std::filesystem::path DiskCache::segment_path(std::uint32_t number) const {
+    return m_directory / ("segment-" + std::to_string(number));
+}
+
+int DiskCache::segment(std::uint32_t number) {
+    if (auto it = m_segments.find(number); it != m_segments.end())
+        return it->second;
+    int fd = ::open(segment_path(number).c_str(),
+                    O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd >= 0)
+        m_segments.emplace(number, fd);
+    return fd;
+}
+
+std::optional<Body> DiskCache::find(std::string_view key,
+                                    std::chrono::seconds *age) {
+    std::string record;
+    std::int64_t written;
+    {
+        std::lock_guard lock(m_mutex);
+        if (!m_map)
+            return std::nullopt;
+
+        auto h = hash(key);
+        auto *slot = probe(h);
+        if (slot->hash != h || slot->written + m_max_age.count() < now() ||
+            slot->size > m_max_bytes)
+            return std::nullopt;
+
+        written = slot->written;
+        int fd = segment(slot->segment);
+        record.resize(slot->size);
+        if (fd < 0 || ::pread(fd, record.data(), record.size(),
+                              slot->offset) != ssize_t(record.size()))
+            return std::nullopt;
+    }
+
+    // a record not matching its slot (another key with the same hash, or a
+    // torn write) is a miss; the body is decoded by its reader
+    Record r;
+    if (record.size() < sizeof(r))
+        return std::nullopt;
+    std::memcpy(&r, record.data(), sizeof(r));
+    if (r.magic != RECORD_MAGIC ||
+        r.coding > static_cast<std::uint32_t>(ContentCoding::Zstd) ||
+        sizeof(r) + r.key_size + r.body_size != record.size() ||
+        std::string_view(record).substr(sizeof(r), r.key_size) != key)
+        return std::nullopt;
+
+    if (age)
+        *age = std::chrono::seconds(std::max<std::int64_t>(now() - written, 0));
+    record.erase(0, sizeof(r) + r.key_size);
+    return Body{std::move(record), static_cast<ContentCoding>(r.coding)};
+}
+
+void DiskCache::store(std::string_view key, const Body &body) {
+    // compress outside the lock, a compressed body is not compressed again
+    std::string record(sizeof(Record) + key.size(), '\0');
+    auto coding = body.coding;
+    if (coding == ContentCoding::Identity) {
+        uLongf size = ::compressBound(body.bytes.size());
+        record.resize(record.size() + size);
+        if (::compress2(reinterpret_cast<Bytef *>(record.data()) +
+                            sizeof(Record) + key.size(),
+                        &size,
+                        reinterpret_cast<const Bytef *>(body.bytes.data()),
+                        body.bytes.size(), Z_BEST_SPEED) != Z_OK)
+            return;
+        record.resize(sizeof(Record) + key.size() + size);
+        // the zlib format is what "deflate" means
+        coding = ContentCoding::Deflate;
+    } else {
+        record += body.bytes;
+    }
+
+    Record r{RECORD_MAGIC, std::uint32_t(key.size()),
+             std::uint32_t(record.size() - sizeof(Record) - key.size()),
+             static_cast<std::uint32_t>(coding), now()};
+    std::memcpy(record.data(), &r, sizeof(r));
+    std::memcpy(record.data() + sizeof(r), key.data(), key.size());
+
+    // a segment holds several records
+    auto segment_limit = m_max_bytes / 4;
+    if (record.size() > segment_limit)
+        return;
+
+    std::lock_guard lock(m_mutex);
+    if (!m_map)
+        return;
+
+    // the probes end on an EMPTY slot only while at most half of the slots
+    // are used, a body is not stored if the compaction cannot make room
+    if ((header().used + 1) * 2 > header().capacity) {
+        compact();
+        if (!m_map || (header().used + 1) * 2 > header().capacity)
+            return;
+    }
+
+    auto &h = header();
+    int fd = segment(h.segment);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0)
+        return;
+    if (static_cast<std::size_t>(st.st_size) + record.size() >
+        segment_limit) {
+        fd = segment(++h.segment);
+        st.st_size = 0;
+        if (fd < 0)
+            return;
+    }
+
+    if (::write(fd, record.data(), record.size()) != ssize_t(record.size()))
+        return;
+    h.bytes += record.size();
+
+    // the record is written before the slot points to it
+    auto key_hash = hash(key);
+    auto *slot = probe(key_hash);
+    if (slot->hash == EMPTY)
+        ++h.used;
+    *slot = Slot{key_hash, std::uint64_t(st.st_size), h.segment,
+                 std::uint32_t(record.size()), r.written};
+
+    if (h.bytes > m_max_bytes)
+        compact();
+}
+
+void DiskCache::erase(std::string_view key) {
+    std::lock_guard lock(m_mutex);
+    if (!m_map)
+        return;
+
+    // the slot stays used, so that the probes of the other keys go on past
+    // it; the record is dropped by the next compaction
+    auto key_hash = hash(key);
+    auto *slot = probe(key_hash);
+    if (slot->hash == key_hash)
+        slot->hash = REMOVED;
+}
+
+void DiskCache::compact() {
+    auto &h = header();
+    auto oldest = now() - m_max_age.count();
+
+    std::vector<Slot> live;
+    for (std::uint32_t i = 0; i < h.capacity; ++i)
+        if (slots()[i].hash > REMOVED && slots()[i].written >= oldest)
+            live.push_back(slots()[i]);
+
+    // keep the newest records, in half of the space to leave room for the
+    // next ones
+    std::ranges::sort(live, std::ranges::greater{}, &Slot::written);
+    std::size_t bytes = 0;
+    auto kept = std::ranges::find_if(live, [&](const Slot &s) {
+        bytes += s.size;
+        return bytes > m_max_bytes / 2;
+    });
+    live.erase(kept, live.end());
+
+    auto last = h.segment;
+    auto number = last + 1;
+    int out = segment(number);
+    if (out < 0)
+        return;
+
+    std::uint64_t offset = 0;
+    std::string record;
+    for (auto &s : live) {
+        int in = segment(s.segment);
+        record.resize(s.size);
+        if (in < 0 ||
+            ::pread(in, record.data(), s.size, s.offset) != ssize_t(s.size) ||
+            ::write(out, record.data(), s.size) != ssize_t(s.size)) {
+            s.hash = EMPTY;
+            continue;
+        }
+        s.segment = number;
+        s.offset = offset;
+        offset += s.size;
+    }
+
+    // the new index replaces the old one at once, the old segments are only
+    // removed after
+    auto capacity = std::max(INITIAL_CAPACITY,
+                             std::bit_ceil(std::uint32_t(live.size() * 4)));
+    auto tmp = m_directory / "index.tmp";
+    unmap_index();
+    create_index(tmp, capacity);
+    if (!m_map) {
+        open();
+        return;
+    }
+    header().segment = number;
+    header().bytes = offset;
+    for (auto const &s : live) {
+        if (s.hash == EMPTY)
+            continue;
+        *probe(s.hash) = s;
+        ++header().used;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, m_directory / "index", ec);
+
+    for (auto it = m_segments.begin(); it != m_segments.end();) {
+        if (it->first > last) {
+            ++it;
+            continue;
+        }
+        ::close(it->second);
+        it = m_segments.erase(it);
+    }
+    for (auto const &entry :
+         std::filesystem::directory_iterator(m_directory, ec))
+        if (auto n = segment_number(entry.path()); n && *n <= last)
+            std::filesystem::remove(entry.path(), ec);
+}
+
+void DiskCache::clear() {
+    std::lock_guard lock(m_mutex);
+    unmap_index();
+    for (auto [number, fd] : m_segments)
+        ::close(fd);
+    m_segments.clear();
+
+    std::error_code ec;
+    std::filesystem::remove(m_directory / "index", ec);
+    open();
+}
+
+std::size_t DiskCache::bytes() const {
+    std::lock_guard lock(m_mutex);
+    return m_map ? header().bytes : 0;
+}
@@ -0,0 +1,98 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \disk_cache.h
+/// The disk tier of the response cache: compressed response bodies in
+/// append-only segment files, found through a hash table in a memory-mapped
+/// index file, so a restarted client reads them without parsing anything
+/// first. One client at a time may use a directory.
+//
+
+#ifndef UBOAT_DISK_CACHE_H
+#define UBOAT_DISK_CACHE_H
+
+#include "content_coding.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace uboat::detail {
+
+class DiskCache {
+public:
+    /// \param max_bytes size of the segments above which they are compacted
+    /// \param max_age bodies stored longer ago than this are not read and
+    /// are dropped by the compaction
+    DiskCache(std::filesystem::path directory, std::size_t max_bytes,
+              std::chrono::seconds max_age);
+    DiskCache(const DiskCache &) = delete;
+    DiskCache &operator=(const DiskCache &) = delete;
+    ~DiskCache();
+
+    /// \return the body stored for key, if any and not too old, still
+    /// compressed
+    /// \param age set to how long ago it was stored
+    std::optional<Body> find(std::string_view key,
+                             std::chrono::seconds *age = nullptr);
+
+    /// store body for key, replacing the previous one. A body received
+    /// compressed is stored as is, the others are compressed with zlib.
+    void store(std::string_view key, const Body &body);
+
+    /// drop the body of key, if any
+    void erase(std::string_view key);
+
+    /// drop all bodies
+    void clear();
+
+    /// size of the segments, dead records included
+    std::size_t bytes() const;
+
+private:
+    struct Header;
+    struct Slot;
+
+    /// map the index, or start an empty cache if it is missing or damaged
+    void open();
+    /// create an empty index of capacity slots at path and map it
+    void create_index(const std::filesystem::path &path,
+                      std::uint32_t capacity);
+    void map_index(int fd, std::size_t size);
+    void unmap_index();
+
+    static std::size_t index_size(std::uint32_t capacity);
+
+    Header &header() const;
+    Slot *slots() const;
+
+    /// the slot of hash, or the slot to insert it into
+    Slot *probe(std::uint64_t hash) const;
+
+    /// the file descriptor of a segment, opened on first use
+    int segment(std::uint32_t number);
+    std::filesystem::path segment_path(std::uint32_t number) const;
+
+    /// rewrite the newest live records into a new segment and index,
+    /// dropping the old and the dead ones
+    void compact();
+
+    const std::filesystem::path m_directory;
+    const std::size_t m_max_bytes;
+    const std::chrono::seconds m_max_age;
+
+    mutable std::mutex m_mutex;
+    int m_index_fd = -1;
+    void *m_map = nullptr;
+    std::size_t m_map_size = 0;
+    std::map<std::uint32_t, int> m_segments; /* open segment files */
+};
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_DISK_CACHE_H */
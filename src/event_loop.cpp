@@ -0,0 +1,394 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "uboat/event_loop.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <curl/curl.h>
+#include <mutex>
+#include <queue>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace uboat;
+
+namespace {
+
+// one transfer, owned by the loop from submit() until its callback ran
+struct Transfer {
+    std::uint64_t id;
+    std::string url;
+    std::chrono::milliseconds timeout;
+    EventLoop::Callback done;
+    std::string accept_encoding;
+    std::string form; /* body of a POST, empty for a GET */
+    std::string body;
+    std::string encoding; /* Content-Encoding of the response */
+    CURL *easy = nullptr;
+    curl_slist *headers = nullptr;
+};
+
+size_t write_body(char *data, size_t size, size_t nmemb, void *userdata) {
+    static_cast<Transfer *>(userdata)->body.append(data, size * nmemb);
+    return size * nmemb;
+}
+
+// keeps the Content-Encoding of the last response, after any redirect
+size_t write_header(char *data, size_t size, size_t nmemb, void *userdata) {
+    auto t = static_cast<Transfer *>(userdata);
+    std::string_view line(data, size * nmemb);
+    if (line.starts_with("HTTP/"))
+        t->encoding.clear();
+
+    static constexpr std::string_view NAME = "content-encoding:";
+    auto lower = [](unsigned char c) { return std::tolower(c); };
+    if (line.size() > NAME.size() &&
+        std::ranges::equal(line.substr(0, NAME.size()), NAME, {}, lower)) {
+        auto value = line.substr(NAME.size());
+        auto first = value.find_first_not_of(" \t");
+        auto last = value.find_last_not_of(" \t\r\n");
+        if (first != std::string_view::npos)
+            t->encoding = value.substr(first, last - first + 1);
+    }
+    return size * nmemb;
+}
+
+struct Timer {
+    std::chrono::steady_clock::time_point due;
+    std::function<void()> fn;
+
+    // for a min-heap on due
+    bool operator<(const Timer &other) const { return due > other.due; }
+};
+
+} // namespace
+
+struct EventLoop::Impl {
+    CURLM *multi;
+    bool own_thread;
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Transfer>> queued; /* waiting to be started */
+    std::vector<std::uint64_t> cancelled;          /* waiting to be aborted */
+    std::priority_queue<Timer> timers;
+    std::uint64_t next_id = 1;
+
+    // only touched by the thread driving the loop
+    std::vector<std::unique_ptr<Transfer>> running;
+    std::vector<CURL *> spare; /* finished easy handles, ready for reuse */
+
+    std::atomic<std::size_t> in_flight{0};
+
+    std::once_flag started;
+    std::jthread thread;
+    std::atomic<std::thread::id> polling; /* thread in poll(), if any */
+    // the EventLoop was destroyed by a callback run by poll(), which frees
+    // this once it returns
+    bool orphaned = false;
+
+    ~Impl();
+
+    std::size_t poll(std::chrono::milliseconds timeout);
+    void start_thread();
+    void start_queued();
+    void cancel_requested();
+    std::size_t complete_finished();
+    void run_timers();
+    std::chrono::milliseconds until_next_timer(std::chrono::milliseconds max);
+    void finish(Transfer &t, TransferResult result);
+    void fail_all(const std::string &message);
+};
+
+EventLoop::EventLoop(bool own_thread, long max_host_connections)
+    : m_impl(std::make_unique<Impl>()) {
+    m_impl->multi = curl_multi_init();
+    m_impl->own_thread = own_thread;
+    curl_multi_setopt(m_impl->multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+                      max_host_connections);
+}
+
+EventLoop::~EventLoop() {
+    m_impl->thread.request_stop();
+    // released by a callback, poll() is still running it and the thread
+    // cannot join itself
+    if (m_impl->polling == std::this_thread::get_id()) {
+        m_impl->orphaned = true;
+        if (m_impl->thread.joinable())
+            m_impl->thread.detach();
+        m_impl.release();
+        return;
+    }
+    if (m_impl->thread.joinable()) {
+        curl_multi_wakeup(m_impl->multi);
+        m_impl->thread.join();
+    }
+}
+
+EventLoop::Impl::~Impl() {
+    // nobody will drive the loop anymore
+    fail_all("event loop stopped");
+
+    for (auto *easy : spare)
+        curl_easy_cleanup(easy);
+    curl_multi_cleanup(multi);
+}
+
+std::uint64_t EventLoop::submit(std::string url, Callback done,
+                               std::chrono::milliseconds timeout,
+                               std::string accept_encoding,
+                               std::string form) {
+    std::uint64_t id;
+    {
+        std::lock_guard lock(m_impl->mutex);
+        id = m_impl->next_id++;
+        auto t = std::make_unique<Transfer>();
+        t->id = id;
+        t->url = std::move(url);
+        t->timeout = timeout;
+        t->done = std::move(done);
+        t->accept_encoding = std::move(accept_encoding);
+        t->form = std::move(form);
+        m_impl->queued.push_back(std::move(t));
+        ++m_impl->in_flight;
+    }
+
+    m_impl->start_thread();
+
+    // interrupt a poll() waiting for network activity
+    curl_multi_wakeup(m_impl->multi);
+    return id;
+}
+
+void EventLoop::cancel(std::uint64_t id) {
+    {
+        std::lock_guard lock(m_impl->mutex);
+        m_impl->cancelled.push_back(id);
+    }
+    curl_multi_wakeup(m_impl->multi);
+}
+
+void EventLoop::call_after(std::chrono::milliseconds delay,
+                           std::function<void()> fn) {
+    {
+        std::lock_guard lock(m_impl->mutex);
+        m_impl->timers.push(
+            Timer{std::chrono::steady_clock::now() + delay, std::move(fn)});
+    }
+
+    m_impl->start_thread();
+    curl_multi_wakeup(m_impl->multi);
+}
+
+std::size_t EventLoop::poll(std::chrono::milliseconds timeout) {
+    // this may be destroyed by the callbacks
+    auto *impl = m_impl.get();
+    auto completed = impl->poll(timeout);
+    if (impl->orphaned)
+        delete impl;
+    return completed;
+}
+
+std::size_t EventLoop::in_flight() const { return m_impl->in_flight.load(); }
+
+// not a member of EventLoop, which a callback may destroy while it runs
+std::size_t EventLoop::Impl::poll(std::chrono::milliseconds timeout) {
+    polling = std::this_thread::get_id();
+    int still_running = 0;
+
+    // timers first, they may cancel transfers
+    run_timers();
+    start_queued();
+    cancel_requested();
+    curl_multi_perform(multi, &still_running);
+    auto completed = complete_finished();
+
+    // no need to wait if something just completed, or for a loop destroyed
+    if (completed == 0 && !orphaned) {
+        auto wait = until_next_timer(timeout);
+        curl_multi_poll(multi, nullptr, 0, static_cast<int>(wait.count()),
+                        nullptr);
+        run_timers();
+        start_queued();
+        cancel_requested();
+        curl_multi_perform(multi, &still_running);
+        completed = complete_finished();
+    }
+    polling = std::thread::id();
+    return completed;
+}
+
+void EventLoop::Impl::start_thread() {
+    if (!own_thread)
+        return;
+
+    std::call_once(started, [this] {
+        thread = std::jthread([this](std::stop_token stop) {
+            while (!stop.stop_requested())
+                poll(std::chrono::seconds(1));
+            if (orphaned)
+                delete this;
+        });
+    });
+}
+
+void EventLoop::Impl::start_queued() {
+    std::vector<std::unique_ptr<Transfer>> batch;
+    {
+        std::lock_guard lock(mutex);
+        batch.swap(queued);
+    }
+
+    for (auto &t : batch) {
+        if (spare.empty()) {
+            t->easy = curl_easy_init();
+        } else {
+            t->easy = spare.back();
+            spare.pop_back();
+        }
+
+        curl_easy_setopt(t->easy, CURLOPT_URL, t->url.c_str());
+        curl_easy_setopt(t->easy, CURLOPT_WRITEFUNCTION, write_body);
+        curl_easy_setopt(t->easy, CURLOPT_WRITEDATA, t.get());
+        curl_easy_setopt(t->easy, CURLOPT_PRIVATE, t.get());
+        curl_easy_setopt(t->easy, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(t->easy, CURLOPT_TIMEOUT_MS,
+                         static_cast<long>(t->timeout.count()));
+        curl_easy_setopt(t->easy, CURLOPT_HEADERFUNCTION, write_header);
+        curl_easy_setopt(t->easy, CURLOPT_HEADERDATA, t.get());
+        if (!t->accept_encoding.empty())
+            t->headers = curl_slist_append(
+                t->headers, ("Accept-Encoding: " + t->accept_encoding).c_str());
+        if (!t->form.empty()) {
+            curl_easy_setopt(t->easy, CURLOPT_POSTFIELDS, t->form.data());
+            curl_easy_setopt(t->easy, CURLOPT_POSTFIELDSIZE_LARGE,
+                             static_cast<curl_off_t>(t->form.size()));
+            t->headers = curl_slist_append(
+                t->headers,
+                "Content-Type: application/x-www-form-urlencoded");
+            // send the body at once, without waiting for a 100 Continue
+            t->headers = curl_slist_append(t->headers, "Expect:");
+        }
+        if (t->headers)
+            curl_easy_setopt(t->easy, CURLOPT_HTTPHEADER, t->headers);
+
+        curl_multi_add_handle(multi, t->easy);
+        running.push_back(std::move(t));
+    }
+}
+
+void EventLoop::Impl::cancel_requested() {
+    std::vector<std::uint64_t> ids;
+    std::vector<std::unique_ptr<Transfer>> not_started;
+    {
+        std::lock_guard lock(mutex);
+        ids.swap(cancelled);
+
+        // submitted after the last start_queued()
+        for (auto id : ids) {
+            auto it = std::find_if(queued.begin(), queued.end(),
+                                   [id](const auto &t) { return t->id == id; });
+            if (it != queued.end()) {
+                not_started.push_back(std::move(*it));
+                queued.erase(it);
+            }
+        }
+    }
+
+    for (auto &t : not_started) {
+        --in_flight;
+        t->done(TransferResult{0, {}, "request cancelled"});
+    }
+
+    for (auto id : ids) {
+        auto it = std::find_if(running.begin(), running.end(),
+                               [id](const auto &t) { return t->id == id; });
+        if (it != running.end())
+            finish(**it, TransferResult{0, {}, "request cancelled"});
+    }
+}
+
+std::size_t EventLoop::Impl::complete_finished() {
+    std::size_t completed = 0;
+    int msgs_left = 0;
+
+    while (CURLMsg *msg = curl_multi_info_read(multi, &msgs_left)) {
+        if (msg->msg != CURLMSG_DONE)
+            continue;
+
+        Transfer *t = nullptr;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &t);
+
+        TransferResult result{0, {}, {}};
+        if (msg->data.result == CURLE_OK)
+            curl_easy_getinfo(t->easy, CURLINFO_RESPONSE_CODE,
+                              &result.status_code);
+        else
+            result.error = curl_easy_strerror(msg->data.result);
+
+        finish(*t, std::move(result));
+        ++completed;
+    }
+    return completed;
+}
+
+void EventLoop::Impl::finish(Transfer &t, TransferResult result) {
+    curl_multi_remove_handle(multi, t.easy);
+    curl_easy_reset(t.easy);
+    spare.push_back(t.easy);
+    curl_slist_free_all(t.headers);
+
+    result.body = std::move(t.body);
+    result.encoding = std::move(t.encoding);
+    auto done = std::move(t.done);
+
+    auto it = std::find_if(running.begin(), running.end(),
+                           [&t](const auto &r) { return r.get() == &t; });
+    std::iter_swap(it, running.end() - 1);
+    running.pop_back();
+    --in_flight;
+
+    done(std::move(result));
+}
+
+void EventLoop::Impl::run_timers() {
+    auto now = std::chrono::steady_clock::now();
+    std::vector<std::function<void()>> due;
+    {
+        std::lock_guard lock(mutex);
+        while (!timers.empty() && timers.top().due <= now) {
+            due.push_back(timers.top().fn);
+            timers.pop();
+        }
+    }
+    for (auto &fn : due)
+        fn();
+}
+
+std::chrono::milliseconds
+EventLoop::Impl::until_next_timer(std::chrono::milliseconds max) {
+    std::lock_guard lock(mutex);
+    if (timers.empty())
+        return max;
+
+    auto until = std::chrono::ceil<std::chrono::milliseconds>(
+        timers.top().due - std::chrono::steady_clock::now());
+    return std::clamp(until, std::chrono::milliseconds(0), max);
+}
+
+void EventLoop::Impl::fail_all(const std::string &message) {
+    while (!running.empty())
+        finish(*running.back(), TransferResult{0, {}, message});
+
+    std::vector<std::unique_ptr<Transfer>> batch;
+    {
+        std::lock_guard lock(mutex);
+        batch.swap(queued);
+    }
+    for (auto &t : batch) {
+        --in_flight;
+        t->done(TransferResult{0, {}, message});
+    }
+}
@@ -0,0 +1,152 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "inverted_index.h"
+#include <algorithm>
+
+using namespace uboat::detail;
+
+namespace {
+
+// bytes of UTF-8 sequences are letters, so words in other scripts stay whole
+bool is_token_char(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+           (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+char fold(unsigned char c) {
+    return static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+}
+
+} // namespace
+
+std::vector<std::string> InvertedIndex::tokenize(std::string_view text) {
+    std::vector<std::string> tokens;
+    std::string token;
+    for (unsigned char c : text) {
+        if (is_token_char(c)) {
+            token += fold(c);
+        } else if (!token.empty()) {
+            tokens.push_back(std::move(token));
+            token.clear();
+        }
+    }
+    if (!token.empty())
+        tokens.push_back(std::move(token));
+    return tokens;
+}
+
+void InvertedIndex::add(std::initializer_list<std::string_view> fields) {
+    auto document = static_cast<std::uint32_t>(m_lengths.size());
+    m_lengths.push_back(
+        fields.size() ? static_cast<std::uint32_t>(fields.begin()->size()) : 0);
+    for (auto field : fields) {
+        bool first = true;
+        for (auto &token : tokenize(field)) {
+            m_added.emplace_back(std::move(token), Posting{document, first});
+            first = false;
+        }
+    }
+}
+
+void InvertedIndex::build() {
+    // merge the new postings with the index, then group them by token
+    for (std::size_t i = 0; i < m_tokens.size(); ++i)
+        for (auto &posting : m_postings[i])
+            m_added.emplace_back(m_tokens[i], posting);
+    std::sort(m_added.begin(), m_added.end(), [](auto &a, auto &b) {
+        if (a.first != b.first)
+            return a.first < b.first;
+        return a.second.document < b.second.document;
+    });
+
+    m_tokens.clear();
+    m_postings.clear();
+    for (auto &[token, posting] : m_added) {
+        if (m_tokens.empty() || m_tokens.back() != token) {
+            m_tokens.push_back(std::move(token));
+            m_postings.emplace_back();
+        }
+        m_postings.back().push_back(posting);
+    }
+    m_added.clear();
+    m_added.shrink_to_fit();
+}
+
+std::vector<InvertedIndex::Match>
+InvertedIndex::matches(std::string_view term) const {
+    std::vector<Match> found;
+    auto it = std::lower_bound(m_tokens.begin(), m_tokens.end(), term);
+    for (; it != m_tokens.end() && it->starts_with(term); ++it) {
+        std::uint32_t score = it->size() == term.size() ? 2 : 1;
+        for (auto &posting : m_postings[it - m_tokens.begin()])
+            found.push_back({posting.document, score + posting.first});
+    }
+
+    // the best match of each document
+    std::sort(found.begin(), found.end(), [](auto &a, auto &b) {
+        if (a.document != b.document)
+            return a.document < b.document;
+        return a.score > b.score;
+    });
+    found.erase(std::unique(found.begin(), found.end(),
+                            [](auto &a, auto &b) {
+                                return a.document == b.document;
+                            }),
+                found.end());
+    return found;
+}
+
+std::vector<std::uint32_t> InvertedIndex::search(std::string_view query,
+                                                 std::size_t limit) const {
+    std::vector<std::uint32_t> documents;
+    auto terms = tokenize(query);
+    if (terms.empty()) {
+        auto n = std::min(limit, m_lengths.size());
+        for (std::uint32_t i = 0; i < n; ++i)
+            documents.push_back(i);
+        return documents;
+    }
+
+    // the documents matching every term, with the sum of their scores
+    std::vector<Match> result;
+    for (std::size_t i = 0; i < terms.size(); ++i) {
+        auto found = matches(terms[i]);
+        if (i == 0) {
+            result = std::move(found);
+        } else {
+            std::vector<Match> both;
+            auto a = result.begin();
+            auto b = found.begin();
+            while (a != result.end() && b != found.end()) {
+                if (a->document < b->document) {
+                    ++a;
+                } else if (b->document < a->document) {
+                    ++b;
+                } else {
+                    both.push_back({a->document, a->score + b->score});
+                    ++a;
+                    ++b;
+                }
+            }
+            result = std::move(both);
+        }
+        if (result.empty())
+            return documents;
+    }
+
+    auto better = [this](const Match &a, const Match &b) {
+        if (a.score != b.score)
+            return a.score > b.score;
+        if (m_lengths[a.document] != m_lengths[b.document])
+            return m_lengths[a.document] < m_lengths[b.document];
+        return a.document < b.document;
+    };
+    auto n = std::min(limit, result.size());
+    std::partial_sort(result.begin(), result.begin() + n, result.end(),
+                      better);
+    for (std::size_t i = 0; i < n; ++i)
+        documents.push_back(result[i].document);
+    return documents;
+}
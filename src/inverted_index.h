@@ -0,0 +1,67 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \inverted_index.h
+/// An inverted index over a few short text fields per document, such as a
+/// name and a sort name: every token (a run of letters and digits, ASCII
+/// folded to lower case) lists the documents it appears in. A query matches
+/// the documents holding every one of its tokens, whole or as a prefix.
+//
+
+#ifndef UBOAT_INVERTED_INDEX_H
+#define UBOAT_INVERTED_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace uboat::detail {
+
+class InvertedIndex {
+public:
+    /// add the next document, numbered from 0 in the order they are added.
+    /// The first field breaks ties of the ranking: shorter ranks first.
+    void add(std::initializer_list<std::string_view> fields);
+
+    /// make the documents added so far searchable
+    void build();
+
+    /// the documents holding every token of query, each as a token or a
+    /// prefix of one, best first: whole tokens rank above prefixes, and
+    /// tokens starting a field above the others. An empty query matches
+    /// every document, in order.
+    /// \param limit number of documents returned at most
+    std::vector<std::uint32_t> search(std::string_view query,
+                                      std::size_t limit) const;
+
+    std::size_t size() const { return m_lengths.size(); }
+
+    /// the tokens of text
+    static std::vector<std::string> tokenize(std::string_view text);
+
+private:
+    struct Posting {
+        std::uint32_t document;
+        bool first; /* the token starts a field */
+    };
+    struct Match {
+        std::uint32_t document;
+        std::uint32_t score;
+    };
+
+    /// the documents holding term, ordered by document
+    std::vector<Match> matches(std::string_view term) const;
+
+    std::vector<std::pair<std::string, Posting>> m_added; /* until build() */
+    std::vector<std::string> m_tokens;                    /* sorted */
+    std::vector<std::vector<Posting>> m_postings; /* of each token */
+    std::vector<std::uint32_t> m_lengths;         /* of the first fields */
+};
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_INVERTED_INDEX_H */
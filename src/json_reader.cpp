@@ -0,0 +1,251 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "json_reader.h"
+#include <istream>
+#include <nlohmann/json.hpp>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace uboat::detail {
+
+namespace {
+
+// nlohmann::json SAX consumer storing every value where its field table
+// says, keeping only a stack of the open objects and arrays
+class SaxReader {
+public:
+    SaxReader(const TypeInfo &type, void *target, ReadContext &context)
+        : m_root_type(&type), m_root(target), m_context(context) {}
+
+    const std::string &error() const { return m_error; }
+
+    bool null() {
+        if (m_skip > 0)
+            return true;
+        drop_pending();
+        return true;
+    }
+
+    bool boolean(bool value) {
+        return scalar(&TypeInfo::on_bool, value, "boolean");
+    }
+
+    bool number_integer(json::number_integer_t value) {
+        return scalar(&TypeInfo::on_integer, value, "number");
+    }
+
+    bool number_unsigned(json::number_unsigned_t value) {
+        return scalar(&TypeInfo::on_unsigned, value, "number");
+    }
+
+    bool number_float(json::number_float_t value, const json::string_t &) {
+        return scalar(&TypeInfo::on_float, value, "number");
+    }
+
+    bool string(json::string_t &value) {
+        return scalar<std::string_view>(&TypeInfo::on_string, value,
+                                        "string");
+    }
+
+    bool binary(json::binary_t &) { return fail("unexpected binary value"); }
+
+    bool start_object(std::size_t) {
+        if (m_skip > 0 || !destination()) {
+            ++m_skip;
+            return true;
+        }
+        if (!m_type->is_object())
+            return mismatch("object");
+
+        m_stack.push_back(Frame{m_type, m_target});
+        return true;
+    }
+
+    bool key(json::string_t &key) {
+        if (m_skip > 0)
+            return true;
+
+        auto &frame = m_stack.back();
+        auto index = frame.type->find(key);
+        if (index == frame.type->field_count) {
+            frame.pending = nullptr;
+            return true;
+        }
+
+        auto &field = frame.type->fields[index];
+        frame.pending = &field;
+        frame.seen |= std::uint64_t{1} << index;
+        return true;
+    }
+
+    bool end_object() {
+        if (m_skip > 0) {
+            --m_skip;
+            return true;
+        }
+
+        auto frame = m_stack.back();
+        m_stack.pop_back();
+
+        auto missing = frame.type->required & ~frame.seen;
+        if (missing != 0) {
+            for (std::size_t i = 0; i < frame.type->field_count; ++i)
+                if (missing & (std::uint64_t{1} << i))
+                    return fail("missing key \"" +
+                                std::string(frame.type->fields[i].name) +
+                                "\"");
+        }
+        if (frame.type->on_end)
+            frame.type->on_end(frame.target, frame.seen);
+        return true;
+    }
+
+    bool start_array(std::size_t) {
+        if (m_skip > 0 || !destination()) {
+            ++m_skip;
+            return true;
+        }
+        if (!m_type->is_array())
+            return mismatch("array");
+
+        m_stack.push_back(Frame{m_type, m_target});
+        return true;
+    }
+
+    bool end_array() {
+        if (m_skip > 0) {
+            --m_skip;
+            return true;
+        }
+        m_stack.pop_back();
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string &,
+                     const nlohmann::detail::exception &e) {
+        return fail(e.what());
+    }
+
+private:
+    struct Frame {
+        const TypeInfo *type;
+        void *target;
+        const FieldInfo *pending = nullptr; /* field of the last key */
+        std::uint64_t seen = 0;             /* fields found so far */
+    };
+
+    // find where the next value goes, into m_type and m_target
+    // \return false if it goes nowhere and has to be skipped
+    bool destination() {
+        if (m_stack.empty()) {
+            if (!m_root)
+                return false;
+            m_type = m_root_type;
+            m_target = std::exchange(m_root, nullptr);
+            return true;
+        }
+
+        auto &frame = m_stack.back();
+        if (frame.type->is_array()) {
+            m_type = frame.type->element;
+            m_target = frame.type->emplace_back(frame.target, m_context);
+            return true;
+        }
+
+        auto *field = std::exchange(frame.pending, nullptr);
+        if (!field)
+            return false;
+        m_type = field->type;
+        m_target = field->member(frame.target);
+        m_field = field;
+        return true;
+    }
+
+    // a null value is no value at all, like a missing key
+    void drop_pending() {
+        if (m_stack.empty())
+            return;
+        auto &frame = m_stack.back();
+        if (auto *field = std::exchange(frame.pending, nullptr))
+            frame.seen &= ~(std::uint64_t{1} << (field - frame.type->fields));
+    }
+
+    template <class V, class Handler>
+    bool scalar(Handler TypeInfo::*handler, V value, const char *what) {
+        if (m_skip > 0)
+            return true;
+
+        // check before an array element is added for the value
+        if (!m_stack.empty() && m_stack.back().type->is_array() &&
+            !(m_stack.back().type->element->*handler))
+            return mismatch(what);
+
+        if (!destination())
+            return true;
+        auto on_value = m_type->*handler;
+        if (!on_value)
+            return mismatch(what);
+
+        if constexpr (std::is_same_v<V, std::string_view>)
+            on_value(m_target, value, m_context);
+        else
+            on_value(m_target, value);
+        return true;
+    }
+
+    bool mismatch(const char *what) {
+        if (m_field && !m_stack.empty() &&
+            !m_stack.back().type->is_array())
+            return fail("unexpected " + std::string(what) + " for key \"" +
+                        std::string(m_field->name) + "\"");
+        return fail("unexpected " + std::string(what));
+    }
+
+    bool fail(std::string message) {
+        if (m_error.empty())
+            m_error = std::move(message);
+        return false;
+    }
+
+    const TypeInfo *m_root_type;
+    void *m_root;
+    ReadContext &m_context;
+    std::vector<Frame> m_stack;
+    std::size_t m_skip = 0; /* depth inside an ignored value */
+
+    // destination of the current value
+    const TypeInfo *m_type = nullptr;
+    void *m_target = nullptr;
+    const FieldInfo *m_field = nullptr;
+
+    std::string m_error;
+};
+
+} // namespace
+
+bool read_json(std::string_view body, const TypeInfo &type, void *target,
+               ReadContext &context, std::string &error) {
+    SaxReader reader(type, target, context);
+    if (json::sax_parse(body.begin(), body.end(), &reader))
+        return true;
+
+    error = reader.error().empty() ? "invalid response" : reader.error();
+    return false;
+}
+
+bool read_json(std::istream &body, const TypeInfo &type, void *target,
+               ReadContext &context, std::string &error) {
+    SaxReader reader(type, target, context);
+    if (json::sax_parse(body, &reader))
+        return true;
+
+    error = reader.error().empty() ? "invalid response" : reader.error();
+    return false;
+}
+
+} // namespace uboat::detail
@@ -0,0 +1,120 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \json_reader.h
+/// Streaming reader filling the models straight from the response body,
+/// driven by the field tables of model_fields.h.
+//
+
+#ifndef UBOAT_JSON_READER_H
+#define UBOAT_JSON_READER_H
+
+#include "content_coding.h"
+#include "model_fields.h"
+#include <expected>
+#include <istream>
+#include <string>
+#include <string_view>
+
+namespace uboat::detail {
+
+/// Parse the JSON document body into target, a value of the type described
+/// by type. Unknown keys and null values are skipped.
+/// \param error set to the reason on failure
+/// \return true on success
+bool read_json(std::string_view body, const TypeInfo &type, void *target,
+               ReadContext &context, std::string &error);
+
+/// Parse the JSON document read from body, see above
+bool read_json(std::istream &body, const TypeInfo &type, void *target,
+               ReadContext &context, std::string &error);
+
+/// Parse a response body, data is read from the member key of the
+/// "subsonic-response" object.
+/// \param context where the strings of view models go
+template <class Data, class Source>
+std::expected<server::SubsonicResponse<Data>, server::Error>
+read_response_from(Source &&body, std::string_view key,
+                   ReadContext context) {
+    using Response = server::SubsonicResponse<Data>;
+    struct Root : Response {
+        std::uint64_t seen = 0; /* keys found in the envelope */
+    };
+
+    // the envelope, with the data member under its runtime key first
+    static constexpr auto ENVELOPE = envelope_fields<Data, Root>();
+    std::array<FieldInfo, ENVELOPE.size() + 1> fields{};
+    fields[0] = field<Root, &Response::data>(key);
+    for (std::size_t i = 0; i < ENVELOPE.size(); ++i)
+        fields[i + 1] = ENVELOPE[i];
+
+    const TypeInfo envelope{
+        .fields = fields.data(),
+        .field_count = fields.size(),
+        .required = required_mask(fields),
+        .on_end =
+            [](void *o, std::uint64_t seen) {
+                static_cast<Root *>(o)->seen = seen;
+            },
+    };
+    const FieldInfo root_field{"subsonic-response",
+                               [](void *o) -> void * { return o; }, &envelope,
+                               REQUIRED};
+    const TypeInfo root_type{
+        .fields = &root_field, .field_count = 1, .required = 1};
+
+    Root root{};
+    // pmr models are in the resource before anything is read into them
+    if (context.resource && Type<Data>::info.adopt)
+        Type<Data>::info.adopt(&root.data, context.resource);
+    std::string error;
+    if (!read_json(body, root_type, &root, context, error))
+        return std::unexpected(server::Error{500, error});
+
+    static constexpr std::uint64_t DATA = 1;
+    static constexpr std::uint64_t ERROR = std::uint64_t{1} << ENVELOPE.size();
+
+    // the error of ping() is both its data and the error
+    if constexpr (std::is_same_v<Data, server::Error>)
+        if (key == "error" && (root.seen & DATA))
+            root.error = root.data;
+
+    if (root.seen & (DATA | ERROR) || root.status == "ok")
+        return static_cast<Response &&>(root);
+    else
+        return std::unexpected(server::Error{500, "unknown key"});
+}
+
+template <class Data>
+std::expected<server::SubsonicResponse<Data>, server::Error>
+read_response(std::string_view body, std::string_view key,
+              ReadContext context = {}) {
+    return read_response_from<Data>(body, key, context);
+}
+
+/// Parse a response body as received, decoding it while it is read
+/// \param decoded set to the size of the decoded body, if not null
+template <class Data>
+std::expected<server::SubsonicResponse<Data>, server::Error>
+read_response(const Body &body, std::string_view key, ReadContext context = {},
+              std::size_t *decoded = nullptr) {
+    if (body.coding == ContentCoding::Identity) {
+        if (decoded)
+            *decoded = body.bytes.size();
+        return read_response_from<Data>(std::string_view(body.bytes), key,
+                                        context);
+    }
+
+    DecodingBuffer buffer(body.bytes, body.coding);
+    std::istream stream(&buffer);
+    auto response = read_response_from<Data>(stream, key, context);
+    if (decoded)
+        *decoded = buffer.decoded();
+    if (buffer.failed())
+        return std::unexpected(server::Error{500, "invalid compressed body"});
+    return response;
+}
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_JSON_READER_H */
@@ -0,0 +1,142 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "uboat/library_sync.h"
+#include "concurrency_limit.h"
+#include "uboat/album_pages.h"
+#include "work_stealing_pool.h"
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+using namespace uboat;
+
+namespace {
+
+// whether the listed album differs from the copy in the snapshot. Servers
+// without the changed field still change the counts or the cover of an
+// album whose songs changed.
+bool differs(const album::AlbumID3 &listed, const album::AlbumID3 &stored) {
+    return listed.changed != stored.changed ||
+           listed.created != stored.created || listed.name != stored.name ||
+           listed.artistId != stored.artistId ||
+           listed.coverArt != stored.coverArt ||
+           listed.songCount != stored.songCount ||
+           listed.duration != stored.duration || listed.year != stored.year;
+}
+
+} // namespace
+
+LibrarySync::LibrarySync(const OSClient &client, SyncOptions options)
+    : m_client(&client), m_options(std::move(options)) {}
+
+std::expected<SyncDiff, server::Error>
+LibrarySync::sync(Snapshot &snapshot) const {
+    // everything is fetched asynchronously, past the response cache, whose
+    // copies may predate the changes being synced
+    auto watermark = snapshot.lastModified;
+    auto indexes = m_client
+                       ->getIndexesAsync("", watermark != 0
+                                                 ? std::to_string(watermark)
+                                                 : "")
+                       .get();
+    if (!indexes)
+        return std::unexpected(indexes.error());
+    if (watermark != 0 && indexes->lastModified <= watermark &&
+        snapshot.missing.empty())
+        return SyncDiff{};
+
+    std::unordered_map<std::string_view, std::size_t> stored;
+    for (std::size_t i = 0; i < snapshot.albums.size(); ++i)
+        stored.emplace(snapshot.albums[i].id, i);
+
+    detail::ConcurrencyLimit limit(m_options.min_concurrency,
+                                   m_options.max_concurrency,
+                                   m_options.target_latency);
+    std::mutex mutex;
+    std::unordered_map<std::string, album::AlbumID3WithSongs> fetched;
+    auto fetch = [&](const std::string &id) {
+        auto start = limit.acquire();
+        auto album = m_client->getAlbumAsync(id).get();
+        limit.release(start);
+        if (album) {
+            std::lock_guard lock(mutex);
+            fetched.insert_or_assign(id, std::move(*album));
+        }
+    };
+
+    // the albums are fetched while the next pages of the list arrive
+    SyncDiff diff;
+    std::unordered_set<std::string> listed;
+    std::optional<server::Error> error;
+    {
+        detail::WorkStealingPool pool(m_options.max_concurrency);
+        AlbumPages pages(*m_client, {.type = "newest",
+                                     .page_size = m_options.page_size,
+                                     .prefetch = m_options.prefetch});
+        for (const album::AlbumID3 &album : pages) {
+            // an album moving in the list while it is read shows up twice
+            if (!listed.insert(album.id).second)
+                continue;
+            auto it = stored.find(album.id);
+            if (it == stored.end())
+                diff.added.push_back(album.id);
+            else if (differs(album, snapshot.albums[it->second]))
+                diff.updated.push_back(album.id);
+            else
+                continue;
+            pool.submit([&fetch, id = album.id] { fetch(id); });
+        }
+        error = pages.error();
+        pool.wait();
+    }
+    if (error)
+        return std::unexpected(*error);
+
+    auto artists = m_client->getArtistsAsync().get();
+    if (!artists)
+        return std::unexpected(artists.error());
+
+    // apply the changes: the albums in place keep their position, the new
+    // ones follow, newest first
+    std::vector<std::string> missing;
+    std::vector<album::AlbumID3WithSongs> albums;
+    albums.reserve(snapshot.albums.size() + diff.added.size());
+    for (auto &album : snapshot.albums) {
+        if (!listed.contains(album.id)) {
+            diff.removed.push_back(album.id);
+            continue;
+        }
+        auto it = fetched.find(album.id);
+        if (it != fetched.end())
+            albums.push_back(std::move(it->second));
+        else
+            albums.push_back(std::move(album));
+    }
+    for (auto &id : diff.updated)
+        if (!fetched.contains(id))
+            missing.push_back(id);
+    for (auto &id : diff.added) {
+        auto it = fetched.find(id);
+        if (it != fetched.end())
+            albums.push_back(std::move(it->second));
+        else
+            missing.push_back(id);
+    }
+
+    snapshot.artists.clear();
+    for (auto &index : artists->index)
+        for (auto &artist : index.artist)
+            snapshot.artists.push_back(std::move(artist));
+    snapshot.albums = std::move(albums);
+    snapshot.missing = std::move(missing);
+    snapshot.complete = snapshot.missing.empty();
+    if (snapshot.complete)
+        snapshot.lastModified = indexes->lastModified;
+    return diff;
+}
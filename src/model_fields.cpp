@@ -0,0 +1,136 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "model_fields.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace uboat::detail {
+
+namespace {
+
+// let nlohmann::json throw the exception it throws for a value of the wrong
+// type, as the former from_json functions did
+[[noreturn]] void wrong_type(const json &value, const TypeInfo &type) {
+    if (type.on_string)
+        (void)value.get_ref<const json::string_t &>();
+    else if (type.on_bool)
+        (void)value.get<bool>();
+    else if (type.on_float)
+        (void)value.get<double>();
+    else if (type.is_array())
+        (void)value.at(0);
+    else
+        (void)value.at("");
+    throw std::logic_error("unexpected value accepted");
+}
+
+} // namespace
+
+void read_document(const json &j, const TypeInfo &type, void *target,
+                   ReadContext &context) {
+    switch (j.type()) {
+    case json::value_t::object: {
+        if (!type.is_object())
+            wrong_type(j, type);
+
+        // one pass over the members, rather than a lookup per field
+        std::uint64_t seen = 0;
+        for (auto it = j.begin(); it != j.end(); ++it) {
+            auto index = type.find(it.key());
+            if (index == type.field_count || it->is_null())
+                continue;
+
+            auto &field = type.fields[index];
+            read_document(*it, *field.type, field.member(target), context);
+            seen |= std::uint64_t{1} << index;
+        }
+
+        auto missing = type.required & ~seen;
+        for (std::size_t i = 0; missing != 0; ++i, missing >>= 1) {
+            if (!(missing & 1))
+                continue;
+            auto &field = type.fields[i];
+            auto it = j.find(std::string(field.name));
+            if (it == j.end())
+                (void)j.at(std::string(field.name)); // throws out_of_range
+            wrong_type(*it, *field.type);
+        }
+
+        if (type.on_end)
+            type.on_end(target, seen);
+        return;
+    }
+    case json::value_t::array:
+        if (!type.is_array())
+            wrong_type(j, type);
+        type.reserve(target, j.size(), context);
+        for (auto &element : j)
+            if (!element.is_null())
+                read_document(element, *type.element,
+                              type.emplace_back(target, context), context);
+        return;
+    case json::value_t::string: {
+        if (!type.on_string)
+            wrong_type(j, type);
+        type.on_string(target, j.get_ref<const json::string_t &>(), context);
+        return;
+    }
+    case json::value_t::boolean:
+        // nlohmann::json converts booleans to numbers too
+        if (type.on_bool)
+            type.on_bool(target, j.get<bool>());
+        else if (type.on_integer)
+            type.on_integer(target, j.get<bool>());
+        else
+            wrong_type(j, type);
+        return;
+    case json::value_t::number_integer:
+        if (!type.on_integer)
+            wrong_type(j, type);
+        type.on_integer(target, j.get<json::number_integer_t>());
+        return;
+    case json::value_t::number_unsigned:
+        if (!type.on_unsigned)
+            wrong_type(j, type);
+        type.on_unsigned(target, j.get<json::number_unsigned_t>());
+        return;
+    case json::value_t::number_float:
+        if (!type.on_float)
+            wrong_type(j, type);
+        type.on_float(target, j.get<json::number_float_t>());
+        return;
+    case json::value_t::null:
+        return;
+    default:
+        wrong_type(j, type);
+    }
+}
+
+void write_document(const TypeInfo &type, const void *source, json &j) {
+    if (type.is_object()) {
+        j = json::object();
+        std::vector<const void *> written;
+        for (std::size_t i = 0; i < type.field_count; ++i) {
+            auto &field = type.fields[i];
+            // fields only add to the object, the member is not changed
+            const void *member = field.member(const_cast<void *>(source));
+            if (std::ranges::find(written, member) != written.end())
+                continue;
+            written.push_back(member);
+            write_document(*field.type, member, j[std::string(field.name)]);
+        }
+    } else if (type.is_array() && type.size) {
+        j = json::array();
+        for (std::size_t i = 0, n = type.size(source); i < n; ++i)
+            write_document(*type.element, type.at(source, i), j.emplace_back());
+    } else if (type.write) {
+        type.write(source, j);
+    }
+}
+
+} // namespace uboat::detail
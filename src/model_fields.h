@@ -0,0 +1,1010 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \model_fields.h
+/// Field tables of the models, describing how the members of every model
+/// are named in the responses and how JSON values are stored into them.
+/// They drive the streaming readers, which fill the models in one pass
+/// without building a JSON document first, and the from_json functions.
+/// Keys are looked up through a perfect hash computed at compile time.
+//
+
+#ifndef UBOAT_MODEL_FIELDS_H
+#define UBOAT_MODEL_FIELDS_H
+
+#include "string_arena.h"
+#include "uboat/song_table.h"
+#include "uboat/uboat.h"
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace uboat::detail {
+
+struct TypeInfo;
+
+/// State of one read shared by the handlers
+struct ReadContext {
+    StringArena *strings = nullptr; /* storage of std::string_view members */
+    std::pmr::memory_resource *resource = nullptr; /* of the pmr models */
+};
+
+/// hash of a key, FNV-1a starting from seed
+constexpr std::uint32_t key_hash(std::string_view key, std::uint32_t seed) {
+    std::uint32_t h = 2166136261u ^ seed;
+    for (char c : key) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+/// A member of a model
+struct FieldInfo {
+    std::string_view name;        /* key in the response */
+    void *(*member)(void *object); /* address of the member in object */
+    const TypeInfo *type;          /* type of the member */
+    bool required;                 /* missing key is an error */
+};
+
+/// How JSON values are stored into a C++ type. Handlers of JSON types the
+/// C++ type cannot hold are null.
+struct TypeInfo {
+    // scalars
+    void (*on_string)(void *target, std::string_view value,
+                      ReadContext &context) = nullptr;
+    void (*on_integer)(void *target, std::int64_t value) = nullptr;
+    void (*on_unsigned)(void *target, std::uint64_t value) = nullptr;
+    void (*on_float)(void *target, double value) = nullptr;
+    void (*on_bool)(void *target, bool value) = nullptr;
+
+    // arrays
+    const TypeInfo *element = nullptr;
+    void *(*emplace_back)(void *array, ReadContext &context) = nullptr;
+    void (*reserve)(void *array, std::size_t size,
+                    ReadContext &context) = nullptr;
+
+    // objects
+    const FieldInfo *fields = nullptr;
+    std::size_t field_count = 0;
+    std::uint64_t required = 0; /* bit i is set if fields[i] is required */
+    void (*on_end)(void *object, std::uint64_t seen) = nullptr;
+
+    // writing back, see write_document(). Null for the types only read.
+    void (*write)(const void *source, nlohmann::json &j) = nullptr;
+    std::size_t (*size)(const void *array) = nullptr;
+    const void *(*at)(const void *array, std::size_t i) = nullptr;
+
+    // perfect hash of the field names, searched linearly without it
+    const std::uint8_t *slots = nullptr; /* field index + 1, 0 if empty */
+    std::uint32_t slot_mask = 0;
+    std::uint32_t seed = 0;
+
+    // pmr models, see in_resource(). Moves the empty pmr members of target
+    // and of its members to resource.
+    void (*adopt)(void *target, std::pmr::memory_resource *resource) = nullptr;
+
+    bool is_object() const { return fields != nullptr; }
+    bool is_array() const { return element != nullptr; }
+
+    /// \return the index of the field named key, or field_count
+    std::size_t find(std::string_view key) const {
+        if (slots) {
+            auto slot = slots[key_hash(key, seed) & slot_mask];
+            if (slot != 0 && fields[slot - 1].name == key)
+                return slot - 1;
+            return field_count;
+        }
+        for (std::size_t i = 0; i < field_count; ++i)
+            if (fields[i].name == key)
+                return i;
+        return field_count;
+    }
+};
+
+inline constexpr bool REQUIRED = true;
+
+template <std::size_t N>
+constexpr std::uint64_t required_mask(const std::array<FieldInfo, N> &fields) {
+    static_assert(N <= 64, "too many fields for the required mask");
+    std::uint64_t mask = 0;
+    for (std::size_t i = 0; i < N; ++i)
+        if (fields[i].required)
+            mask |= std::uint64_t{1} << i;
+    return mask;
+}
+
+/// a hash table of 4 slots per field at least, mostly empty so a seed
+/// without collisions is found after a few tries
+template <std::size_t N> struct PerfectHash {
+    static constexpr std::size_t SIZE = std::bit_ceil(N * 4);
+    std::uint32_t seed = 0;
+    std::array<std::uint8_t, SIZE> slots{};
+};
+
+template <std::size_t N>
+constexpr PerfectHash<N> perfect_hash(const std::array<FieldInfo, N> &fields) {
+    static_assert(N < 255, "too many fields for the slot type");
+    PerfectHash<N> hash;
+    for (;; ++hash.seed) {
+        hash.slots = {};
+        bool collision = false;
+        for (std::size_t i = 0; i < N && !collision; ++i) {
+            auto h = key_hash(fields[i].name, hash.seed) & (hash.SIZE - 1);
+            auto &slot = hash.slots[h];
+            collision = slot != 0;
+            slot = static_cast<std::uint8_t>(i + 1);
+        }
+        if (!collision)
+            return hash;
+    }
+}
+
+template <class T, std::size_t N, std::size_t M>
+constexpr std::array<T, N + M> concat(const std::array<T, N> &a,
+                                      const std::array<T, M> &b) {
+    std::array<T, N + M> r{};
+    for (std::size_t i = 0; i < N; ++i)
+        r[i] = a[i];
+    for (std::size_t i = 0; i < M; ++i)
+        r[N + i] = b[i];
+    return r;
+}
+
+/// field table of a model, specialized for every model below
+template <class T> struct Model;
+
+/// type description of a C++ type
+template <class T> struct Type;
+
+template <> struct Type<std::string> {
+    static constexpr TypeInfo info{
+        .on_string = [](void *t, std::string_view v, ReadContext &) {
+            static_cast<std::string *>(t)->assign(v);
+        },
+        .write = [](const void *t, nlohmann::json &j) {
+            j = *static_cast<const std::string *>(t);
+        }};
+};
+
+template <> struct Type<Symbol> {
+    static constexpr TypeInfo info{
+        .on_string = [](void *t, std::string_view v, ReadContext &) {
+            *static_cast<Symbol *>(t) = v;
+        },
+        .write = [](const void *t, nlohmann::json &j) {
+            j = static_cast<const Symbol *>(t)->str();
+        }};
+};
+
+// the view models reference strings copied to the arena of the read
+template <> struct Type<std::string_view> {
+    static constexpr TypeInfo info{
+        .on_string = [](void *t, std::string_view v, ReadContext &context) {
+            *static_cast<std::string_view *>(t) = context.strings->store(v);
+        },
+        .write = [](const void *t, nlohmann::json &j) {
+            j = *static_cast<const std::string_view *>(t);
+        }};
+};
+
+template <> struct Type<bool> {
+    static constexpr TypeInfo info{
+        .on_bool = [](void *t, bool v) { *static_cast<bool *>(t) = v; },
+        .write = [](const void *t, nlohmann::json &j) {
+            j = *static_cast<const bool *>(t);
+        }};
+};
+
+// numbers convert to any arithmetic member, like nlohmann::json does
+template <class T>
+    requires std::is_arithmetic_v<T>
+struct Type<T> {
+    static constexpr TypeInfo info{
+        .on_integer =
+            [](void *t, std::int64_t v) {
+                *static_cast<T *>(t) = static_cast<T>(v);
+            },
+        .on_unsigned =
+            [](void *t, std::uint64_t v) {
+                *static_cast<T *>(t) = static_cast<T>(v);
+            },
+        .on_float =
+            [](void *t, double v) { *static_cast<T *>(t) = static_cast<T>(v); },
+        .write = [](const void *t,
+                    nlohmann::json &j) { j = *static_cast<const T *>(t); },
+    };
+};
+
+template <class E> struct Type<std::vector<E>> {
+    static constexpr TypeInfo info{
+        .element = &Type<E>::info,
+        .emplace_back = [](void *v, ReadContext &) -> void * {
+            return &static_cast<std::vector<E> *>(v)->emplace_back();
+        },
+        .reserve = [](void *v, std::size_t size, ReadContext &) {
+            static_cast<std::vector<E> *>(v)->reserve(size);
+        },
+        .size = [](const void *v) {
+            return static_cast<const std::vector<E> *>(v)->size();
+        },
+        .at = [](const void *v, std::size_t i) -> const void * {
+            return &(*static_cast<const std::vector<E> *>(v))[i];
+        }};
+};
+
+/// The pmr models are plain aggregates, their members are constructed with
+/// the default resource, which allocates nothing while they are empty. The
+/// data of a response and each element of its vectors are moved to the
+/// resource of the read as they are constructed (TypeInfo::adopt), members
+/// the response leaves empty included, so a whole model ends up in that
+/// resource.
+template <class C> C &in_resource(void *t, std::pmr::memory_resource *resource) {
+    auto *c = static_cast<C *>(t);
+    if (resource && c->empty() && c->get_allocator().resource() != resource) {
+        std::destroy_at(c);
+        std::construct_at(c, resource);
+    }
+    return *c;
+}
+
+template <> struct Type<std::pmr::string> {
+    static constexpr TypeInfo info{
+        .on_string = [](void *t, std::string_view v, ReadContext &context) {
+            in_resource<std::pmr::string>(t, context.resource).assign(v);
+        },
+        .write = [](const void *t, nlohmann::json &j) {
+            j = std::string_view(*static_cast<const std::pmr::string *>(t));
+        },
+        .adopt = [](void *t, std::pmr::memory_resource *resource) {
+            in_resource<std::pmr::string>(t, resource);
+        }};
+};
+
+template <class E> struct Type<std::pmr::vector<E>> {
+    static constexpr TypeInfo info{
+        .element = &Type<E>::info,
+        .emplace_back = [](void *v, ReadContext &context) -> void * {
+            auto &e = in_resource<std::pmr::vector<E>>(v, context.resource)
+                          .emplace_back();
+            // aggregates do not take the allocator of the vector
+            if (context.resource && Type<E>::info.adopt)
+                Type<E>::info.adopt(&e, context.resource);
+            return &e;
+        },
+        .reserve = [](void *v, std::size_t size, ReadContext &context) {
+            in_resource<std::pmr::vector<E>>(v, context.resource).reserve(size);
+        },
+        .size = [](const void *v) {
+            return static_cast<const std::pmr::vector<E> *>(v)->size();
+        },
+        .at = [](const void *v, std::size_t i) -> const void * {
+            return &(*static_cast<const std::pmr::vector<E> *>(v))[i];
+        },
+        .adopt = [](void *v, std::pmr::memory_resource *resource) {
+            in_resource<std::pmr::vector<E>>(v, resource);
+        }};
+};
+
+template <class T>
+    requires requires { Model<T>::fields; }
+struct Type<T> {
+    static constexpr auto hash = perfect_hash(Model<T>::fields);
+    static constexpr TypeInfo info{
+        .fields = Model<T>::fields.data(),
+        .field_count = Model<T>::fields.size(),
+        .required = required_mask(Model<T>::fields),
+        .slots = hash.slots.data(),
+        .slot_mask = hash.SIZE - 1,
+        .seed = hash.seed,
+        .adopt = [](void *o, std::pmr::memory_resource *resource) {
+            for (auto const &f : Model<T>::fields)
+                if (f.type->adopt)
+                    f.type->adopt(f.member(o), resource);
+        }};
+};
+
+/// describe the member Member of T, T may be derived from the member's class
+template <class T, auto Member>
+constexpr FieldInfo field(std::string_view name, bool required = false) {
+    using V = std::remove_cvref_t<decltype(std::declval<T &>().*Member)>;
+    return FieldInfo{
+        name,
+        [](void *o) -> void * { return &(static_cast<T *>(o)->*Member); },
+        &Type<V>::info, required};
+}
+
+// artist
+
+// The field lists shared by a model and its view take the class declaring
+// the members as C, and the class read into as T
+
+template <class T, class C = T> constexpr auto artist_fields() {
+    return std::to_array<FieldInfo>({
+        field<T, &C::id>("id", REQUIRED),
+        field<T, &C::name>("name", REQUIRED),
+        field<T, &C::coverArt>("coverArt"),
+        field<T, &C::artistImageUrl>("artistImageUrl"),
+        field<T, &C::albumCount>("albumCount"),
+        field<T, &C::userRating>("userRating"),
+        field<T, &C::starred>("starred"),
+        field<T, &C::musicBrainzId>("musicBrainzId"),
+        field<T, &C::sortName>("sortName"),
+        field<T, &C::roles>("roles"),
+    });
+}
+
+template <> struct Model<artist::ArtistID3> {
+    static constexpr auto fields = artist_fields<artist::ArtistID3>();
+};
+
+template <> struct Model<artist::ArtistID3View> {
+    static constexpr auto fields = artist_fields<artist::ArtistID3View>();
+};
+
+template <> struct Model<artist::ArtistInfo2> {
+    using T = artist::ArtistInfo2;
+    static constexpr auto fields = std::to_array<FieldInfo>({
+        field<T, &T::biography>("biography"),
+        field<T, &T::musicBrainzId>("musicBrainzId"),
+        field<T, &T::lastFmUrl>("lastFmUrl"),
+        field<T, &T::smallImageUrl>("smallImageUrl"),
+        field<T, &T::mediumImageUrl>("mediumImageUrl"),
+        field<T, &T::largeImageUrl>("largeImageUrl"),
+        field<T, &T::similarArtist>("similarArtist"),
+    });
+};
+
+template <class T> constexpr auto index_fields() {
+    return std::to_array<FieldInfo>({
+        field<T, &T::name>("name", REQUIRED),
+        field<T, &T::artist>("artist", REQUIRED),
+    });
+}
+
+template <> struct Model<artist::IndexID3> {
+    static constexpr auto fields = index_fields<artist::IndexID3>();
+};
+
+template <class T> constexpr auto artists_fields() {
+    return std::to_array<FieldInfo>({
+        field<T, &T::ignoredArticles>("ignoredArticles", REQUIRED),
+        field<T, &T::index>("index"),
+    });
+}
+
+template <> struct Model<artist::Artists> {
+    static constexpr auto fields = artists_fields<artist::Artists>();
+};
+
+template <class T> constexpr auto indexes_fields() {
+    return std::to_array<FieldInfo>({
+        field<T, &T::ignoredArticles>("ignoredArticles", REQUIRED),
+        field<T, &T::lastModified>("lastModified", REQUIRED),
+        field<T, &T::shortcut>("shortcut"),
+        field<T, &T::index>("index"),
+    });
+}
+
+template <> struct Model<artist::Indexes> {
+    static constexpr auto fields = indexes_fields<artist::Indexes>();
+};
+
+// misc
+
+template <> struct Model<misc::Genre> {
+    using T = misc::Genre;
+    static constexpr auto fields = std::to_array<FieldInfo>({
+        field<T, &T::value>("value", REQUIRED),
+        field<T, &T::songCount>("songCount", REQUIRED),
+        field<T, &T::albumCount>("albumCount", REQUIRED),
+    });
+};
+
+template <> struct Model<misc::Genres> {
+    using T = misc::Genres;
+    static constexpr auto fields = std::to_array<FieldInfo>({
+        field<T, &T::genre>("genre"),
+    });
+};
+
+template <> struct Model<misc::MusicFolder> {
+    using T = misc::MusicFolder;
+    static constexpr auto fields = std::to_array<FieldInfo>({
+        field<T, &T::id>("id", REQUIRED),
+        field<T, &T::name>("name"),
+    });
+};
+
+template <> struct Model<misc::MusicFolders> {
+    using T = misc::MusicFolders;
+    static constexpr auto fields = std::to_array<FieldInfo>({
+        field<T, &T::musicFolder>("musicFolder"),
+    });
+};
+
+template <class T> constexpr auto name_fields() {
+    return std::to_array<FieldInfo>({
+        field<T, &T::name>("name", REQUIRED),
+    });
+}
+
+template <> struct Model<misc::RecordLabel> {
+    static constexpr auto fields = name_fields<misc::RecordLabel>();
+};
+
+template <> struct Model<misc::RecordLabelView> {
+    static constexpr auto fields = name_fields<misc::RecordLabelView>();
+};
+
+template <> struct Model<misc::ItemGenre> {
+    static constexpr auto fields = name_fields<misc::ItemGenre>();
+};
+
+template <> struct Model<misc::ItemGenreView> {
+    static constexpr auto fields = name_fields<misc::ItemGenreView>();
+};
+
+template <> struct Model<misc::ItemDate> {
+    using T = misc::ItemDate;
+    static constexpr auto fields = std::to_array<FieldInfo>({
+        field<T, &T::year>("year"),
+        field<T, &T::month>("month"),
+        field<T, &T::day>("day"),
+    });
+};
+
+template <class T> constexpr auto disc_title_fields() {
+    return std::to_array<FieldInfo>({
+        field<T, &T::disc>("disc", REQUIRED),
+        field<T, &T::title>("title", REQUIRED),
+    });
+}
+
+template <> struct Model<misc::DiscTitle> {
+    static constexpr auto fields = disc_title_fields<misc::DiscTitle>();
+};
+
+template <> struct Model<misc::DiscTitleView> {
+    static constexpr auto fields = disc_title_fields<misc::DiscTitleView>();
+};
+
+template <> struct Model<misc::ReplayGain> {
+    using T = misc::ReplayGain;
+    static constexpr auto fields = std::to_array<FieldInfo>({
+        field<T, &T::trackGain>("trackGain"),
+        field<T, &T::albumGain>("albumGain"),
+        field<T, &T::trackPeak>("trackPeak"),
+        field<T, &T::albumPeak>("albumPeak"),
+        field<T, &T::baseGain>("baseGain"),
+        field<T, &T::fallbackGain>("fallbackGain"),
+    });
+};
+
+// media
+
+template <class T, class C = T> constexpr auto child_fields() {
+    return std::to_array<FieldInfo>({
+        field<T, &C::id>("id", REQUIRED),
+        field<T, &C::parent>("parent"),
+        field<T, &C::isDir>("isDir", REQUIRED),
+        field<T, &C::title>("title", REQUIRED),
+        field<T, &C::album>("album"),
+        field<T, &C::artist>("artist"),
+        field<T, &C::track>("track"),
+        field<T, &C::year>("year"),
+        field<T, &C::genre>("genre"),
+        field<T, &C::coverArt>("coverArt"),
+        field<T, &C::size>("size"),
+        field<T, &C::contentType>("contentType"),
+        field<T, &C::suffix>("suffix"),
+        field<T, &C::transcodedContentType>("transcodedContentType"),
+        field<T, &C::transcodedSuffix>("transcodedSuffix"),
+        field<T, &C::duration>("duration"),
+        field<T, &C::bitRate>("bitRate"),
+        field<T, &C::bitDepth>("bitDepth"),
+        field<T, &C::samplingRate>("samplingRate"),
+        field<T, &C::channelCount>("channelCount"),
+        field<T, &C::path>("path"),
+        field<T, &C::isVideo>("isVideo"),
+        field<T, &C::userRating>("userRating"),
+        field<T, &C::averageRating>("averageRating"),
+        field<T, &C::playCount>("playCount"),
+        field<T, &C::discNumber>("discNumber"),
+        field<T, &C::created>("created"),
+        field<T, &C::starred>("starred"),
+        field<T, &C::albumId>("albumId"),
+        field<T, &C::artistId>("artistId"),
+        field<T, &C::type>("type"),
+        field<T, &C::mediaType>("mediaType"),
+        field<T, &C::bookmarkPosition>("bookmarkPosition"),
+        field<T, &C::originalWidth>("originalWidth"),
+        field<T, &C::originalHeight>("originalHeight"),
+        field<T, &C::played>("played"),
+        field<T, &C::bpm>("bpm"),
+        field<T, &C::comment>("comment"),
+        field<T, &C::sortName>("sortName"),
+        field<T, &C::musicBrainzId>("musicBrainzId"),
+        field<T, &C::genres>("genres"),
+        field<T, &C::artists>("artists"),
+        field<T, &C::displayArtist>("displayArtist"),
+        field<T, &C::albumArtists>("albumArtists"),
+        field<T, &C::displayAlbumArtist>("displayAlbumArtist"),
+        field<T, &C::replayGain>("replayGain"),
+    });
+}
+
+template <> struct Model<media::Child> {
+    static constexpr auto fields = child_fields<media::Child>();
+};
+
+template <> struct Model<media::ChildView> {
+    static constexpr auto fields = child_fields<media::ChildView>();
+};
+
+template <class T, class C = media::Child>
+constexpr auto now_playing_entry_fields() {
+    return concat(child_fields<T, C>(), std::to_array<FieldInfo>({
+                                            field<T, &T::username>("username",
+                                                                   REQUIRED),
+                                            field<T, &T::minutesAgo>(
+                                                "minutesAgo"),
+                                            field<T, &T::playerId>("playerId"),
+                                            field<T, &T::playerName>(
+                                                "playerName"),
+                                        }));
+}
+
+template <> struct Model<media::NowPlayingEntry> {
+    static constexpr auto fields =
+        now_playing_entry_fields<media::NowPlayingEntry>();
+};
+
+template <class T> constexpr auto song_fields() {
+    return std::to_array<FieldInfo>({
+        field<T, &T::song>("song"),
+    });
+}
+
+template <> struct Model<media::RandomSongs> {
+    static constexpr auto fields = song_fields<media::RandomSongs>();
+};
+
+template <> struct Model<media::RandomSongsView> {
+    static constexpr auto fields = song_fields<media::RandomSongsView>();
+};
+
+template <class T> constexpr auto now_playing_fields() {
+    return std::to_array<FieldInfo>({
+        field<T, &T::entry>("entry"),
+    });
+}
+
+template <> struct Model<media::NowPlaying> {
+    static constexpr auto fields = now_playing_fields<media::NowPlaying>();
+};
+
+template <> struct Model<media::SimilarSongs2> {
+    static constexpr auto fields = song_fields<media::SimilarSongs2>();
+};
+
+template <> struct Model<media::TopSongs> {
+    static constexpr auto fields = song_fields<media::TopSongs>();
+};
+
+// album
+
+template <class T, class C = T> constexpr auto album_fields() {
+    return std::to_array<FieldInfo>({
+        field<T, &C::id>("id", REQUIRED),
+        field<T, &C::name>("name", REQUIRED),
+        field<T, &C::artist>("artist"),
+        field<T, &C::artistId>("artistId"),
+        field<T, &C::coverArt>("coverArt"),
+        field<T, &C::songCount>("songCount", REQUIRED),
+        field<T, &C::duration>("duration", REQUIRED),
+        field<T, &C::playCount>("playCount"),
+        field<T, &C::created>("created", REQUIRED),
+        field<T, &C::starred>("starred"),
+        field<T, &C::year>("year"),
+        field<T, &C::genre>("genre"),
+        field<T, &C::played>("played"),
+        field<T, &C::changed>("changed"),
+        field<T, &C::userRating>("userRating"),
+        field<T, &C::recordLabels>("recordLabels"),
+        field<T, &C::musicBrainzId>("musicBrainzId"),
+        field<T, &C::genres>("genres"),
+        field<T, &C::artists>("artists"),
+        field<T, &C::displayArtist>("displayArtist"),
+        field<T, &C::releaseTypes>("releaseTypes"),
+        field<T, &C::moods>("moods"),
+        field<T, &C::sortName>("sortName"),
+        field<T, &C::originalReleaseDate>("originalReleaseDate"),
+        field<T, &C::releaseDate>("releaseDate"),
+        field<T, &C::isCompilation>("isCompilation"),
+        field<T, &C::discTitles>("discTitles"),
+    });
+}
+
+template <> struct Model<album::AlbumID3> {
+    static constexpr auto fields = album_fields<album::AlbumID3>();
+};
+
+template <> struct Model<album::AlbumID3View> {
+    static constexpr auto fields = album_fields<album::AlbumID3View>();
+};
+
+template <> struct Model<album::AlbumID3WithSongs> {
+    using T = album::AlbumID3WithSongs;
+    static constexpr auto fields = concat(album_fields<T, album::AlbumID3>(),
+                                          song_fields<T>());
+};
+
+template <> struct Model<album::AlbumID3WithSongsView> {
+    using T = album::AlbumID3WithSongsView;
+    static constexpr auto fields =
+        concat(album_fields<T, album::AlbumID3View>(), song_fields<T>());
+};
+
+template <> struct Model<album::AlbumInfo> {
+    using T = album::AlbumInfo;
+    static constexpr auto fields = std::to_array<FieldInfo>({
+        field<T, &T::notes>("notes"),
+        field<T, &T::musicBrainzId>("musicBrainzId"),
+        field<T, &T::lastFmUrl>("lastFmUrl"),
+        field<T, &T::smallImageUrl>("smallImageUrl"),
+        field<T, &T::mediumImageUrl>("mediumImageUrl"),
+        field<T, &T::largeImageUrl>("largeImageUrl"),
+    });
+};
+
+template <class T> constexpr auto album_list_fields() {
+    return std::to_array<FieldInfo>({
+        field<T, &T::album>("album"),
+    });
+}
+
+template <> struct Model<album::AlbumList2> {
+    static constexpr auto fields = album_list_fields<album::AlbumList2>();
+};
+
+template <> struct Model<album::AlbumList2View> {
+    static constexpr auto fields = album_list_fields<album::AlbumList2View>();
+};
+
+// playlist
+
+template <class T, class P = playlist::Playlist>
+constexpr auto playlist_fields() {
+    return std::to_array<FieldInfo>({
+        field<T, &P::id>("id", REQUIRED),
+        field<T, &P::name>("name", REQUIRED),
+        field<T, &P::comment>("comment"),
+        field<T, &P::owner>("owner"),
+        field<T, &P::isPublic>("public"),
+        field<T, &P::songCount>("songCount", REQUIRED),
+        field<T, &P::duration>("duration", REQUIRED),
+        field<T, &P::created>("created", REQUIRED),
+        field<T, &P::changed>("changed", REQUIRED),
+        field<T, &P::coverArt>("coverArt"),
+        field<T, &P::allowedUser>("allowedUser"),
+    });
+}
+
+template <> struct Model<playlist::Playlist> {
+    static constexpr auto fields = playlist_fields<playlist::Playlist>();
+};
+
+template <class T> constexpr auto playlists_fields() {
+    return std::to_array<FieldInfo>({
+        field<T, &T::playlist>("playlist"),
+    });
+}
+
+template <> struct Model<playlist::Playlists> {
+    static constexpr auto fields = playlists_fields<playlist::Playlists>();
+};
+
+template <> struct Model<playlist::PlaylistWithSongs> {
+    using T = playlist::PlaylistWithSongs;
+    static constexpr auto fields =
+        concat(playlist_fields<T>(), std::to_array<FieldInfo>({
+                                         field<T, &T::entry>("entry"),
+                                     }));
+};
+
+// search
+
+template <class T> constexpr auto search_result_fields() {
+    return std::to_array<FieldInfo>({
+        field<T, &T::artist>("artist"),
+        field<T, &T::album>("album"),
+        field<T, &T::song>("song"),
+    });
+}
+
+template <> struct Model<search::SearchResult3> {
+    static constexpr auto fields =
+        search_result_fields<search::SearchResult3>();
+};
+
+template <> struct Model<search::SearchResult3View> {
+    static constexpr auto fields =
+        search_result_fields<search::SearchResult3View>();
+};
+
+// pmr
+
+template <> struct Model<pmr::ArtistID3> {
+    static constexpr auto fields = artist_fields<pmr::ArtistID3>();
+};
+
+template <> struct Model<pmr::IndexID3> {
+    static constexpr auto fields = index_fields<pmr::IndexID3>();
+};
+
+template <> struct Model<pmr::Artists> {
+    static constexpr auto fields = artists_fields<pmr::Artists>();
+};
+
+template <> struct Model<pmr::Indexes> {
+    static constexpr auto fields = indexes_fields<pmr::Indexes>();
+};
+
+template <> struct Model<pmr::RecordLabel> {
+    static constexpr auto fields = name_fields<pmr::RecordLabel>();
+};
+
+template <> struct Model<pmr::ItemGenre> {
+    static constexpr auto fields = name_fields<pmr::ItemGenre>();
+};
+
+template <> struct Model<pmr::DiscTitle> {
+    static constexpr auto fields = disc_title_fields<pmr::DiscTitle>();
+};
+
+template <> struct Model<pmr::Child> {
+    static constexpr auto fields = child_fields<pmr::Child>();
+};
+
+template <> struct Model<pmr::NowPlayingEntry> {
+    static constexpr auto fields =
+        now_playing_entry_fields<pmr::NowPlayingEntry, pmr::Child>();
+};
+
+template <> struct Model<pmr::RandomSongs> {
+    static constexpr auto fields = song_fields<pmr::RandomSongs>();
+};
+
+template <> struct Model<pmr::NowPlaying> {
+    static constexpr auto fields = now_playing_fields<pmr::NowPlaying>();
+};
+
+template <> struct Model<pmr::SimilarSongs2> {
+    static constexpr auto fields = song_fields<pmr::SimilarSongs2>();
+};
+
+template <> struct Model<pmr::TopSongs> {
+    static constexpr auto fields = song_fields<pmr::TopSongs>();
+};
+
+template <> struct Model<pmr::AlbumID3> {
+    static constexpr auto fields = album_fields<pmr::AlbumID3>();
+};
+
+template <> struct Model<pmr::AlbumID3WithSongs> {
+    using T = pmr::AlbumID3WithSongs;
+    static constexpr auto fields =
+        concat(album_fields<T, pmr::AlbumID3>(), song_fields<T>());
+};
+
+template <> struct Model<pmr::AlbumList2> {
+    static constexpr auto fields = album_list_fields<pmr::AlbumList2>();
+};
+
+template <> struct Model<pmr::Playlist> {
+    static constexpr auto fields =
+        playlist_fields<pmr::Playlist, pmr::Playlist>();
+};
+
+template <> struct Model<pmr::Playlists> {
+    static constexpr auto fields = playlists_fields<pmr::Playlists>();
+};
+
+template <> struct Model<pmr::PlaylistWithSongs> {
+    using T = pmr::PlaylistWithSongs;
+    static constexpr auto fields = concat(
+        playlist_fields<T, pmr::Playlist>(), std::to_array<FieldInfo>({
+                                                 field<T, &T::entry>("entry"),
+                                             }));
+};
+
+template <> struct Model<pmr::SearchResult3> {
+    static constexpr auto fields = search_result_fields<pmr::SearchResult3>();
+};
+
+// song table
+
+// the string columns take the string of the last row
+template <> struct Type<TextColumn> {
+    static constexpr TypeInfo info{
+        .on_string = [](void *t, std::string_view v, ReadContext &) {
+            static_cast<TextColumn *>(t)->set_back(v);
+        }};
+};
+
+template <> struct Type<DictionaryColumn> {
+    static constexpr TypeInfo info{
+        .on_string = [](void *t, std::string_view v, ReadContext &) {
+            static_cast<DictionaryColumn *>(t)->set_back(v);
+        }};
+};
+
+/// describe the last row of the column Column of a SongTable
+template <auto Column> constexpr FieldInfo column(std::string_view name) {
+    using C =
+        std::remove_cvref_t<decltype(std::declval<SongTable &>().*Column)>;
+    if constexpr (requires { typename C::value_type; })
+        return FieldInfo{name,
+                         [](void *t) -> void * {
+                             return &(static_cast<SongTable *>(t)->*Column)
+                                         .back();
+                         },
+                         &Type<typename C::value_type>::info, false};
+    else
+        return FieldInfo{name,
+                         [](void *t) -> void * {
+                             return &(static_cast<SongTable *>(t)->*Column);
+                         },
+                         &Type<C>::info, false};
+}
+
+/// A SongTable reads as an array of songs: every song adds a row of empty
+/// strings and zeros, and its fields go to the last row of the columns.
+/// Fields without a column are skipped.
+template <> struct Type<SongTable> {
+    using T = SongTable;
+    static constexpr auto fields = std::to_array<FieldInfo>({
+        column<&T::m_id>("id"),
+        column<&T::m_parent>("parent"),
+        column<&T::m_title>("title"),
+        column<&T::m_album>("album"),
+        column<&T::m_artist>("artist"),
+        column<&T::m_track>("track"),
+        column<&T::m_year>("year"),
+        column<&T::m_genre>("genre"),
+        column<&T::m_coverArt>("coverArt"),
+        column<&T::m_size>("size"),
+        column<&T::m_contentType>("contentType"),
+        column<&T::m_suffix>("suffix"),
+        column<&T::m_duration>("duration"),
+        column<&T::m_bitRate>("bitRate"),
+        column<&T::m_bitDepth>("bitDepth"),
+        column<&T::m_samplingRate>("samplingRate"),
+        column<&T::m_channelCount>("channelCount"),
+        column<&T::m_path>("path"),
+        column<&T::m_userRating>("userRating"),
+        column<&T::m_playCount>("playCount"),
+        column<&T::m_discNumber>("discNumber"),
+        column<&T::m_created>("created"),
+        column<&T::m_albumId>("albumId"),
+        column<&T::m_artistId>("artistId"),
+        column<&T::m_type>("type"),
+        column<&T::m_mediaType>("mediaType"),
+        column<&T::m_bpm>("bpm"),
+        column<&T::m_displayArtist>("displayArtist"),
+    });
+    static constexpr auto hash = perfect_hash(fields);
+
+    static constexpr TypeInfo row{.fields = fields.data(),
+                                  .field_count = fields.size(),
+                                  .slots = hash.slots.data(),
+                                  .slot_mask = hash.SIZE - 1,
+                                  .seed = hash.seed};
+
+    static constexpr TypeInfo info{
+        .element = &row,
+        .emplace_back = [](void *t, ReadContext &) -> void * {
+            static_cast<T *>(t)->push_default();
+            return t;
+        },
+        .reserve = [](void *t, std::size_t size, ReadContext &) {
+            auto *table = static_cast<T *>(t);
+            table->reserve(table->size() + size);
+        }};
+};
+
+/// Data of the responses read into a SongTable, the songs are under "song"
+/// (getRandomSongs, search3, getAlbum) or "entry" (getPlaylist)
+struct SongTableData {
+    SongTable songs;
+};
+
+template <> struct Model<SongTableData> {
+    using T = SongTableData;
+    static constexpr auto fields = std::to_array<FieldInfo>({
+        field<T, &T::songs>("song"),
+        field<T, &T::songs>("entry"),
+    });
+};
+
+// server
+
+template <> struct Model<server::Error> {
+    using T = server::Error;
+    static constexpr auto fields = std::to_array<FieldInfo>({
+        field<T, &T::code>("code", REQUIRED),
+        field<T, &T::message>("message", REQUIRED),
+    });
+};
+
+template <> struct Model<server::License> {
+    using T = server::License;
+    static constexpr auto fields = std::to_array<FieldInfo>({
+        field<T, &T::valid>("valid", REQUIRED),
+        field<T, &T::email>("email"),
+        field<T, &T::licenseExpires>("licenseExpires"),
+        field<T, &T::trialExpires>("trialExpires"),
+    });
+};
+
+template <> struct Model<server::OpenSubsonicExtension> {
+    using T = server::OpenSubsonicExtension;
+    static constexpr auto fields = std::to_array<FieldInfo>({
+        field<T, &T::name>("name", REQUIRED),
+        field<T, &T::versions>("versions", REQUIRED),
+    });
+};
+
+// the data member is read from a key only known at runtime
+template <class Data, class T = server::SubsonicResponse<Data>>
+constexpr auto envelope_fields() {
+    using R = server::SubsonicResponse<Data>;
+    return std::to_array<FieldInfo>({
+        field<T, &R::status>("status", REQUIRED),
+        field<T, &R::version>("version", REQUIRED),
+        field<T, &R::type>("type", REQUIRED),
+        field<T, &R::serverVersion>("serverVersion", REQUIRED),
+        field<T, &R::openSubsonic>("openSubsonic", REQUIRED),
+        field<T, &R::error>("error"),
+    });
+}
+
+template <class Data> struct Model<server::SubsonicResponse<Data>> {
+    static constexpr auto fields = envelope_fields<Data>();
+};
+
+/// Fill target, a value of the type described by type, from a parsed
+/// document, for the from_json functions. Unknown keys and null values are
+/// skipped, other errors throw the exceptions of nlohmann::json.
+void read_document(const nlohmann::json &j, const TypeInfo &type,
+                   void *target, ReadContext &context);
+
+template <class T> void read_document(const nlohmann::json &j, T &value) {
+    ReadContext context;
+    read_document(j, Type<T>::info, &value, context);
+}
+
+/// Write source, a value of the type described by type, to j under the keys
+/// it is read from, so read_document() reads it back. Members read from
+/// several keys are written under the first one, members of types which are
+/// only read are left null.
+void write_document(const TypeInfo &type, const void *source,
+                    nlohmann::json &j);
+
+template <class T> nlohmann::json write_document(const T &value) {
+    nlohmann::json j;
+    write_document(Type<T>::info, &value, j);
+    return j;
+}
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_MODEL_FIELDS_H */
@@ -0,0 +1,67 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "request_query.h"
+#include "uboat/uboat.h"
+#include <cctype>
+
+void uboat::detail::append_encoded(std::string &out, std::string_view value) {
+    static constexpr char HEX[] = "0123456789ABCDEF";
+    for (unsigned char c : value) {
+        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            out += static_cast<char>(c);
+        } else {
+            out += '%';
+            out += HEX[c >> 4];
+            out += HEX[c & 0x0F];
+        }
+    }
+}
+
+std::string uboat::detail::auth_query(std::string_view username,
+                                      std::string_view token,
+                                      std::string_view salt,
+                                      std::string_view client_name) {
+    std::string query = "u=";
+    append_encoded(query, username);
+    query += "&t=";
+    append_encoded(query, token);
+    query += "&s=";
+    append_encoded(query, salt);
+    query += "&v=";
+    append_encoded(query, API_VERSION);
+    query += "&c=";
+    append_encoded(query, client_name);
+    query += "&f=json";
+    return query;
+}
+
+std::string uboat::detail::api_key_query(std::string_view api_key,
+                                         std::string_view client_name) {
+    std::string query = "apiKey=";
+    append_encoded(query, api_key);
+    query += "&v=";
+    append_encoded(query, API_VERSION);
+    query += "&c=";
+    append_encoded(query, client_name);
+    query += "&f=json";
+    return query;
+}
+
+std::string_view uboat::detail::empty_param(std::string_view endpoint) {
+    return endpoint == "search3" ? "query" : "";
+}
+
+void uboat::detail::append_params(
+    std::string &out, const std::multimap<std::string, std::string> &params,
+    std::string_view keep) {
+    for (auto const &[name, value] : params) {
+        if (value.empty() && name != keep)
+            continue;
+        out += '&';
+        append_encoded(out, name);
+        out += '=';
+        append_encoded(out, value);
+    }
+}
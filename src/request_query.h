@@ -0,0 +1,45 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \request_query.h
+/// Query strings of the requests: the params every request carries, encoded
+/// once per client, followed by the params of the endpoint.
+//
+
+#ifndef UBOAT_REQUEST_QUERY_H
+#define UBOAT_REQUEST_QUERY_H
+
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace uboat::detail {
+
+/// append value to out, percent-encoding everything but the unreserved
+/// characters of RFC 3986
+void append_encoded(std::string &out, std::string_view value);
+
+/// the encoded params every request starts with: the credentials, the API
+/// version, the client name and the format
+std::string auth_query(std::string_view username, std::string_view token,
+                       std::string_view salt, std::string_view client_name);
+
+/// the encoded params every request starts with when authenticating with an
+/// API key instead of a password
+std::string api_key_query(std::string_view api_key,
+                          std::string_view client_name);
+
+/// the param of endpoint sent even without a value, because its empty value
+/// means something (search3 returns everything for an empty query), or an
+/// empty name if there is none
+std::string_view empty_param(std::string_view endpoint);
+
+/// append "&name=value" to out for each param, the params without a value
+/// are left out as if they were not given, but for keep
+void append_params(std::string &out,
+                   const std::multimap<std::string, std::string> &params,
+                   std::string_view keep = {});
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_REQUEST_QUERY_H */
@@ -0,0 +1,339 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "response_cache.h"
+#include <algorithm>
+#include <utility>
+
+using namespace uboat::detail;
+
+namespace {
+
+// the stale policies of options, but for the default ones of the endpoints
+// given a ttl of their own, which replaces them
+std::map<std::string, uboat::StalePolicy, std::less<>>
+stale_policies(const uboat::CacheOptions &options) {
+    static const uboat::CacheOptions defaults;
+    std::map<std::string, uboat::StalePolicy, std::less<>> policies;
+    for (auto const &[name, policy] : options.stale) {
+        auto endpoint = name.substr(0, name.find('?'));
+        auto ttl = options.ttl.find(endpoint);
+        auto default_ttl = defaults.ttl.find(endpoint);
+        bool own_ttl = ttl != options.ttl.end() &&
+                       (default_ttl == defaults.ttl.end() ||
+                        default_ttl->second != ttl->second);
+        auto default_policy = defaults.stale.find(name);
+        if (own_ttl && default_policy != defaults.stale.end() &&
+            default_policy->second == policy)
+            continue;
+        policies.emplace(name, policy);
+    }
+    return policies;
+}
+
+// the longest a body may be read from the cache directory after it was
+// stored: the longest hard TTL, within max_disk_age
+ResponseCache::clock::duration
+longest_lifetime(const uboat::CacheOptions &options) {
+    ResponseCache::clock::duration longest{};
+    for (auto const &[endpoint, ttl] : options.ttl)
+        longest = std::max<ResponseCache::clock::duration>(longest, ttl);
+    for (auto const &[name, policy] : options.stale)
+        longest = std::max<ResponseCache::clock::duration>(longest,
+                                                           policy.hard_ttl);
+    return std::min<ResponseCache::clock::duration>(longest,
+                                                    options.max_disk_age);
+}
+
+} // namespace
+
+ResponseCache::ResponseCache(const CacheOptions &options, std::string scope)
+    : m_max_bytes(options.max_bytes),
+      m_ttl(options.ttl.begin(), options.ttl.end()),
+      m_stale(stale_policies(options)),
+      m_scope(std::move(scope)),
+      m_longest_lifetime(longest_lifetime(options)) {
+    if (!options.directory.empty())
+        m_disk = std::make_unique<DiskCache>(
+            options.directory, options.max_disk_bytes, options.max_disk_age);
+}
+
+ResponseCache::Lifetime ResponseCache::lifetime(
+    const std::string &endpoint,
+    const std::multimap<std::string, std::string> &params) const {
+    // a policy of the endpoint with one of the params comes first
+    if (!m_stale.empty()) {
+        std::string name;
+        for (auto const &[param, value] : params) {
+            name = endpoint + '?' + param + '=' + value;
+            if (auto it = m_stale.find(name); it != m_stale.end())
+                return {it->second.soft_ttl, it->second.hard_ttl};
+        }
+        if (auto it = m_stale.find(endpoint); it != m_stale.end())
+            return {it->second.soft_ttl, it->second.hard_ttl};
+    }
+
+    auto it = m_ttl.find(endpoint);
+    if (it == m_ttl.end())
+        return {};
+    return {it->second, it->second};
+}
+
+std::string ResponseCache::request_key(
+    const std::string &endpoint,
+    const std::multimap<std::string, std::string> &params) {
+    // the params are ordered by name, repeated ones keep their order, which
+    // matters (e.g. the songs added to a playlist); '\0' never occurs in them
+    std::string key = endpoint;
+    for (auto const &[name, value] : params) {
+        if (value.empty())
+            continue;
+        key += '\0';
+        key += name;
+        key += '=';
+        key += value;
+    }
+    return key;
+}
+
+std::string ResponseCache::dependency(Entity kind, std::string_view id) {
+    static constexpr std::string_view PREFIXES[] = {"song:", "album:",
+                                                    "artist:", "playlist:"};
+    std::string name(PREFIXES[static_cast<std::size_t>(kind)]);
+    name += id;
+    return name;
+}
+
+std::shared_ptr<const void> ResponseCache::lookup(const std::string &key,
+                                                  bool *stale) {
+    List removed;
+    std::lock_guard lock(m_mutex);
+
+    auto it = m_index.find(key);
+    if (it == m_index.end()) {
+        ++m_misses;
+        return nullptr;
+    }
+
+    auto entry = it->second;
+    if (entry->expires <= clock::now()) {
+        remove(entry, removed);
+        ++m_misses;
+        return nullptr;
+    }
+
+    m_lru.splice(m_lru.begin(), m_lru, entry);
+    ++m_hits;
+    bool is_stale = entry->stale <= clock::now();
+    if (is_stale)
+        ++m_stale_hits;
+    if (stale)
+        *stale = is_stale;
+    return entry->value;
+}
+
+void ResponseCache::store(std::string key, std::shared_ptr<const void> value,
+                          std::size_t bytes, Lifetime lifetime,
+                          std::vector<std::string> dependencies, Patch patch) {
+    // the key and the bookkeeping are charged too, so that many tiny
+    // responses cannot grow the cache unbounded
+    bytes += key.size() + sizeof(Entry) + sizeof(List::iterator);
+    for (auto const &d : dependencies)
+        bytes += d.size() + sizeof(std::string) + sizeof(List::iterator);
+    if (bytes > m_max_bytes)
+        return;
+
+    List removed;
+    std::lock_guard lock(m_mutex);
+
+    if (auto it = m_index.find(key); it != m_index.end())
+        remove(it->second, removed);
+
+    while (m_bytes + bytes > m_max_bytes) {
+        remove(std::prev(m_lru.end()), removed);
+        ++m_evictions;
+    }
+
+    auto now = clock::now();
+    m_lru.push_front(Entry{std::move(key), std::move(value), bytes,
+                           now + lifetime.soft, now + lifetime.hard,
+                           std::move(dependencies), patch});
+    m_index.emplace(m_lru.front().key, m_lru.begin());
+    for (auto const &d : m_lru.front().dependencies)
+        m_dependents[d].push_back(m_lru.begin());
+    m_bytes += bytes;
+}
+
+std::vector<ResponseCache::List::iterator> ResponseCache::dependents(
+    const std::vector<std::string> &dependencies) const {
+    std::vector<List::iterator> entries;
+    for (auto const &d : dependencies)
+        if (auto it = m_dependents.find(d); it != m_dependents.end())
+            entries.insert(entries.end(), it->second.begin(),
+                           it->second.end());
+
+    // a response holding several of the entities is listed once per entity
+    auto address = [](List::iterator it) { return &*it; };
+    std::ranges::sort(entries, {}, address);
+    auto duplicates = std::ranges::unique(entries, {}, address);
+    entries.erase(duplicates.begin(), duplicates.end());
+    return entries;
+}
+
+std::optional<Body> ResponseCache::load(const std::string &request,
+                                        Lifetime lifetime,
+                                        clock::duration *age) {
+    if (!m_disk)
+        return std::nullopt;
+    std::chrono::seconds stored;
+    auto body = m_disk->find(m_scope + '\0' + request, &stored);
+    if (!body || stored >= lifetime.hard)
+        return std::nullopt;
+    *age = stored;
+    return body;
+}
+
+bool ResponseCache::restorable(const std::string &key,
+                               const std::vector<std::string> &dependencies,
+                               clock::duration age) {
+    {
+        std::lock_guard lock(m_mutex);
+        // the age is in whole seconds, a write in the second the body was
+        // stored may have come after it
+        auto stored = clock::now() - age - std::chrono::seconds(1);
+        bool changed = std::ranges::any_of(dependencies, [&](auto const &d) {
+            auto it = m_written.find(d);
+            return it != m_written.end() && it->second >= stored;
+        });
+        if (!changed) {
+            ++m_disk_hits;
+            return true;
+        }
+    }
+    erase_bodies({key.substr(key.find('\0') + 1)});
+    return false;
+}
+
+void ResponseCache::save(const std::string &request, const Body &body) {
+    if (m_disk)
+        m_disk->store(m_scope + '\0' + request, body);
+}
+
+bool ResponseCache::begin_refresh(const std::string &key) {
+    std::lock_guard lock(m_mutex);
+    if (!m_refreshing.insert(key).second)
+        return false;
+    ++m_refreshes;
+    return true;
+}
+
+void ResponseCache::end_refresh(const std::string &key) {
+    std::lock_guard lock(m_mutex);
+    m_refreshing.erase(key);
+}
+
+void ResponseCache::invalidate(const std::vector<std::string> &dependencies) {
+    List removed;
+    std::vector<std::string> bodies;
+    {
+        std::lock_guard lock(m_mutex);
+        written(dependencies, bodies);
+        for (auto it : dependents(dependencies)) {
+            remove(it, removed);
+            ++m_invalidations;
+        }
+    }
+    erase_bodies(bodies);
+}
+
+void ResponseCache::patch(const std::vector<std::string> &dependencies,
+                          const Change &change) {
+    List removed;
+    std::vector<std::shared_ptr<const void>> replaced;
+    std::vector<std::string> bodies;
+    {
+        std::lock_guard lock(m_mutex);
+        written(dependencies, bodies);
+        for (auto it : dependents(dependencies)) {
+            auto patched = it->patch ? it->patch(it->value.get(), change)
+                                     : nullptr;
+            if (!patched) {
+                remove(it, removed);
+                ++m_invalidations;
+                continue;
+            }
+            // readers holding the old value keep it, the new one replaces it
+            replaced.push_back(std::exchange(it->value, std::move(patched)));
+            ++m_patches;
+        }
+    }
+    // the patched body is only stored again with the next response
+    erase_bodies(bodies);
+}
+
+void ResponseCache::written(const std::vector<std::string> &dependencies,
+                            std::vector<std::string> &bodies) {
+    if (!m_disk)
+        return;
+    // responses no longer in memory may still be in the cache directory,
+    // they are checked against the time of the write when read from it
+    auto now = clock::now();
+    // no body stored before these writes is read anymore, see restorable()
+    auto oldest = now - m_longest_lifetime - std::chrono::seconds(1);
+    std::erase_if(m_written,
+                  [&](auto const &write) { return write.second < oldest; });
+    for (auto const &d : dependencies)
+        m_written.insert_or_assign(d, now);
+    for (auto it : dependents(dependencies))
+        bodies.push_back(it->key.substr(it->key.find('\0') + 1));
+}
+
+void ResponseCache::erase_bodies(const std::vector<std::string> &bodies) {
+    for (auto const &request : bodies)
+        m_disk->erase(m_scope + '\0' + request);
+}
+
+void ResponseCache::remove(List::iterator it, List &removed) {
+    m_index.erase(it->key);
+    for (auto const &d : it->dependencies) {
+        auto entries = m_dependents.find(d);
+        std::erase(entries->second, it);
+        if (entries->second.empty())
+            m_dependents.erase(entries);
+    }
+    m_bytes -= it->bytes;
+    removed.splice(removed.end(), m_lru, it);
+}
+
+void ResponseCache::clear() {
+    List removed;
+    std::lock_guard lock(m_mutex);
+    m_index.clear();
+    m_dependents.clear();
+    removed.swap(m_lru);
+    m_written.clear();
+    m_bytes = 0;
+    if (m_disk)
+        m_disk->clear();
+}
+
+std::size_t ResponseCache::writes() const {
+    std::lock_guard lock(m_mutex);
+    return m_written.size();
+}
+
+uboat::CacheStats ResponseCache::stats() const {
+    std::lock_guard lock(m_mutex);
+    return CacheStats{m_hits,
+                      m_misses,
+                      m_evictions,
+                      m_invalidations,
+                      m_patches,
+                      m_lru.size(),
+                      m_bytes,
+                      m_stale_hits,
+                      m_refreshes,
+                      m_disk_hits,
+                      m_disk ? m_disk->bytes() : 0};
+}
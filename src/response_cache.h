@@ -0,0 +1,239 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \response_cache.h
+/// An in-memory cache of decoded responses shared by the requests of one
+/// OSClient, bounded in bytes and evicting the least recently used entry.
+/// Entries record the songs, albums, artists and playlists they contain, so
+/// write requests only drop or patch the responses they affect. With a cache
+/// directory, the bodies are also kept on disk across runs.
+//
+
+#ifndef UBOAT_RESPONSE_CACHE_H
+#define UBOAT_RESPONSE_CACHE_H
+
+#include "disk_cache.h"
+#include "uboat/uboat.h"
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace uboat::detail {
+
+/// Kinds of entities a cached response can depend on
+enum class Entity { Song, Album, Artist, Playlist };
+
+/// A change made by a write request, applied to the cached models holding
+/// the entity instead of dropping them
+struct Change {
+    std::string id; /* of the song, album or artist */
+    std::optional<std::size_t> userRating;
+    std::optional<std::string> starred;
+};
+
+class ResponseCache {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// \return a copy of value (a response) with change applied, or null if
+    /// the response cannot be patched and has to be dropped
+    using Patch = std::shared_ptr<const void> (*)(const void *value,
+                                                  const Change &change);
+
+    /// all listings of playlists depend on this, as creating a playlist
+    /// changes them
+    static constexpr std::string_view PLAYLISTS = "playlists";
+
+    /// \param scope tells apart the responses of different servers and users
+    /// in the cache directory
+    explicit ResponseCache(const CacheOptions &options,
+                           std::string scope = {});
+
+    /// How long an entry is used, fresh then stale
+    struct Lifetime {
+        clock::duration soft; /* 0 if the request is not cached */
+        clock::duration hard;
+    };
+
+    /// lifetime of the response to a request
+    Lifetime lifetime(const std::string &endpoint,
+                      const std::multimap<std::string, std::string> &params)
+        const;
+
+    /// key of a request: the endpoint, the params without the empty ones
+    /// (they are not sent, but for the one of empty_param() which every
+    /// request of its endpoint has), and the decoded type, as the same
+    /// request may be read into different models
+    template <class T>
+    static std::string
+    key(const std::string &endpoint,
+        const std::multimap<std::string, std::string> &params) {
+        return typeid(T).name() + ('\0' + request_key(endpoint, params));
+    }
+
+    /// key of a request regardless of its model, for the raw bodies
+    static std::string
+    request_key(const std::string &endpoint,
+                const std::multimap<std::string, std::string> &params);
+
+    /// name of the dependency on an entity
+    static std::string dependency(Entity kind, std::string_view id);
+
+    /// \return the entry of key, or null if there is none or it is past its
+    /// hard TTL
+    /// \param stale set to whether it is past its soft TTL
+    template <class T>
+    std::shared_ptr<const T> find(const std::string &key,
+                                  bool *stale = nullptr) {
+        return std::static_pointer_cast<const T>(lookup(key, stale));
+    }
+
+    /// add or replace the entry of key
+    /// \param bytes what the entry is charged against max_bytes
+    /// \param dependencies the entities in the value, see dependency()
+    /// \param patch updates the value on a change of its entities, the entry
+    /// is dropped instead if null
+    template <class T>
+    void insert(std::string key, std::shared_ptr<const T> value,
+                std::size_t bytes, Lifetime lifetime,
+                std::vector<std::string> dependencies = {},
+                Patch patch = nullptr) {
+        store(std::move(key), std::move(value), bytes, lifetime,
+              std::move(dependencies), patch);
+    }
+
+    /// \return whether the caller is the one to refresh key, false while
+    /// another refresh of it runs
+    bool begin_refresh(const std::string &key);
+    void end_refresh(const std::string &key);
+
+    /// \return the body stored in the cache directory for request (see
+    /// request_key()), if it was stored within lifetime.hard; still
+    /// compressed
+    /// \param age set to how long ago it was stored
+    std::optional<Body> load(const std::string &request, Lifetime lifetime,
+                             clock::duration *age);
+
+    /// add the entry of key read from the cache directory, what is left of
+    /// lifetime after age. A response holding entities changed by a write
+    /// request since it was stored is dropped from the directory instead.
+    /// \return whether the entry was added
+    template <class T>
+    bool restore(std::string key, std::shared_ptr<const T> value,
+                 std::size_t bytes, Lifetime lifetime, clock::duration age,
+                 std::vector<std::string> dependencies, Patch patch) {
+        if (!restorable(key, dependencies, age))
+            return false;
+        store(std::move(key), std::move(value), bytes,
+              {lifetime.soft - age, lifetime.hard - age},
+              std::move(dependencies), patch);
+        return true;
+    }
+
+    /// store the body of request in the cache directory, if there is one,
+    /// as it was received
+    void save(const std::string &request, const Body &body);
+
+    /// whether there is a cache directory
+    bool persistent() const { return m_disk != nullptr; }
+
+    /// drop the entries depending on any of dependencies
+    void invalidate(const std::vector<std::string> &dependencies);
+
+    /// apply change to the entries depending on any of dependencies
+    void patch(const std::vector<std::string> &dependencies,
+               const Change &change);
+
+    void clear();
+
+    CacheStats stats() const;
+
+    /// number of the entities whose last write request is kept to check the
+    /// bodies of the cache directory against
+    std::size_t writes() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const void> value;
+        std::size_t bytes;
+        clock::time_point stale; /* past the soft TTL */
+        clock::time_point expires;
+        std::vector<std::string> dependencies;
+        Patch patch;
+    };
+    using List = std::list<Entry>;
+
+    struct Hash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+
+    std::shared_ptr<const void> lookup(const std::string &key, bool *stale);
+    bool restorable(const std::string &key,
+                    const std::vector<std::string> &dependencies,
+                    clock::duration age);
+    void store(std::string key, std::shared_ptr<const void> value,
+               std::size_t bytes, Lifetime lifetime,
+               std::vector<std::string> dependencies, Patch patch);
+
+    /// entries depending on any of dependencies, each once
+    std::vector<List::iterator>
+    dependents(const std::vector<std::string> &dependencies) const;
+
+    /// unlink an entry, the caller destroys it outside the lock
+    void remove(List::iterator it, List &removed);
+
+    /// note the write request changing dependencies, and collect the
+    /// bodies of entries in the cache directory to drop
+    void written(const std::vector<std::string> &dependencies,
+                 std::vector<std::string> &bodies);
+    void erase_bodies(const std::vector<std::string> &bodies);
+
+    const std::size_t m_max_bytes;
+    const std::map<std::string, std::chrono::milliseconds, std::less<>>
+        m_ttl;
+    const std::map<std::string, StalePolicy, std::less<>> m_stale;
+    const std::string m_scope;
+    const clock::duration m_longest_lifetime; /* of a body in the cache
+                                                 directory */
+    std::unique_ptr<DiskCache> m_disk; /* null without directory */
+
+    mutable std::mutex m_mutex;
+    List m_lru; /* most recently used at the front */
+    std::unordered_map<std::string_view, List::iterator>
+        m_index; /* keys point into the entries */
+    std::unordered_map<std::string, std::vector<List::iterator>, Hash,
+                       std::equal_to<>>
+        m_dependents; /* entries by dependency */
+    std::unordered_set<std::string> m_refreshing;
+    std::unordered_map<std::string, clock::time_point, Hash, std::equal_to<>>
+        m_written; /* last write request changing a dependency, only kept
+                      with a cache directory and within m_longest_lifetime */
+    std::size_t m_bytes = 0;
+
+    std::size_t m_hits = 0;
+    std::size_t m_misses = 0;
+    std::size_t m_evictions = 0;
+    std::size_t m_invalidations = 0;
+    std::size_t m_patches = 0;
+    std::size_t m_stale_hits = 0;
+    std::size_t m_refreshes = 0;
+    std::size_t m_disk_hits = 0;
+};
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_RESPONSE_CACHE_H */
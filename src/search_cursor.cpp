@@ -0,0 +1,74 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "uboat/search_cursor.h"
+#include <algorithm>
+#include <array>
+#include <ranges>
+#include <utility>
+
+using namespace uboat;
+
+namespace {
+
+// the results of a kind in search3 responses, and the position of its count
+// and offset in the params of OSClient::search3Async()
+template <class T> struct Kind;
+
+template <> struct Kind<artist::ArtistID3> {
+    static constexpr auto results = &search::SearchResult3::artist;
+    static constexpr std::size_t param = 0;
+};
+
+template <> struct Kind<album::AlbumID3> {
+    static constexpr auto results = &search::SearchResult3::album;
+    static constexpr std::size_t param = 2;
+};
+
+template <> struct Kind<media::Child> {
+    static constexpr auto results = &search::SearchResult3::song;
+    static constexpr std::size_t param = 4;
+};
+
+// a page of no results would never end
+SearchCursorOptions with_pages(SearchCursorOptions options) {
+    options.page_size = std::max<std::size_t>(options.page_size, 1);
+    return options;
+}
+
+} // namespace
+
+template <class T>
+SearchResults<T>::SearchResults(const OSClient &client,
+                                const std::string &query,
+                                const SearchCursorOptions &options)
+    : m_range(
+          [client = &client, query = &query,
+           folder = &options.musicFolderId](std::size_t offset,
+                                            std::size_t size) {
+              // only this kind is asked for, the counts of the others are 0
+              std::array<std::string, 6> counts{"0", "", "0", "", "0", ""};
+              counts[Kind<T>::param] = std::to_string(size);
+              counts[Kind<T>::param + 1] = std::to_string(offset);
+              return client->search3Async(*query, counts[0], counts[1],
+                                          counts[2], counts[3], counts[4],
+                                          counts[5], *folder);
+          },
+          [](search::SearchResult3 &page) -> std::vector<T> & {
+              return page.*Kind<T>::results;
+          },
+          options.page_size, options.prefetch) {}
+
+template class uboat::SearchResults<artist::ArtistID3>;
+template class uboat::SearchResults<album::AlbumID3>;
+template class uboat::SearchResults<media::Child>;
+
+static_assert(std::ranges::input_range<SearchResults<media::Child>>);
+
+SearchCursor::SearchCursor(const OSClient &client, std::string query,
+                           SearchCursorOptions options)
+    : m_query(std::move(query)), m_options(with_pages(std::move(options))),
+      m_artists(client, m_query, m_options),
+      m_albums(client, m_query, m_options),
+      m_songs(client, m_query, m_options) {}
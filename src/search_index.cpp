@@ -0,0 +1,96 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "uboat/search_index.h"
+#include "inverted_index.h"
+#include <utility>
+
+using namespace uboat;
+
+namespace {
+
+// the results of one kind from offset, as copies of T
+template <class T, class Entries, class Get>
+std::vector<T> page(const detail::InvertedIndex &index, std::string_view query,
+                    std::size_t count, std::size_t offset,
+                    const Entries &entries, Get get) {
+    std::vector<T> results;
+    if (count == 0)
+        return results;
+    auto documents = index.search(query, offset + count);
+    for (std::size_t i = offset; i < documents.size(); ++i)
+        results.push_back(get(entries[documents[i]]));
+    return results;
+}
+
+} // namespace
+
+SearchIndex::SearchIndex(Snapshot snapshot, SearchIndexOptions options)
+    : m_snapshot(std::move(snapshot)), m_options(options),
+      m_artist_index(std::make_unique<detail::InvertedIndex>()),
+      m_album_index(std::make_unique<detail::InvertedIndex>()),
+      m_song_index(std::make_unique<detail::InvertedIndex>()),
+      m_stale(!m_snapshot.complete || m_snapshot.lastModified == 0) {
+    for (auto &artist : m_snapshot.artists)
+        m_artist_index->add({artist.name, artist.sortName});
+    for (auto &album : m_snapshot.albums) {
+        m_album_index->add({album.name, album.sortName});
+        for (auto &song : album.song) {
+            m_songs.push_back(&song);
+            m_song_index->add({song.title, song.sortName});
+        }
+    }
+    m_artist_index->build();
+    m_album_index->build();
+    m_song_index->build();
+}
+
+SearchIndex::~SearchIndex() = default;
+
+search::SearchResult3 SearchIndex::search3(std::string_view query,
+                                           const SearchCounts &counts) const {
+    search::SearchResult3 result;
+    result.artist = page<artist::ArtistID3>(
+        *m_artist_index, query, counts.artistCount, counts.artistOffset,
+        m_snapshot.artists, [](auto &artist) { return artist; });
+    result.album = page<album::AlbumID3>(
+        *m_album_index, query, counts.albumCount, counts.albumOffset,
+        m_snapshot.albums, [](const album::AlbumID3 &album) { return album; });
+    result.song = page<media::Child>(*m_song_index, query, counts.songCount,
+                                     counts.songOffset, m_songs,
+                                     [](auto *song) { return *song; });
+    return result;
+}
+
+std::expected<search::SearchResult3, server::Error>
+SearchIndex::search3(const OSClient &client, const std::string &query,
+                     const SearchCounts &counts) const {
+    if (!check(client))
+        return search3(query, counts);
+    return client.search3(
+        query, std::to_string(counts.artistCount),
+        std::to_string(counts.artistOffset), std::to_string(counts.albumCount),
+        std::to_string(counts.albumOffset), std::to_string(counts.songCount),
+        std::to_string(counts.songOffset));
+}
+
+bool SearchIndex::stale() const {
+    std::lock_guard lock(m_mutex);
+    return m_stale;
+}
+
+// whether the snapshot is out of date, asking the server once per interval
+bool SearchIndex::check(const OSClient &client) const {
+    std::lock_guard lock(m_mutex);
+    auto now = std::chrono::steady_clock::now();
+    if (m_stale || (m_checked && now - *m_checked < m_options.check_interval))
+        return m_stale;
+    // the searches of the other threads wait for the one check
+    m_checked = now;
+    auto indexes = client.getIndexes(
+        "", std::to_string(m_snapshot.lastModified));
+    if (indexes && indexes->lastModified > m_snapshot.lastModified)
+        m_stale = true;
+    return m_stale;
+}
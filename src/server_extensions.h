@@ -0,0 +1,41 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \server_extensions.h
+/// The OpenSubsonic extensions of the server a client talks to, learnt by
+/// authenticate() while other threads may be sending requests.
+//
+
+#ifndef UBOAT_SERVER_EXTENSIONS_H
+#define UBOAT_SERVER_EXTENSIONS_H
+
+#include "uboat/uboat.h"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace uboat::detail {
+
+class ServerExtensions {
+public:
+    /// replace the extensions known so far
+    void set(const std::vector<server::OpenSubsonicExtension> &extensions) {
+        m_form_post.store(std::ranges::any_of(extensions,
+                                              [](const auto &e) {
+                                                  return e.name == "formPost";
+                                              }),
+                          std::memory_order_relaxed);
+    }
+
+    /// the server takes the params of a request in a POST form
+    bool form_post() const {
+        return m_form_post.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<bool> m_form_post{false};
+};
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_SERVER_EXTENSIONS_H */
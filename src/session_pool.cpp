@@ -0,0 +1,67 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "session_pool.h"
+#include <curl/curl.h>
+
+using namespace uboat::detail;
+
+SessionPool::SessionPool(std::size_t max_idle, clock::duration idle_timeout)
+    : m_max_idle(max_idle), m_idle_timeout(idle_timeout) {}
+
+SessionPool::Lease SessionPool::acquire() {
+    std::vector<Idle> expired;
+    std::unique_ptr<cpr::Session> session;
+    {
+        std::lock_guard lock(m_mutex);
+
+        // idle sessions are ordered by age, the stale ones are at the front
+        auto deadline = clock::now() - m_idle_timeout;
+        auto first_alive = m_idle.begin();
+        while (first_alive != m_idle.end() && first_alive->since < deadline)
+            ++first_alive;
+        expired.assign(std::make_move_iterator(m_idle.begin()),
+                       std::make_move_iterator(first_alive));
+        m_idle.erase(m_idle.begin(), first_alive);
+
+        if (!m_idle.empty()) {
+            session = std::move(m_idle.back().session);
+            m_idle.pop_back();
+        }
+    }
+    // expired sessions close their connections here, outside the lock
+
+    if (!session)
+        session = std::make_unique<cpr::Session>();
+
+    return Lease(this, std::move(session));
+}
+
+uboat::PoolStats SessionPool::stats() const {
+    std::lock_guard lock(m_mutex);
+    return PoolStats{m_reused.load(), m_opened.load(), m_idle.size()};
+}
+
+void SessionPool::release(std::unique_ptr<cpr::Session> session) {
+    std::lock_guard lock(m_mutex);
+    if (m_idle.size() < m_max_idle)
+        m_idle.push_back({std::move(session), clock::now()});
+}
+
+SessionPool::Lease::~Lease() {
+    if (m_session)
+        m_pool->release(std::move(m_session));
+}
+
+void SessionPool::Lease::count_connections() {
+    // curl reports 0 new connects when the transfer rode on a cached
+    // keep-alive connection
+    long connects = 0;
+    curl_easy_getinfo(m_session->GetCurlHolder()->handle,
+                      CURLINFO_NUM_CONNECTS, &connects);
+    if (connects == 0)
+        ++m_pool->m_reused;
+    else
+        m_pool->m_opened += static_cast<std::size_t>(connects);
+}
@@ -0,0 +1,78 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \session_pool.h
+/// A pool of keep-alive cpr::Session objects shared by the requests of one
+/// OSClient, so consecutive requests reuse the same TCP/TLS connection.
+//
+
+#ifndef UBOAT_SESSION_POOL_H
+#define UBOAT_SESSION_POOL_H
+
+#include "cpr/session.h"
+#include "uboat/uboat.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace uboat::detail {
+
+class SessionPool {
+public:
+    using clock = std::chrono::steady_clock;
+
+    SessionPool(std::size_t max_idle, clock::duration idle_timeout);
+
+    /// A session borrowed from the pool, handed back on destruction
+    class Lease {
+    public:
+        Lease(SessionPool *pool, std::unique_ptr<cpr::Session> session)
+            : m_pool(pool), m_session(std::move(session)) {}
+        Lease(Lease &&) = default;
+        Lease &operator=(Lease &&) = delete;
+        ~Lease();
+
+        cpr::Session *operator->() const { return m_session.get(); }
+        cpr::Session &operator*() const { return *m_session; }
+
+        /// record how many connections the last transfer had to open
+        void count_connections();
+
+        /// do not return the session to the pool (e.g. after a transport
+        /// error, its connection is probably dead)
+        void discard() { m_session.reset(); }
+
+    private:
+        SessionPool *m_pool;
+        std::unique_ptr<cpr::Session> m_session;
+    };
+
+    /// take the most recently used idle session, or create a new one
+    Lease acquire();
+
+    PoolStats stats() const;
+
+private:
+    struct Idle {
+        std::unique_ptr<cpr::Session> session;
+        clock::time_point since;
+    };
+
+    void release(std::unique_ptr<cpr::Session> session);
+
+    const std::size_t m_max_idle;
+    const clock::duration m_idle_timeout;
+
+    mutable std::mutex m_mutex;
+    std::vector<Idle> m_idle; /* most recently used at the back */
+
+    std::atomic<std::size_t> m_reused{0};
+    std::atomic<std::size_t> m_opened{0};
+};
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_SESSION_POOL_H */
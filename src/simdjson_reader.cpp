@@ -0,0 +1,243 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+// read_json() on simdjson's On-Demand API, built instead of json_reader.cpp
+// with UBOAT_USE_SIMDJSON.
+//
+
+#include "json_reader.h"
+#include <istream>
+#include <iterator>
+#include <simdjson.h>
+#include <string>
+
+namespace uboat::detail {
+
+namespace {
+
+namespace ondemand = simdjson::ondemand;
+
+// walks a document along the field tables, the On-Demand parser only
+// materializes the values the tables ask for
+class SimdjsonReader {
+public:
+    explicit SimdjsonReader(ReadContext &context) : m_context(context) {}
+
+    bool read(ondemand::value value, const TypeInfo &type, void *target,
+              const FieldInfo *field) {
+        ondemand::json_type json_type;
+        if (!ok(value.type().get(json_type)))
+            return false;
+
+        switch (json_type) {
+        case ondemand::json_type::object:
+            return read_object(value, type, target, field);
+        case ondemand::json_type::array:
+            return read_array(value, type, target, field);
+        case ondemand::json_type::number:
+            return read_number(value, type, target, field);
+        case ondemand::json_type::string: {
+            if (!type.on_string)
+                return mismatch("string", field);
+            std::string_view s;
+            if (!ok(value.get_string().get(s)))
+                return false;
+            type.on_string(target, s, m_context);
+            return true;
+        }
+        case ondemand::json_type::boolean: {
+            if (!type.on_bool)
+                return mismatch("boolean", field);
+            bool b;
+            if (!ok(value.get_bool().get(b)))
+                return false;
+            type.on_bool(target, b);
+            return true;
+        }
+        case ondemand::json_type::null:
+            return true;
+        }
+        return fail("invalid response");
+    }
+
+    const std::string &error() const { return m_error; }
+
+private:
+    bool read_object(ondemand::value value, const TypeInfo &type,
+                     void *target, const FieldInfo *field) {
+        if (!type.is_object())
+            return mismatch("object", field);
+
+        ondemand::object object;
+        if (!ok(value.get_object().get(object)))
+            return false;
+
+        std::uint64_t seen = 0;
+        for (auto member : object) {
+            std::string_view key;
+            if (!ok(member.unescaped_key().get(key)))
+                return false;
+
+            // unknown keys are skipped by the iteration
+            auto index = type.find(key);
+            if (index == type.field_count)
+                continue;
+
+            ondemand::value v;
+            if (!ok(member.value().get(v)))
+                return false;
+            if (v.is_null())
+                continue;
+
+            auto &f = type.fields[index];
+            if (!read(v, *f.type, f.member(target), &f))
+                return false;
+            seen |= std::uint64_t{1} << index;
+        }
+
+        auto missing = type.required & ~seen;
+        if (missing != 0) {
+            for (std::size_t i = 0; i < type.field_count; ++i)
+                if (missing & (std::uint64_t{1} << i))
+                    return fail("missing key \"" +
+                                std::string(type.fields[i].name) + "\"");
+        }
+        if (type.on_end)
+            type.on_end(target, seen);
+        return true;
+    }
+
+    bool read_array(ondemand::value value, const TypeInfo &type,
+                    void *target, const FieldInfo *field) {
+        if (!type.is_array())
+            return mismatch("array", field);
+
+        ondemand::array array;
+        if (!ok(value.get_array().get(array)))
+            return false;
+
+        for (auto element : array) {
+            ondemand::value v;
+            if (!ok(element.get(v)))
+                return false;
+            if (v.is_null())
+                continue;
+            if (!read(v, *type.element, type.emplace_back(target, m_context),
+                      nullptr))
+                return false;
+        }
+        return true;
+    }
+
+    bool read_number(ondemand::value value, const TypeInfo &type,
+                     void *target, const FieldInfo *field) {
+        ondemand::number_type number_type;
+        if (!ok(value.get_number_type().get(number_type)))
+            return false;
+
+        switch (number_type) {
+        case ondemand::number_type::signed_integer: {
+            std::int64_t i;
+            if (!type.on_integer)
+                return mismatch("number", field);
+            if (!ok(value.get_int64().get(i)))
+                return false;
+            type.on_integer(target, i);
+            return true;
+        }
+        case ondemand::number_type::unsigned_integer: {
+            std::uint64_t u;
+            if (!type.on_unsigned)
+                return mismatch("number", field);
+            if (!ok(value.get_uint64().get(u)))
+                return false;
+            type.on_unsigned(target, u);
+            return true;
+        }
+        default: {
+            double d;
+            if (!type.on_float)
+                return mismatch("number", field);
+            if (!ok(value.get_double().get(d)))
+                return false;
+            type.on_float(target, d);
+            return true;
+        }
+        }
+    }
+
+    bool ok(simdjson::error_code error) {
+        if (error == simdjson::SUCCESS)
+            return true;
+        return fail(simdjson::error_message(error));
+    }
+
+    bool mismatch(const char *what, const FieldInfo *field) {
+        if (field)
+            return fail("unexpected " + std::string(what) + " for key \"" +
+                        std::string(field->name) + "\"");
+        return fail("unexpected " + std::string(what));
+    }
+
+    bool fail(std::string message) {
+        if (m_error.empty())
+            m_error = std::move(message);
+        return false;
+    }
+
+    ReadContext &m_context;
+    std::string m_error;
+};
+
+// simdjson reads past the end of the input, the body is copied to a padded
+// buffer kept for the next responses, as is the parser
+thread_local std::string t_buffer;
+
+// parse the first size bytes of t_buffer
+bool read_buffer(std::size_t size, const TypeInfo &type, void *target,
+                 ReadContext &context, std::string &error) {
+    thread_local ondemand::parser parser;
+    t_buffer.resize(size + simdjson::SIMDJSON_PADDING);
+
+    ondemand::document document;
+    auto result = parser.iterate(
+        simdjson::padded_string_view(t_buffer.data(), size, t_buffer.size()));
+    if (auto e = std::move(result).get(document); e != simdjson::SUCCESS) {
+        error = simdjson::error_message(e);
+        return false;
+    }
+
+    SimdjsonReader reader(context);
+    ondemand::value root;
+    if (auto e = document.get_value().get(root); e != simdjson::SUCCESS) {
+        error = simdjson::error_message(e);
+        return false;
+    }
+    if (!reader.read(root, type, target, nullptr)) {
+        error = reader.error();
+        return false;
+    }
+    if (!document.at_end()) {
+        error = "trailing content after the document";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool read_json(std::string_view body, const TypeInfo &type, void *target,
+               ReadContext &context, std::string &error) {
+    t_buffer.assign(body);
+    return read_buffer(body.size(), type, target, context, error);
+}
+
+// simdjson needs the whole document, a compressed body is decoded into the
+// buffer first
+bool read_json(std::istream &body, const TypeInfo &type, void *target,
+               ReadContext &context, std::string &error) {
+    t_buffer.assign(std::istreambuf_iterator<char>(body), {});
+    return read_buffer(t_buffer.size(), type, target, context, error);
+}
+
+} // namespace uboat::detail
@@ -0,0 +1,75 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \single_flight.h
+/// Coalescing of identical requests: while a request is in flight, the
+/// callers making the same one wait for it and share its result instead of
+/// sending their own.
+//
+
+#ifndef UBOAT_SINGLE_FLIGHT_H
+#define UBOAT_SINGLE_FLIGHT_H
+
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace uboat::detail {
+
+class SingleFlight {
+public:
+    /// \return the result of call, or of the call running for key if there
+    /// is one. The calls of a key must all return T.
+    template <class T, class F> T run(const std::string &key, F &&call) {
+        std::unique_lock lock(m_mutex);
+        if (auto it = m_calls.find(key); it != m_calls.end()) {
+            auto flight = it->second;
+            ++m_coalesced;
+            lock.unlock();
+            return *std::static_pointer_cast<const T>(flight.get());
+        }
+
+        std::promise<std::shared_ptr<const void>> promise;
+        m_calls.emplace(key, promise.get_future().share());
+        lock.unlock();
+
+        std::shared_ptr<const T> result;
+        try {
+            result = std::make_shared<const T>(call());
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+            finish(key);
+            throw;
+        }
+        // later callers make a new request, they may need a newer answer
+        finish(key);
+        promise.set_value(result);
+        return *result;
+    }
+
+    /// number of calls answered by another one
+    std::size_t coalesced() const {
+        std::lock_guard lock(m_mutex);
+        return m_coalesced;
+    }
+
+private:
+    void finish(const std::string &key) {
+        std::lock_guard lock(m_mutex);
+        m_calls.erase(key);
+    }
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string,
+                       std::shared_future<std::shared_ptr<const void>>>
+        m_calls; /* in flight by key */
+    std::size_t m_coalesced = 0;
+};
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_SINGLE_FLIGHT_H */
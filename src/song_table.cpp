@@ -0,0 +1,253 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "uboat/song_table.h"
+#include "uboat/uboat.h"
+#include <algorithm>
+#include <numeric>
+
+using namespace uboat;
+
+// TextColumn
+
+void TextColumn::append(const TextColumn &other) {
+    auto offset = m_chars.size();
+    m_chars += other.m_chars;
+    m_ends.reserve(size() + other.size());
+    for (auto end : other.m_ends)
+        m_ends.push_back(offset + end);
+}
+
+// DictionaryColumn
+
+DictionaryColumn::DictionaryColumn(const DictionaryColumn &other)
+    : m_codes(other.m_codes), m_index(other.m_index),
+      m_values(other.m_values.size()) {
+    // the copied keys have new addresses
+    for (auto &[value, code] : m_index)
+        m_values[code] = &value;
+}
+
+DictionaryColumn &DictionaryColumn::operator=(const DictionaryColumn &other) {
+    if (this != &other)
+        *this = DictionaryColumn(other);
+    return *this;
+}
+
+std::optional<DictionaryColumn::Code>
+DictionaryColumn::find(std::string_view s) const {
+    auto it = m_index.find(s);
+    if (it == m_index.end())
+        return std::nullopt;
+    return it->second;
+}
+
+void DictionaryColumn::append(const DictionaryColumn &other) {
+    // intern every distinct value once, then map the codes
+    std::vector<Code> codes(other.distinct());
+    for (Code c = 0; c < codes.size(); ++c)
+        codes[c] = intern(other.value(c));
+
+    m_codes.reserve(size() + other.size());
+    for (auto code : other.m_codes)
+        m_codes.push_back(codes[code]);
+}
+
+void DictionaryColumn::clear() {
+    m_codes.clear();
+    m_index.clear();
+    m_values.clear();
+    intern({});
+}
+
+DictionaryColumn::Code DictionaryColumn::intern(std::string_view s) {
+    auto it = m_index.find(s);
+    if (it != m_index.end())
+        return it->second;
+
+    auto code = static_cast<Code>(m_values.size());
+    auto [inserted, _] = m_index.emplace(std::string(s), code);
+    m_values.push_back(&inserted->first);
+    return code;
+}
+
+// SongTable
+
+namespace {
+
+template <class T>
+void append_column(std::vector<T> &column, const std::vector<T> &other) {
+    column.insert(column.end(), other.begin(), other.end());
+}
+
+template <class Column>
+void append_column(Column &column, const Column &other) {
+    column.append(other);
+}
+
+} // namespace
+
+template <class F> void SongTable::for_each_column(F &&f) {
+    f(&SongTable::m_id);
+    f(&SongTable::m_parent);
+    f(&SongTable::m_title);
+    f(&SongTable::m_album);
+    f(&SongTable::m_artist);
+    f(&SongTable::m_track);
+    f(&SongTable::m_year);
+    f(&SongTable::m_genre);
+    f(&SongTable::m_coverArt);
+    f(&SongTable::m_size);
+    f(&SongTable::m_contentType);
+    f(&SongTable::m_suffix);
+    f(&SongTable::m_duration);
+    f(&SongTable::m_bitRate);
+    f(&SongTable::m_bitDepth);
+    f(&SongTable::m_samplingRate);
+    f(&SongTable::m_channelCount);
+    f(&SongTable::m_path);
+    f(&SongTable::m_userRating);
+    f(&SongTable::m_playCount);
+    f(&SongTable::m_discNumber);
+    f(&SongTable::m_created);
+    f(&SongTable::m_albumId);
+    f(&SongTable::m_artistId);
+    f(&SongTable::m_type);
+    f(&SongTable::m_mediaType);
+    f(&SongTable::m_bpm);
+    f(&SongTable::m_displayArtist);
+}
+
+void SongTable::reserve(std::size_t rows) {
+    for_each_column([&](auto column) { (this->*column).reserve(rows); });
+}
+
+void SongTable::clear() {
+    for_each_column([&](auto column) { (this->*column).clear(); });
+}
+
+void SongTable::push_default() {
+    for_each_column([&](auto column) { (this->*column).push_back({}); });
+}
+
+void SongTable::append(const media::Child &song) {
+    m_id.push_back(song.id);
+    m_parent.push_back(song.parent);
+    m_title.push_back(song.title);
+    m_album.push_back(song.album);
+    m_artist.push_back(song.artist);
+    m_track.push_back(static_cast<std::uint32_t>(song.track));
+    m_year.push_back(static_cast<std::uint32_t>(song.year));
+    m_genre.push_back(song.genre);
+    m_coverArt.push_back(song.coverArt);
+    m_size.push_back(song.size);
+    m_contentType.push_back(song.contentType);
+    m_suffix.push_back(song.suffix);
+    m_duration.push_back(static_cast<std::uint32_t>(song.duration));
+    m_bitRate.push_back(static_cast<std::uint32_t>(song.bitRate));
+    m_bitDepth.push_back(static_cast<std::uint32_t>(song.bitDepth));
+    m_samplingRate.push_back(static_cast<std::uint32_t>(song.samplingRate));
+    m_channelCount.push_back(static_cast<std::uint32_t>(song.channelCount));
+    m_path.push_back(song.path);
+    m_userRating.push_back(static_cast<std::uint32_t>(song.userRating));
+    m_playCount.push_back(static_cast<std::uint32_t>(song.playCount));
+    m_discNumber.push_back(static_cast<std::uint32_t>(song.discNumber));
+    m_created.push_back(song.created);
+    m_albumId.push_back(song.albumId);
+    m_artistId.push_back(song.artistId);
+    m_type.push_back(song.type);
+    m_mediaType.push_back(song.mediaType);
+    m_bpm.push_back(static_cast<std::uint32_t>(song.bpm));
+    m_displayArtist.push_back(song.displayArtist);
+}
+
+void SongTable::append(const SongTable &other) {
+    for_each_column(
+        [&](auto column) { append_column(this->*column, other.*column); });
+}
+
+media::Child SongTable::row(std::size_t row) const {
+    media::Child c{};
+    c.id = m_id[row];
+    c.parent = m_parent[row];
+    c.title = m_title[row];
+    c.album = m_album[row];
+    c.artist = m_artist[row];
+    c.track = m_track[row];
+    c.year = m_year[row];
+    c.genre = m_genre[row];
+    c.coverArt = m_coverArt[row];
+    c.size = m_size[row];
+    c.contentType = m_contentType[row];
+    c.suffix = m_suffix[row];
+    c.duration = m_duration[row];
+    c.bitRate = m_bitRate[row];
+    c.bitDepth = m_bitDepth[row];
+    c.samplingRate = m_samplingRate[row];
+    c.channelCount = m_channelCount[row];
+    c.path = m_path[row];
+    c.userRating = m_userRating[row];
+    c.playCount = m_playCount[row];
+    c.discNumber = m_discNumber[row];
+    c.created = m_created[row];
+    c.albumId = m_albumId[row];
+    c.artistId = m_artistId[row];
+    c.type = m_type[row];
+    c.mediaType = m_mediaType[row];
+    c.bpm = m_bpm[row];
+    c.displayArtist = m_displayArtist[row];
+    return c;
+}
+
+// The scans below are plain loops over one column without branches, which
+// the compiler vectorizes.
+
+std::uint64_t SongTable::totalDuration() const {
+    std::uint64_t total = 0;
+    for (auto d : m_duration)
+        total += d;
+    return total;
+}
+
+namespace {
+
+// the rows where keep(value) holds, written unconditionally and kept by
+// advancing the end
+template <class T, class Keep>
+std::vector<SongTable::Row> filter(std::span<const T> column, Keep keep) {
+    std::vector<SongTable::Row> rows(column.size());
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < column.size(); ++i) {
+        rows[n] = static_cast<SongTable::Row>(i);
+        n += keep(column[i]) ? 1 : 0;
+    }
+    rows.resize(n);
+    return rows;
+}
+
+} // namespace
+
+std::vector<SongTable::Row> SongTable::filterByYear(std::size_t from,
+                                                    std::size_t to) const {
+    return filter(year(),
+                  [=](std::uint32_t y) { return from <= y && y <= to; });
+}
+
+std::vector<SongTable::Row>
+SongTable::filterByGenre(std::string_view genre) const {
+    auto code = m_genre.find(genre);
+    if (!code)
+        return {};
+    return filter(m_genre.codes(),
+                  [c = *code](DictionaryColumn::Code g) { return g == c; });
+}
+
+std::vector<SongTable::Row> SongTable::sortByPlayCount() const {
+    std::vector<Row> rows(size());
+    std::iota(rows.begin(), rows.end(), Row{0});
+    std::stable_sort(rows.begin(), rows.end(), [&](Row a, Row b) {
+        return m_playCount[a] > m_playCount[b];
+    });
+    return rows;
+}
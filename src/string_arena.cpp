@@ -0,0 +1,32 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "string_arena.h"
+#include <algorithm>
+#include <cstring>
+
+namespace uboat::detail {
+
+std::string_view StringArena::store(std::string_view s) {
+    if (s.empty())
+        return {};
+
+    if (s.size() > m_left) {
+        // strings larger than a chunk get a chunk of their own
+        auto size = std::max(m_chunk_size, s.size());
+        m_chunks.push_back(std::make_unique_for_overwrite<char[]>(size));
+        m_next = m_chunks.back().get();
+        m_left = size;
+        m_capacity += size;
+        m_chunk_size = std::min(m_chunk_size * 2, MAX_CHUNK_SIZE);
+    }
+
+    std::memcpy(m_next, s.data(), s.size());
+    std::string_view stored(m_next, s.size());
+    m_next += s.size();
+    m_left -= s.size();
+    return stored;
+}
+
+} // namespace uboat::detail
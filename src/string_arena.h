@@ -0,0 +1,48 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \string_arena.h
+/// Storage of the strings referenced by the view models: strings are copied
+/// back to back into a few large chunks instead of one allocation each.
+//
+
+#ifndef UBOAT_STRING_ARENA_H
+#define UBOAT_STRING_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace uboat::detail {
+
+class StringArena {
+public:
+    /// \param chunk_size size of the first chunk, the next ones double up to
+    /// MAX_CHUNK_SIZE
+    explicit StringArena(std::size_t chunk_size = 16 * 1024)
+        : m_chunk_size(chunk_size) {}
+
+    StringArena(StringArena &&) = default;
+    StringArena &operator=(StringArena &&) = default;
+
+    /// copy s into the arena
+    /// \return a view of the copy, valid as long as the arena
+    std::string_view store(std::string_view s);
+
+    /// bytes allocated for the chunks
+    std::size_t capacity() const { return m_capacity; }
+
+    static constexpr std::size_t MAX_CHUNK_SIZE = 1024 * 1024;
+
+private:
+    std::vector<std::unique_ptr<char[]>> m_chunks;
+    char *m_next = nullptr; /* free space of the last chunk */
+    std::size_t m_left = 0;
+    std::size_t m_chunk_size;
+    std::size_t m_capacity = 0;
+};
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_STRING_ARENA_H */
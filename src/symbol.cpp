@@ -0,0 +1,105 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "uboat/symbol.h"
+#include <array>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <shared_mutex>
+#include <unordered_set>
+
+using namespace uboat;
+
+namespace {
+
+struct Hash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const {
+        return std::hash<std::string_view>{}(s);
+    }
+};
+
+/// The strings of all symbols. Split in shards by hash, each with its own
+/// lock, so threads reading responses at the same time rarely wait.
+class SymbolTable {
+public:
+    static SymbolTable &instance() {
+        static SymbolTable table;
+        return table;
+    }
+
+    const std::string *intern(std::string_view s, std::size_t hash) {
+        auto &shard = m_shards[hash % SHARDS];
+        {
+            std::shared_lock lock(shard.mutex);
+            if (auto it = shard.strings.find(s); it != shard.strings.end())
+                return &*it;
+        }
+
+        std::unique_lock lock(shard.mutex);
+        auto [it, inserted] = shard.strings.emplace(s);
+        if (inserted)
+            shard.bytes += NODE_SIZE + (it->capacity() > SSO_CAPACITY
+                                            ? it->capacity() + 1
+                                            : 0);
+        return &*it;
+    }
+
+    SymbolStats stats() const {
+        SymbolStats stats{0, 0};
+        for (auto &shard : m_shards) {
+            std::shared_lock lock(shard.mutex);
+            stats.count += shard.strings.size();
+            stats.bytes += shard.bytes +
+                           shard.strings.bucket_count() * sizeof(void *);
+        }
+        return stats;
+    }
+
+private:
+    static constexpr std::size_t SHARDS = 16;
+    // a node of the set: the string, the cached hash and the next pointer
+    static constexpr std::size_t NODE_SIZE =
+        sizeof(std::string) + 2 * sizeof(void *);
+    static constexpr std::size_t SSO_CAPACITY = std::string().capacity();
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_set<std::string, Hash, std::equal_to<>> strings;
+        std::size_t bytes = 0; /* of the nodes and the long strings */
+    };
+    std::array<Shard, SHARDS> m_shards;
+};
+
+} // namespace
+
+Symbol::Symbol(std::string_view s) {
+    if (s.empty())
+        return;
+
+    // symbols are never freed, so every thread keeps the last ones it saw
+    // and finds most of them again without locking the table
+    struct Cached {
+        std::size_t hash = 0;
+        const std::string *value = nullptr;
+    };
+    thread_local std::array<Cached, 256> cache;
+
+    auto hash = Hash{}(s);
+    auto &cached = cache[hash % cache.size()];
+    if (cached.value && cached.hash == hash && *cached.value == s) {
+        m_value = cached.value;
+        return;
+    }
+
+    m_value = SymbolTable::instance().intern(s, hash);
+    cached = Cached{hash, m_value};
+}
+
+std::ostream &uboat::operator<<(std::ostream &os, const Symbol &s) {
+    return os << s.str();
+}
+
+SymbolStats uboat::symbol_stats() { return SymbolTable::instance().stats(); }
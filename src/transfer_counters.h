@@ -0,0 +1,64 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \transfer_counters.h
+/// Bytes of the response bodies read by a client, per endpoint: as they
+/// came over the wire, and once decoded. Also the requests sent as forms.
+//
+
+#ifndef UBOAT_TRANSFER_COUNTERS_H
+#define UBOAT_TRANSFER_COUNTERS_H
+
+#include "uboat/uboat.h"
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace uboat::detail {
+
+class TransferCounters {
+public:
+    /// count a response of endpoint
+    void add(std::string_view endpoint, std::size_t wire_bytes,
+             std::size_t decoded_bytes) {
+        std::lock_guard lock(m_mutex);
+        for (auto *stats : {&m_total, &endpoint_stats(endpoint)}) {
+            ++stats->responses;
+            stats->wire_bytes += wire_bytes;
+            stats->decoded_bytes += decoded_bytes;
+        }
+    }
+
+    /// count a request of endpoint sent as a POST form
+    void add_form(std::string_view endpoint) {
+        std::lock_guard lock(m_mutex);
+        ++m_total.forms;
+        ++endpoint_stats(endpoint).forms;
+    }
+
+    /// fill the transfer counters of stats
+    void read(RequestStats &stats) const {
+        std::lock_guard lock(m_mutex);
+        stats.total = m_total;
+        stats.endpoints = m_endpoints;
+    }
+
+private:
+    TransferStats &endpoint_stats(std::string_view endpoint) {
+        auto it = m_endpoints.find(endpoint);
+        if (it == m_endpoints.end())
+            it = m_endpoints.emplace(std::string(endpoint), TransferStats{})
+                     .first;
+        return it->second;
+    }
+
+    mutable std::mutex m_mutex;
+    TransferStats m_total{};
+    std::map<std::string, TransferStats, std::less<>> m_endpoints;
+};
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_TRANSFER_COUNTERS_H */
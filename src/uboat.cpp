@@ -3,76 +3,250 @@
 //
 
 #include "uboat/uboat.h"
-#include "cpr/api.h"
 #include "cpr/cprtypes.h"
-#include "cpr/parameters.h"
 #include "cpr/response.h"
+#include "cache_dependencies.h"
+#include "content_coding.h"
+#include "credentials.h"
+#include "json_reader.h"
+#include "model_fields.h"
+#include "request_query.h"
+#include "response_cache.h"
+#include "server_extensions.h"
+#include "session_pool.h"
+#include "single_flight.h"
+#include "string_arena.h"
+#include "transfer_counters.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <expected>
+#include <future>
 #include <map>
 #include <nlohmann/json_fwd.hpp>
-#include <openssl/evp.h>
 #include <ostream>
-#include <random>
-#include <sstream>
 #include <string>
+#include <string_view>
 
 using namespace uboat;
 using json = nlohmann::json;
 
-OSClient::OSClient(const std::string &server_url, const std::string &username,
-                   const std::string &password, const std::string &client_name)
-    : m_server_url(server_url + "/rest/"), m_username(username),
-      m_password(password), m_client_name(client_name) {};
+namespace {
 
-// Generate MD5 token and try to ping() the server
-std::expected<server::SubsonicResponse<server::Error>, server::Error>
-OSClient::authenticate() {
+// changes of the write requests to the response cache
+using CacheUpdate = std::function<void(detail::ResponseCache &)>;
+using detail::Entity;
 
-    // generate random salt
-    const std::string CHARACTERS =
-        "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<size_t> distribution(0,
-                                                       CHARACTERS.size() - 1);
+// dependencies on an id which may be of a song, an album or an artist
+std::vector<std::string> any_entity(const std::string &id) {
+    if (id.empty())
+        return {};
+    return {detail::ResponseCache::dependency(Entity::Song, id),
+            detail::ResponseCache::dependency(Entity::Album, id),
+            detail::ResponseCache::dependency(Entity::Artist, id)};
+}
 
-    for (size_t i = 0; i < 10; ++i) {
-        m_salt += CHARACTERS[distribution(gen)];
-    }
+std::vector<std::string> starred_entities(const std::string &id,
+                                          const std::string &albumId,
+                                          const std::string &artistId) {
+    auto names = any_entity(id);
+    if (!albumId.empty())
+        names.push_back(
+            detail::ResponseCache::dependency(Entity::Album, albumId));
+    if (!artistId.empty())
+        names.push_back(
+            detail::ResponseCache::dependency(Entity::Artist, artistId));
+    return names;
+}
 
-    // generate MD5
-    auto password_salt = m_password + m_salt;
+// the time of a star is only known to the server, the responses holding the
+// starred entities are read again
+CacheUpdate star_update(const std::string &id, const std::string &albumId,
+                        const std::string &artistId) {
+    return [names = starred_entities(id, albumId, artistId)](
+               detail::ResponseCache &cache) { cache.invalidate(names); };
+}
 
-    // see openssl evp docs
-    // https://docs.openssl.org/3.0/man3/EVP_DigestInit/#examples
-    EVP_MD_CTX *mdctx;
-    const EVP_MD *md;
-    unsigned char md_value[EVP_MAX_MD_SIZE];
-    unsigned int md_len, i;
+CacheUpdate unstar_update(const std::string &id, const std::string &albumId,
+                          const std::string &artistId) {
+    return [=](detail::ResponseCache &cache) {
+        for (auto const &i : {id, albumId, artistId})
+            if (!i.empty())
+                cache.patch(any_entity(i),
+                            detail::Change{.id = i, .starred = ""});
+    };
+}
 
-    md = EVP_get_digestbyname("MD5");
+CacheUpdate rating_update(const std::string &id, const std::string &rating) {
+    return [=](detail::ResponseCache &cache) {
+        std::size_t value;
+        auto end = rating.data() + rating.size();
+        auto [last, ec] = std::from_chars(rating.data(), end, value);
+        if (ec != std::errc() || last != end) {
+            cache.invalidate(any_entity(id));
+            return;
+        }
+        cache.patch(any_entity(id),
+                    detail::Change{.id = id, .userRating = value});
+    };
+}
 
-    mdctx = EVP_MD_CTX_new();
-    EVP_DigestInit_ex2(mdctx, md, NULL);
-    EVP_DigestUpdate(mdctx, password_salt.c_str(),
-                     strlen(password_salt.c_str()));
+// a scrobble changes the play count and the time played of the song, a "now
+// playing" notification nothing
+CacheUpdate scrobble_update(const std::string &id,
+                            const std::string &submission) {
+    return [=](detail::ResponseCache &cache) {
+        if (submission != "false")
+            cache.invalidate(
+                {detail::ResponseCache::dependency(Entity::Song, id)});
+    };
+}
 
-    EVP_DigestFinal_ex(mdctx, md_value, &md_len);
+// drops the playlist and the listings holding it, or all listings for a new
+// playlist
+CacheUpdate playlist_update(const std::string &playlistId) {
+    return [=](detail::ResponseCache &cache) {
+        if (playlistId.empty())
+            cache.invalidate({std::string(detail::ResponseCache::PLAYLISTS)});
+        else
+            cache.invalidate({detail::ResponseCache::dependency(
+                Entity::Playlist, playlistId)});
+    };
+}
 
-    std::stringstream result;
+// add a response to the cache, and its body to the cache directory
+template <class Data>
+void cache_response(detail::ResponseCache &cache, std::string cache_key,
+                    const std::string &endpoint,
+                    const std::multimap<std::string, std::string> &params,
+                    const server::SubsonicResponse<Data> &response,
+                    const detail::Body &body, std::size_t decoded_bytes) {
+    // the decoded model is charged the size of the body it came from
+    auto cached = std::make_shared<server::SubsonicResponse<Data>>(response);
+    auto dependencies = detail::dependencies(endpoint, params, cached->data);
+    cache.insert(std::move(cache_key),
+                 std::shared_ptr<const server::SubsonicResponse<Data>>(
+                     std::move(cached)),
+                 decoded_bytes, cache.lifetime(endpoint, params),
+                 std::move(dependencies), &detail::patch<Data>);
+
+    // the cache directory keeps the bodies as received, a compressed one is
+    // neither decoded nor compressed again
+    if (cache.persistent())
+        cache.save(detail::ResponseCache::request_key(endpoint, params),
+                   body);
+}
 
-    for (i = 0; i < md_len; i++)
-        result << std::hex << std::setw(2) << std::setfill('0')
-               << (int)md_value[i];
+// a body as received with the Content-Encoding encoding
+std::expected<detail::Body, server::Error>
+received_body(std::string bytes, std::string_view encoding) {
+    auto coding = detail::content_coding(encoding);
+    if (!coding)
+        return std::unexpected(server::Error{
+            500, "unsupported Content-Encoding: " + std::string(encoding)});
+    return detail::Body{std::move(bytes), *coding};
+}
 
-    m_token = result.str();
+// parse a response body of endpoint, counting its bytes
+template <class Data>
+std::expected<server::SubsonicResponse<Data>, server::Error>
+read_body(detail::TransferCounters &counters, std::string_view endpoint,
+          const detail::Body &body, std::string_view key,
+          detail::ReadContext context = {}, std::size_t *decoded = nullptr) {
+    std::size_t size = 0;
+    auto response = detail::read_response<Data>(body, key, context, &size);
+    counters.add(endpoint, body.bytes.size(), size);
+    if (decoded)
+        *decoded = size;
+    return response;
+}
 
-    EVP_MD_CTX_free(mdctx);
+// whether identical requests in flight may share a response: only the reads
+// answering every caller the same, not the write requests, whose every call
+// has an effect, nor the random ones
+bool coalescable(std::string_view endpoint,
+                 const std::multimap<std::string, std::string> &params) {
+    static constexpr std::string_view DETERMINISTIC[] = {
+        "getAlbum",        "getAlbumInfo2", "getAlbumList2",
+        "getArtistInfo2",  "getArtists",    "getGenres",
+        "getIndexes",      "getLicense",    "getMusicFolders",
+        "getNowPlaying",   "getOpenSubsonicExtensions",
+        "getPlaylist",     "getPlaylists",  "getTopSongs",
+        "ping",            "search3"};
+    static_assert(std::ranges::is_sorted(DETERMINISTIC));
+    if (!std::ranges::binary_search(DETERMINISTIC, endpoint))
+        return false;
+    // a random album list is another list for every call
+    auto type = params.find("type");
+    return endpoint != "getAlbumList2" || type == params.end() ||
+           type->second != "random";
+}
+
+} // namespace
+
+OSClient::OSClient(const std::string &server_url, const std::string &username,
+                   const std::string &password, const std::string &client_name,
+                   const ClientOptions &options)
+    : m_server_url(server_url + "/rest/"),
+      m_credentials(std::make_unique<detail::Credentials>(
+          username, password, options.api_key, client_name,
+          options.token_lifetime)),
+      m_pool(std::make_unique<detail::SessionPool>(
+          options.pool_size, options.pool_idle_timeout)),
+      m_loop(options.event_loop ? options.event_loop
+                                : std::make_shared<EventLoop>()),
+      m_timeout(options.request_timeout),
+      m_cache(options.cache.max_bytes > 0
+                  ? std::make_shared<detail::ResponseCache>(
+                        options.cache,
+                        m_server_url + '\0' + m_credentials->identity())
+                  : nullptr),
+      m_flights(std::make_unique<detail::SingleFlight>()),
+      m_accept_encoding(options.compression ? detail::accept_encoding() : ""),
+      m_transfers(std::make_shared<detail::TransferCounters>()),
+      m_extensions(std::make_unique<detail::ServerExtensions>()) {};
+
+OSClient::OSClient(OSClient &&) noexcept = default;
+OSClient &OSClient::operator=(OSClient &&) noexcept = default;
+OSClient::~OSClient() = default;
+
+// Connection reuse counters of the client's connection pool
+PoolStats OSClient::pool_stats() const { return m_pool->stats(); }
+
+// Counters of the requests made through the client
+RequestStats OSClient::request_stats() const {
+    RequestStats stats{m_flights->coalesced()};
+    m_transfers->read(stats);
+    return stats;
+}
+
+// Counters of the response cache
+CacheStats OSClient::cache_stats() const {
+    return m_cache ? m_cache->stats() : CacheStats{};
+}
+
+// Drop all cached responses
+void OSClient::clear_cache() {
+    if (m_cache)
+        m_cache->clear();
+}
+
+// The event loop running the asynchronous requests
+std::shared_ptr<EventLoop> OSClient::event_loop() const { return m_loop; }
+
+// Generate a new salt and MD5 token and try to ping() the server
+std::expected<server::SubsonicResponse<server::Error>, server::Error>
+OSClient::authenticate() {
+    m_credentials->rotate();
 
     // test the credentails
     auto response = ping();
     if (response.has_value()) {
         if (response.value().status == "ok") {
+            // long parameter lists go in POST forms if the server takes them
+            if (response.value().openSubsonic)
+                if (auto extensions = getOpenSubsonicExtensions())
+                    m_extensions->set(*extensions);
             return response;
         } else
             return std::unexpected(response.value().error);
@@ -103,8 +277,47 @@ std::expected<server::License, server::Error> OSClient::getLicense() const {
     }
 }
 
+// List the OpenSubsonic extensions supported by the server.
+std::expected<std::vector<server::OpenSubsonicExtension>, server::Error>
+OSClient::getOpenSubsonicExtensions() const {
+    auto response = get_req<std::vector<server::OpenSubsonicExtension>>(
+        "getOpenSubsonicExtensions", {}, "openSubsonicExtensions");
+    if (response)
+        return check(response.value());
+    else
+        return std::unexpected(response.error());
+}
+
 // Browsing
 
+// Returns all configured top-level music folders.
+std::expected<misc::MusicFolders, server::Error>
+OSClient::getMusicFolders() const {
+    auto response =
+        get_req<misc::MusicFolders>("getMusicFolders", {}, "musicFolders");
+    // extract data
+    if (response)
+        return check(response.value());
+    else
+        return std::unexpected(response.error());
+}
+
+// Returns an indexed structure of all artists.
+std::expected<artist::Indexes, server::Error>
+OSClient::getIndexes(const std::string &musicFolderId,
+                     const std::string &ifModifiedSince) const {
+    // make params
+    std::multimap<std::string, std::string> params{
+        {"musicFolderId", musicFolderId}, {"ifModifiedSince", ifModifiedSince}};
+
+    auto response = get_req<artist::Indexes>("getIndexes", params, "indexes");
+    // extract data
+    if (response)
+        return check(response.value());
+    else
+        return std::unexpected(response.error());
+}
+
 // Returns all genres
 std::expected<misc::Genres, server::Error> OSClient::getGenres() const {
     auto response = get_req<misc::Genres>("getGenres", {}, "genres");
@@ -210,7 +423,7 @@ OSClient::getAlbumList2(const std::string &type, const std::string &size,
 
     // make parameters
     std::multimap<std::string, std::string> params{
-        {"type", type},         {"size", size},     {"offset", size},
+        {"type", type},         {"size", size},     {"offset", offset},
         {"fromYear", fromYear}, {"toYear", toYear}, {"genre", genre}};
 
     // get response
@@ -339,6 +552,9 @@ OSClient::createPlaylist(const std::string &playlistId, const std::string &name,
     auto response = get_req<playlist::PlaylistWithSongs>("createPlaylist",
                                                          params, "playlist");
 
+    update_cache(response && response->status == "ok",
+                 playlist_update(playlistId));
+
     // extract data
     if (response)
         return check(response.value());
@@ -371,6 +587,9 @@ OSClient::updatePlaylist(
     auto response = get_req<server::SubsonicResponse<server::Error>>(
         "updatePlaylist", params, "");
 
+    update_cache(response && response->status == "ok",
+                 playlist_update(playlistId));
+
     if (response)
         return check(response.value());
     else
@@ -387,6 +606,8 @@ OSClient::deletePlaylist(const std::string &id) const {
     auto response = get_req<server::SubsonicResponse<server::Error>>(
         "deletePlaylist", params, "");
 
+    update_cache(response && response->status == "ok", playlist_update(id));
+
     // extract data
     if (response)
         return check(response.value());
@@ -406,6 +627,9 @@ OSClient::star(const std::string &id, const std::string &albumId,
     auto response =
         get_req<server::SubsonicResponse<server::Error>>("star", params, "");
 
+    update_cache(response && response->status == "ok",
+                 star_update(id, albumId, artistId));
+
     // extract data
     if (response)
         return check(response.value());
@@ -424,6 +648,9 @@ OSClient::unstar(const std::string &id, const std::string &albumId,
     auto response =
         get_req<server::SubsonicResponse<server::Error>>("unstar", params, "");
 
+    update_cache(response && response->status == "ok",
+                 unstar_update(id, albumId, artistId));
+
     // extract data
     if (response)
         return check(response.value());
@@ -442,6 +669,9 @@ OSClient::setRating(const std::string &id, const std::string &rating) const {
     auto response = get_req<server::SubsonicResponse<server::Error>>(
         "setRating", params, "");
 
+    update_cache(response && response->status == "ok",
+                 rating_update(id, rating));
+
     // extract data
     if (response)
         return check(response.value());
@@ -460,6 +690,9 @@ OSClient::scrobble(const std::string &id, const std::string &time,
     auto response = get_req<server::SubsonicResponse<server::Error>>(
         "scrobble", params, "");
 
+    update_cache(response && response->status == "ok",
+                 scrobble_update(id, submission));
+
     // extract data
     if (response)
         return check(response.value());
@@ -468,98 +701,900 @@ OSClient::scrobble(const std::string &id, const std::string &time,
 }
 
 // private
-/// helper for GET requests
+namespace {
+
+// queries longer than this go in a POST form when the server takes them,
+// proxies and servers often limit the request line to a few KiB
+constexpr std::size_t FORM_POST_MIN_SIZE = 2048;
+
+// finishers of asynchronous requests
+// pass the whole response, like ping()
 template <class Data>
 std::expected<server::SubsonicResponse<Data>, server::Error>
-OSClient::get_req(const std::string &endpoint,
-                  const std::multimap<std::string, std::string> &params,
-                  const std::string &key) const {
+pass(std::expected<server::SubsonicResponse<Data>, server::Error> r) {
+    return r;
+}
 
-    // basic request params required by every endpoint
-    cpr::Parameters request_params{{"u", m_username},    {"t", m_token},
-                                   {"s", m_salt},        {"v", API_VERSION},
-                                   {"c", m_client_name}, {"f", "json"}};
+} // namespace
+
+// send a request and return the body of the response, as received
+std::expected<detail::Body, server::Error>
+OSClient::fetch(const std::string &endpoint,
+                const std::multimap<std::string, std::string> &params) const {
+    auto request = this->request(endpoint, params);
+    bool post = !request.form.empty();
+
+    // curl would decode a compressed body whole, it is decoded while it is
+    // parsed instead
+    cpr::Header header;
+    if (!m_accept_encoding.empty())
+        header.emplace("Accept-Encoding", m_accept_encoding);
+    if (post) {
+        header.emplace("Content-Type", "application/x-www-form-urlencoded");
+        // send the body at once, without waiting for a 100 Continue
+        header.emplace("Expect", "");
+    }
 
-    // add endpoint specific params to request_params
-    for (auto const &param : params) {
-        auto p = cpr::Parameter({param.first, param.second});
-        request_params.Add(p);
+    // borrow a keep-alive session, it goes back to the pool when done
+    auto session = m_pool->acquire();
+    session->SetUrl(cpr::Url{std::move(request.url)});
+    session->SetTimeout(cpr::Timeout{m_timeout});
+    session->SetAcceptEncoding(
+        cpr::AcceptEncoding{cpr::AcceptEncodingMethods::disabled});
+    session->SetHeader(header);
+    cpr::Response r;
+    if (post) {
+        session->SetBody(cpr::Body{std::move(request.form)});
+        r = session->Post();
+    } else {
+        r = session->Get();
     }
 
-    cpr::Response r =
-        cpr::Get(cpr::Url{m_server_url + endpoint}, request_params);
+    if (!r.error)
+        session.count_connections();
+    // a session keeps its body for the next requests, a GET would send it
+    if (r.error || post)
+        session.discard();
 
     // if the request is not successful
     if (r.status_code != 200)
         return std::unexpected(server::Error{
             static_cast<std::size_t>(r.status_code), r.error.message});
 
-    // if the request is successful
-    // (there may still be errors)
-    else {
-        json j = json::parse(r.text);
+    auto encoding = r.header.find("Content-Encoding");
+    return received_body(std::move(r.text), encoding != r.header.end()
+                                                  ? encoding->second
+                                                  : std::string_view());
+}
 
-        auto response = j["subsonic-response"]
-                            .template get<server::SubsonicResponse<Data>>();
+/// helper for GET requests
+template <class Data>
+std::expected<server::SubsonicResponse<Data>, server::Error>
+OSClient::get_req(const std::string &endpoint,
+                  const std::multimap<std::string, std::string> &params,
+                  const std::string &key,
+                  std::pmr::memory_resource *resource) const {
+    using Response = server::SubsonicResponse<Data>;
+
+    // responses in a caller's memory resource are never cached
+    detail::ResponseCache::Lifetime lifetime{};
+    if (m_cache && !resource)
+        lifetime = m_cache->lifetime(endpoint, params);
+    bool cached = lifetime.soft > lifetime.soft.zero();
+
+    std::string cache_key;
+    if (cached) {
+        cache_key = detail::ResponseCache::key<Data>(endpoint, params);
+        bool stale;
+        if (auto hit = m_cache->find<Response>(cache_key, &stale)) {
+            if (stale)
+                revalidate<Data>(endpoint, params, key);
+            return *hit;
+        }
 
-        // extract data
-        if (j["subsonic-response"].contains(key)) {
-            response.data = j["subsonic-response"][key].template get<Data>();
-            return response;
-        } else if (response.status == "ok" ||
-                   j["subsonic-response"].contains("error")) {
-            return response;
-        } else {
-            return std::unexpected(server::Error{500, "unknown key"});
+        // a response kept in the cache directory is used like one kept in
+        // memory for the time left of its lifetime
+        detail::ResponseCache::clock::duration age;
+        auto stored = m_cache->load(
+            detail::ResponseCache::request_key(endpoint, params), lifetime,
+            &age);
+        if (stored) {
+            std::size_t decoded;
+            auto response =
+                detail::read_response<Data>(*stored, key, {}, &decoded);
+            if (response && response->status == "ok" &&
+                m_cache->restore(cache_key,
+                                 std::make_shared<const Response>(*response),
+                                 decoded, lifetime, age,
+                                 detail::dependencies(endpoint, params,
+                                                      response->data),
+                                 &detail::patch<Data>)) {
+                if (age >= lifetime.soft)
+                    revalidate<Data>(endpoint, params, key);
+                return response;
+            }
         }
     }
+
+    auto request = [&]() -> std::expected<Response, server::Error> {
+        auto body = fetch(endpoint, params);
+        if (!body)
+            return std::unexpected(body.error());
+
+        // the request is successful, there may still be errors
+        std::size_t decoded;
+        auto response = read_body<Data>(
+            *m_transfers, endpoint, *body, key,
+            detail::ReadContext{.resource = resource}, &decoded);
+
+        if (cached && response && response->status == "ok")
+            cache_response(*m_cache, cache_key, endpoint, params, *response,
+                           *body, decoded);
+        return response;
+    };
+
+    // a model in the caller's memory resource is not shared
+    if (resource || !coalescable(endpoint, params))
+        return request();
+    if (cache_key.empty())
+        cache_key = detail::ResponseCache::key<Data>(endpoint, params);
+    return m_flights->run<std::expected<Response, server::Error>>(cache_key,
+                                                                  request);
 };
 
+/// helper for GET requests returning view models
+template <class Data>
+OSClient::View<Data>
+OSClient::get_view_req(const std::string &endpoint,
+                       const std::multimap<std::string, std::string> &params,
+                       const std::string &key) const {
+    auto body = fetch(endpoint, params);
+    if (!body)
+        return std::unexpected(body.error());
+
+    // the strings of the data and the data itself, freed together
+    struct Holder {
+        detail::StringArena strings;
+        Data data;
+    };
+    auto holder = std::make_shared<Holder>();
+
+    auto response = read_body<Data>(*m_transfers, endpoint, *body, key,
+                                    detail::ReadContext{&holder->strings});
+    if (!response)
+        return std::unexpected(response.error());
+    if (response->status != "ok")
+        return std::unexpected(response->error);
+
+    holder->data = std::move(response->data);
+    return std::shared_ptr<const Data>(holder, &holder->data);
+}
+
+// helper for GET requests reading the songs into a SongTable
+std::expected<SongTable, server::Error>
+OSClient::get_table_req(const std::string &endpoint,
+                        const std::multimap<std::string, std::string> &params,
+                        const std::string &key) const {
+    auto response = get_req<detail::SongTableData>(endpoint, params, key);
+    if (!response)
+        return std::unexpected(response.error());
+    if (response->status != "ok")
+        return std::unexpected(response->error);
+    return std::move(response->data.songs);
+}
+
+/// helper for asynchronous GET requests
+template <class Data, class Result>
+future<Result> OSClient::get_req_async(
+    const std::string &endpoint,
+    const std::multimap<std::string, std::string> &params,
+    const std::string &key,
+    Result (*finish)(
+        std::expected<server::SubsonicResponse<Data>, server::Error>),
+    std::function<void(detail::ResponseCache &)> cache_update) const {
+
+    auto state = std::make_shared<detail::future_state<Result>>();
+
+    // the cache is only updated while some client still uses it
+    std::weak_ptr<detail::ResponseCache> cache;
+    if (cache_update)
+        cache = m_cache;
+
+    // the callback runs on the loop's thread and must not touch the client,
+    // which may be gone by then
+    auto request = this->request(endpoint, params);
+    auto id = m_loop->submit(
+        std::move(request.url),
+        [state, endpoint, key, finish, cache, transfers = m_transfers,
+         cache_update = std::move(cache_update)](TransferResult r) {
+            if (r.status_code != 200) {
+                state->set_value(finish(std::unexpected(server::Error{
+                    static_cast<std::size_t>(r.status_code), r.error})));
+                return;
+            }
+            auto body = received_body(std::move(r.body), r.encoding);
+            if (!body) {
+                state->set_value(finish(std::unexpected(body.error())));
+                return;
+            }
+
+            auto response = read_body<Data>(*transfers, endpoint, *body, key);
+            if (response && response->status == "ok")
+                if (auto c = cache.lock())
+                    cache_update(*c);
+            state->set_value(finish(std::move(response)));
+        },
+        m_timeout, m_accept_encoding, std::move(request.form));
+
+    state->set_canceller([loop = std::weak_ptr(m_loop), id] {
+        if (auto l = loop.lock())
+            l->cancel(id);
+    });
+
+    return future<Result>(state);
+}
+
+// fetch a response answered from the cache directory again
+template <class Data>
+void OSClient::revalidate(const std::string &endpoint,
+                          const std::multimap<std::string, std::string> &params,
+                          const std::string &key) const {
+    auto cache_key = detail::ResponseCache::key<Data>(endpoint, params);
+    if (!m_cache->begin_refresh(cache_key))
+        return;
+
+    // like the asynchronous requests, the callback must not touch the client
+    auto request = this->request(endpoint, params);
+    m_loop->submit(
+        std::move(request.url),
+        [cache = std::weak_ptr(m_cache), transfers = m_transfers, cache_key,
+         endpoint, params, key](TransferResult r) {
+            auto c = cache.lock();
+            if (!c)
+                return;
+            auto body = received_body(std::move(r.body), r.encoding);
+            if (r.status_code == 200 && body) {
+                std::size_t decoded;
+                auto response = read_body<Data>(*transfers, endpoint, *body,
+                                                key, {}, &decoded);
+                if (response && response->status == "ok")
+                    cache_response(*c, cache_key, endpoint, params, *response,
+                                   *body, decoded);
+            }
+            c->end_refresh(cache_key);
+        },
+        m_timeout, m_accept_encoding, std::move(request.form));
+}
+
+// apply update to the response cache if a write request succeeded
+void OSClient::update_cache(
+    bool succeeded,
+    const std::function<void(detail::ResponseCache &)> &update) const {
+    if (m_cache && succeeded)
+        update(*m_cache);
+}
+
+// build a request, with its query string in the url or in a form
+OSClient::Request
+OSClient::request(const std::string &endpoint,
+                  const std::multimap<std::string, std::string> &params) const {
+    // built in a buffer reused by the requests of the thread, then copied
+    // once at its final size
+    thread_local std::string buffer;
+    buffer.assign(m_server_url);
+    buffer += endpoint;
+    auto path = buffer.size();
+    buffer += '?';
+    buffer += *m_credentials->query();
+    detail::append_params(buffer, params, detail::empty_param(endpoint));
+
+    if (buffer.size() - path - 1 > FORM_POST_MIN_SIZE &&
+        m_extensions->form_post()) {
+        m_transfers->add_form(endpoint);
+        return Request{buffer.substr(0, path), buffer.substr(path + 1)};
+    }
+    return Request{buffer, {}};
+}
+
 // check the response data
 template <class Data>
 std::expected<Data, server::Error>
-OSClient::check(server::SubsonicResponse<Data> &r) const {
+OSClient::check(server::SubsonicResponse<Data> &r) {
     if (r.status == "ok")
-        return r.data;
+        return std::move(r.data);
     else
         return std::unexpected(r.error);
 }
 
+// check the result of a request
+template <class Data>
+std::expected<Data, server::Error> OSClient::check_response(
+    std::expected<server::SubsonicResponse<Data>, server::Error> r) {
+    if (r)
+        return check(r.value());
+    else
+        return std::unexpected(r.error());
+}
+
+// Endpoints allocating from a memory resource:
+
+std::expected<pmr::Indexes, server::Error>
+OSClient::getIndexes(std::pmr::memory_resource *resource,
+                     const std::string &musicFolderId,
+                     const std::string &ifModifiedSince) const {
+    // make params
+    std::multimap<std::string, std::string> params{
+        {"musicFolderId", musicFolderId}, {"ifModifiedSince", ifModifiedSince}};
+
+    auto response =
+        get_req<pmr::Indexes>("getIndexes", params, "indexes", resource);
+    if (response)
+        return check(response.value());
+    else
+        return std::unexpected(response.error());
+}
+
+std::expected<pmr::Artists, server::Error>
+OSClient::getArtists(std::pmr::memory_resource *resource) const {
+    auto response =
+        get_req<pmr::Artists>("getArtists", {}, "artists", resource);
+    if (response)
+        return check(response.value());
+    else
+        return std::unexpected(response.error());
+}
+
+std::expected<pmr::AlbumID3WithSongs, server::Error>
+OSClient::getAlbum(std::pmr::memory_resource *resource,
+                   const std::string &id) const {
+    auto response = get_req<pmr::AlbumID3WithSongs>("getAlbum", {{"id", id}},
+                                                    "album", resource);
+    if (response)
+        return check(response.value());
+    else
+        return std::unexpected(response.error());
+}
+
+std::expected<pmr::SimilarSongs2, server::Error>
+OSClient::getSimilarSongs2(std::pmr::memory_resource *resource,
+                           const std::string &id,
+                           const std::string &count) const {
+    auto response = get_req<pmr::SimilarSongs2>(
+        "getSimilarSongs2", {{"id", id}, {"count", count}}, "similarSongs2",
+        resource);
+    if (response)
+        return check(response.value());
+    else
+        return std::unexpected(response.error());
+}
+
+std::expected<pmr::TopSongs, server::Error>
+OSClient::getTopSongs(std::pmr::memory_resource *resource,
+                      const std::string &artist,
+                      const std::string &count) const {
+    auto response = get_req<pmr::TopSongs>(
+        "getTopSongs", {{"artist", artist}, {"count", count}}, "topSongs",
+        resource);
+    if (response)
+        return check(response.value());
+    else
+        return std::unexpected(response.error());
+}
+
+std::expected<pmr::AlbumList2, server::Error>
+OSClient::getAlbumList2(std::pmr::memory_resource *resource,
+                        const std::string &type, const std::string &size,
+                        const std::string &offset, const std::string &fromYear,
+                        const std::string &toYear,
+                        const std::string &genre) const {
+    // make parameters
+    std::multimap<std::string, std::string> params{
+        {"type", type},         {"size", size},     {"offset", offset},
+        {"fromYear", fromYear}, {"toYear", toYear}, {"genre", genre}};
+
+    auto response = get_req<pmr::AlbumList2>("getAlbumList2", params,
+                                             "albumList2", resource);
+    if (response)
+        return check(response.value());
+    else
+        return std::unexpected(response.error());
+}
+
+std::expected<pmr::RandomSongs, server::Error>
+OSClient::getRandomSongs(std::pmr::memory_resource *resource,
+                         const std::string &size, const std::string &genre,
+                         const std::string &fromYear,
+                         const std::string &toYear) const {
+    // make params
+    std::multimap<std::string, std::string> params{{"size", size},
+                                                   {"genre", genre},
+                                                   {"fromYear", fromYear},
+                                                   {"toYear", toYear}};
+
+    auto response = get_req<pmr::RandomSongs>("getRandomSongs", params,
+                                              "randomSongs", resource);
+    if (response)
+        return check(response.value());
+    else
+        return std::unexpected(response.error());
+}
+
+std::expected<pmr::NowPlaying, server::Error>
+OSClient::getNowPlaying(std::pmr::memory_resource *resource) const {
+    auto response =
+        get_req<pmr::NowPlaying>("getNowPlaying", {}, "nowPlaying", resource);
+    if (response)
+        return check(response.value());
+    else
+        return std::unexpected(response.error());
+}
+
+std::expected<pmr::SearchResult3, server::Error>
+OSClient::search3(std::pmr::memory_resource *resource,
+                  const std::string &query, const std::string &artistCount,
+                  const std::string &artistOffset,
+                  const std::string &albumCount, const std::string &albumOffset,
+                  const std::string &songCount, const std::string &songOffset,
+                  const std::string &musicFolderId) const {
+    // make params
+    std::multimap<std::string, std::string> params{
+        {"query", query},
+        {"artistCount", artistCount},
+        {"artistOffset", artistOffset},
+        {"albumCount", albumCount},
+        {"albumOffset", albumOffset},
+        {"songCount", songCount},
+        {"songOffset", songOffset},
+        {"musicFolderId", musicFolderId}};
+
+    auto response = get_req<pmr::SearchResult3>("search3", params,
+                                                "searchResult3", resource);
+    if (response)
+        return check(response.value());
+    else
+        return std::unexpected(response.error());
+}
+
+std::expected<pmr::Playlists, server::Error>
+OSClient::getPlaylists(std::pmr::memory_resource *resource,
+                       const std::string &username) const {
+    auto response = get_req<pmr::Playlists>(
+        "getPlaylists", {{"username", username}}, "playlists", resource);
+    if (response)
+        return check(response.value());
+    else
+        return std::unexpected(response.error());
+}
+
+std::expected<pmr::PlaylistWithSongs, server::Error>
+OSClient::getPlaylist(std::pmr::memory_resource *resource,
+                      const std::string &id) const {
+    auto response = get_req<pmr::PlaylistWithSongs>(
+        "getPlaylist", {{"id", id}}, "playlist", resource);
+    if (response)
+        return check(response.value());
+    else
+        return std::unexpected(response.error());
+}
+
+// Song Table Endpoints:
+
+std::expected<SongTable, server::Error>
+OSClient::getAlbumTable(const std::string &id) const {
+    return get_table_req("getAlbum", {{"id", id}}, "album");
+}
+
+std::expected<SongTable, server::Error>
+OSClient::getRandomSongsTable(const std::string &size,
+                              const std::string &genre,
+                              const std::string &fromYear,
+                              const std::string &toYear) const {
+    // make params
+    std::multimap<std::string, std::string> params{{"size", size},
+                                                   {"genre", genre},
+                                                   {"fromYear", fromYear},
+                                                   {"toYear", toYear}};
+
+    return get_table_req("getRandomSongs", params, "randomSongs");
+}
+
+std::expected<SongTable, server::Error>
+OSClient::search3Table(const std::string &query, const std::string &songCount,
+                       const std::string &songOffset,
+                       const std::string &musicFolderId) const {
+    // only songs are wanted
+    std::multimap<std::string, std::string> params{
+        {"query", query},           {"artistCount", "0"},
+        {"albumCount", "0"},        {"songCount", songCount},
+        {"songOffset", songOffset}, {"musicFolderId", musicFolderId}};
+
+    return get_table_req("search3", params, "searchResult3");
+}
+
+std::expected<SongTable, server::Error>
+OSClient::getPlaylistTable(const std::string &id) const {
+    return get_table_req("getPlaylist", {{"id", id}}, "playlist");
+}
+
+// View Endpoints:
+
+OSClient::View<album::AlbumID3WithSongsView>
+OSClient::getAlbumView(const std::string &id) const {
+    return get_view_req<album::AlbumID3WithSongsView>("getAlbum", {{"id", id}},
+                                                      "album");
+}
+
+OSClient::View<album::AlbumList2View> OSClient::getAlbumList2View(
+    const std::string &type, const std::string &size,
+    const std::string &offset, const std::string &fromYear,
+    const std::string &toYear, const std::string &genre) const {
+    // make parameters
+    std::multimap<std::string, std::string> params{
+        {"type", type},         {"size", size},     {"offset", offset},
+        {"fromYear", fromYear}, {"toYear", toYear}, {"genre", genre}};
+
+    return get_view_req<album::AlbumList2View>("getAlbumList2", params,
+                                               "albumList2");
+}
+
+OSClient::View<media::RandomSongsView>
+OSClient::getRandomSongsView(const std::string &size, const std::string &genre,
+                             const std::string &fromYear,
+                             const std::string &toYear) const {
+    // make params
+    std::multimap<std::string, std::string> params{{"size", size},
+                                                   {"genre", genre},
+                                                   {"fromYear", fromYear},
+                                                   {"toYear", toYear}};
+
+    return get_view_req<media::RandomSongsView>("getRandomSongs", params,
+                                                "randomSongs");
+}
+
+OSClient::View<search::SearchResult3View> OSClient::search3View(
+    const std::string &query, const std::string &artistCount,
+    const std::string &artistOffset, const std::string &albumCount,
+    const std::string &albumOffset, const std::string &songCount,
+    const std::string &songOffset, const std::string &musicFolderId) const {
+    // make params
+    std::multimap<std::string, std::string> params{
+        {"query", query},
+        {"artistCount", artistCount},
+        {"artistOffset", artistOffset},
+        {"albumCount", albumCount},
+        {"albumOffset", albumOffset},
+        {"songCount", songCount},
+        {"songOffset", songOffset},
+        {"musicFolderId", musicFolderId}};
+
+    return get_view_req<search::SearchResult3View>("search3", params,
+                                                   "searchResult3");
+}
+
+// Asynchronous API Endpoints:
+
+// System
+OSClient::Future<server::SubsonicResponse<server::Error>>
+OSClient::pingAsync() const {
+    return get_req_async<server::Error>("ping", {}, "error",
+                                        &pass<server::Error>);
+}
+
+OSClient::Future<server::License> OSClient::getLicenseAsync() const {
+    return get_req_async<server::License>("getLicense", {}, "license",
+                                          &check_response<server::License>);
+}
+
+OSClient::Future<std::vector<server::OpenSubsonicExtension>>
+OSClient::getOpenSubsonicExtensionsAsync() const {
+    using Extensions = std::vector<server::OpenSubsonicExtension>;
+    return get_req_async<Extensions>("getOpenSubsonicExtensions", {},
+                                     "openSubsonicExtensions",
+                                     &check_response<Extensions>);
+}
+
+// Browsing
+OSClient::Future<misc::MusicFolders> OSClient::getMusicFoldersAsync() const {
+    return get_req_async<misc::MusicFolders>(
+        "getMusicFolders", {}, "musicFolders",
+        &check_response<misc::MusicFolders>);
+}
+
+OSClient::Future<artist::Indexes>
+OSClient::getIndexesAsync(const std::string &musicFolderId,
+                          const std::string &ifModifiedSince) const {
+    // make params
+    std::multimap<std::string, std::string> params{
+        {"musicFolderId", musicFolderId}, {"ifModifiedSince", ifModifiedSince}};
+
+    return get_req_async<artist::Indexes>("getIndexes", params, "indexes",
+                                          &check_response<artist::Indexes>);
+}
+
+OSClient::Future<misc::Genres> OSClient::getGenresAsync() const {
+    return get_req_async<misc::Genres>("getGenres", {}, "genres",
+                                       &check_response<misc::Genres>);
+}
+
+OSClient::Future<artist::Artists> OSClient::getArtistsAsync() const {
+    return get_req_async<artist::Artists>("getArtists", {}, "artists",
+                                          &check_response<artist::Artists>);
+}
+
+OSClient::Future<album::AlbumID3WithSongs>
+OSClient::getAlbumAsync(const std::string &id) const {
+    return get_req_async<album::AlbumID3WithSongs>(
+        "getAlbum", {{"id", id}}, "album",
+        &check_response<album::AlbumID3WithSongs>);
+}
+
+OSClient::Future<artist::ArtistInfo2>
+OSClient::getArtistInfo2Async(const std::string &id, const std::string &count,
+                              const std::string &includeNotPresent) const {
+    // make params
+    std::multimap<std::string, std::string> params{
+        {"id", id}, {"count", count}, {"includeNotPresent", includeNotPresent}};
+
+    return get_req_async<artist::ArtistInfo2>(
+        "getArtistInfo2", params, "artistInfo2",
+        &check_response<artist::ArtistInfo2>);
+}
+
+OSClient::Future<album::AlbumInfo>
+OSClient::getAlbumInfo2Async(const std::string &id) const {
+    return get_req_async<album::AlbumInfo>("getAlbumInfo2", {{"id", id}},
+                                           "albumInfo",
+                                           &check_response<album::AlbumInfo>);
+}
+
+OSClient::Future<media::SimilarSongs2>
+OSClient::getSimilarSongs2Async(const std::string &id,
+                                const std::string &count) const {
+    return get_req_async<media::SimilarSongs2>(
+        "getSimilarSongs2", {{"id", id}, {"count", count}}, "similarSongs2",
+        &check_response<media::SimilarSongs2>);
+}
+
+OSClient::Future<media::TopSongs>
+OSClient::getTopSongsAsync(const std::string &artist,
+                           const std::string &count) const {
+    return get_req_async<media::TopSongs>(
+        "getTopSongs", {{"artist", artist}, {"count", count}}, "topSongs",
+        &check_response<media::TopSongs>);
+}
+
+// Album/song lists
+OSClient::Future<album::AlbumList2> OSClient::getAlbumList2Async(
+    const std::string &type, const std::string &size,
+    const std::string &offset, const std::string &fromYear,
+    const std::string &toYear, const std::string &genre) const {
+    // make parameters
+    std::multimap<std::string, std::string> params{
+        {"type", type},         {"size", size},     {"offset", offset},
+        {"fromYear", fromYear}, {"toYear", toYear}, {"genre", genre}};
+
+    return get_req_async<album::AlbumList2>(
+        "getAlbumList2", params, "albumList2",
+        &check_response<album::AlbumList2>);
+}
+
+OSClient::Future<media::RandomSongs>
+OSClient::getRandomSongsAsync(const std::string &size, const std::string &genre,
+                              const std::string &fromYear,
+                              const std::string &toYear) const {
+    // make params
+    std::multimap<std::string, std::string> params{{"size", size},
+                                                   {"genre", genre},
+                                                   {"fromYear", fromYear},
+                                                   {"toYear", toYear}};
+
+    return get_req_async<media::RandomSongs>(
+        "getRandomSongs", params, "randomSongs",
+        &check_response<media::RandomSongs>);
+}
+
+OSClient::Future<media::NowPlaying> OSClient::getNowPlayingAsync() const {
+    return get_req_async<media::NowPlaying>(
+        "getNowPlaying", {}, "nowPlaying", &check_response<media::NowPlaying>);
+}
+
+// Searching
+OSClient::Future<search::SearchResult3> OSClient::search3Async(
+    const std::string &query, const std::string &artistCount,
+    const std::string &artistOffset, const std::string &albumCount,
+    const std::string &albumOffset, const std::string &songCount,
+    const std::string &songOffset, const std::string &musicFolderId) const {
+    // make params
+    std::multimap<std::string, std::string> params{
+        {"query", query},
+        {"artistCount", artistCount},
+        {"artistOffset", artistOffset},
+        {"albumCount", albumCount},
+        {"albumOffset", albumOffset},
+        {"songCount", songCount},
+        {"songOffset", songOffset},
+        {"musicFolderId", musicFolderId}};
+
+    return get_req_async<search::SearchResult3>(
+        "search3", params, "searchResult3",
+        &check_response<search::SearchResult3>);
+}
+
+// Playlists
+OSClient::Future<playlist::Playlists>
+OSClient::getPlaylistsAsync(const std::string &username) const {
+    return get_req_async<playlist::Playlists>(
+        "getPlaylists", {{"username", username}}, "playlists",
+        &check_response<playlist::Playlists>);
+}
+
+OSClient::Future<playlist::PlaylistWithSongs>
+OSClient::getPlaylistAsync(const std::string &id) const {
+    return get_req_async<playlist::PlaylistWithSongs>(
+        "getPlaylist", {{"id", id}}, "playlist",
+        &check_response<playlist::PlaylistWithSongs>);
+}
+
+OSClient::Future<playlist::PlaylistWithSongs>
+OSClient::createPlaylistAsync(const std::string &playlistId,
+                              const std::string &name,
+                              const std::vector<std::string> &songId) const {
+    // make params
+    std::multimap<std::string, std::string> params{{"playlistId", playlistId},
+                                                   {"name", name}};
+
+    // add songs
+    for (const auto &id : songId)
+        params.insert({"songId", id});
+
+    return get_req_async<playlist::PlaylistWithSongs>(
+        "createPlaylist", params, "playlist",
+        &check_response<playlist::PlaylistWithSongs>,
+        playlist_update(playlistId));
+}
+
+OSClient::Future<server::SubsonicResponse<server::Error>>
+OSClient::updatePlaylistAsync(
+    const std::string &playlistId, const std::string &name,
+    const std::string &comment, const std::string &isPublic,
+    const std::vector<std::string> &songIdToAdd,
+    const std::vector<std::string> &songIndexToRemove) const {
+    // make params
+    std::multimap<std::string, std::string> params{{"playlistId", playlistId},
+                                                   {"name", name},
+                                                   {"comment", comment},
+                                                   {"public", isPublic}};
+
+    // add songs
+    for (const auto &id : songIdToAdd)
+        params.insert({"songIdToAdd", id});
+
+    // songs to remove
+    for (const auto &index : songIndexToRemove)
+        params.insert({"songIndexToRemove", index});
+
+    return get_req_async<server::SubsonicResponse<server::Error>>(
+        "updatePlaylist", params, "",
+        &check_response<server::SubsonicResponse<server::Error>>,
+        playlist_update(playlistId));
+}
+
+OSClient::Future<server::SubsonicResponse<server::Error>>
+OSClient::deletePlaylistAsync(const std::string &id) const {
+    return get_req_async<server::SubsonicResponse<server::Error>>(
+        "deletePlaylist", {{"id", id}}, "",
+        &check_response<server::SubsonicResponse<server::Error>>,
+        playlist_update(id));
+}
+
+// Media annotation
+OSClient::Future<server::SubsonicResponse<server::Error>>
+OSClient::starAsync(const std::string &id, const std::string &albumId,
+                    const std::string &artistId) const {
+    // make params
+    std::multimap<std::string, std::string> params{
+        {"id", id}, {"albumId", albumId}, {"artistId", artistId}};
+
+    return get_req_async<server::SubsonicResponse<server::Error>>(
+        "star", params, "",
+        &check_response<server::SubsonicResponse<server::Error>>,
+        star_update(id, albumId, artistId));
+}
+
+OSClient::Future<server::SubsonicResponse<server::Error>>
+OSClient::unstarAsync(const std::string &id, const std::string &albumId,
+                      const std::string &artistId) const {
+    // make params
+    std::multimap<std::string, std::string> params{
+        {"id", id}, {"albumId", albumId}, {"artistId", artistId}};
+
+    return get_req_async<server::SubsonicResponse<server::Error>>(
+        "unstar", params, "",
+        &check_response<server::SubsonicResponse<server::Error>>,
+        unstar_update(id, albumId, artistId));
+}
+
+OSClient::Future<server::SubsonicResponse<server::Error>>
+OSClient::setRatingAsync(const std::string &id,
+                         const std::string &rating) const {
+    return get_req_async<server::SubsonicResponse<server::Error>>(
+        "setRating", {{"id", id}, {"rating", rating}}, "",
+        &check_response<server::SubsonicResponse<server::Error>>,
+        rating_update(id, rating));
+}
+
+OSClient::Future<server::SubsonicResponse<server::Error>>
+OSClient::scrobbleAsync(const std::string &id, const std::string &time,
+                        const std::string &submission) const {
+    // make params
+    std::multimap<std::string, std::string> params{
+        {"id", id}, {"time", time}, {"submission", submission}};
+
+    return get_req_async<server::SubsonicResponse<server::Error>>(
+        "scrobble", params, "",
+        &check_response<server::SubsonicResponse<server::Error>>,
+        scrobble_update(id, submission));
+}
+
+void uboat::from_json(const nlohmann::json &j, Symbol &s) {
+    s = j.get_ref<const json::string_t &>();
+}
+
+namespace uboat::detail {
+// to_owned() of every element, found by ADL
+template <class View>
+auto to_owned(const std::vector<View> &views)
+    -> std::vector<decltype(to_owned(views.front()))> {
+    std::vector<decltype(to_owned(views.front()))> v;
+    v.reserve(views.size());
+    for (auto &view : views)
+        v.push_back(to_owned(view));
+    return v;
+}
+
+std::vector<std::string>
+to_owned(const std::vector<std::string_view> &views) {
+    return {views.begin(), views.end()};
+}
+} // namespace uboat::detail
+
 namespace uboat::artist {
 // json parsers
 // ArtistID3
 void from_json(const nlohmann::json &j, ArtistID3 &a) {
-    j.at("id").get_to(a.id);
-    j.at("name").get_to(a.name);
-    set_if_contains(j, "coverArt", a.coverArt);
-    set_if_contains(j, "artistImageUrl", a.artistImageUrl);
-    set_if_contains(j, "albumCount", a.albumCount);
-    set_if_contains(j, "userRating", a.userRating);
-    set_if_contains(j, "starred", a.starred);
-    set_if_contains(j, "musicBrainzId", a.musicBrainzId);
-    set_if_contains(j, "sortName", a.sortName);
-    set_if_contains(j, "roles", a.roles);
+    detail::read_document(j, a);
 }
 // ArtistInfo2
 void from_json(const nlohmann::json &j, ArtistInfo2 &a) {
-    set_if_contains(j, "biography", a.biography);
-    set_if_contains(j, "musicBrainzId", a.musicBrainzId);
-    set_if_contains(j, "lastFmUrl", a.lastFmUrl);
-    set_if_contains(j, "smallImageUrl", a.smallImageUrl);
-    set_if_contains(j, "mediumImageUrl", a.mediumImageUrl);
-    set_if_contains(j, "largeImageUrl", a.largeImageUrl);
-    set_if_contains(j, "similarArtist", a.similarArtist);
+    detail::read_document(j, a);
 }
 // IndexID3
 void from_json(const nlohmann::json &j, IndexID3 &i) {
-    j.at("name").get_to(i.name);
-    j.at("artist").get_to(i.artist);
+    detail::read_document(j, i);
 }
 
 // Artists
 void from_json(const nlohmann::json &j, Artists &a) {
-    j.at("ignoredArticles").get_to(a.ignoredArticles);
-    set_if_contains(j, "index", a.index);
+    detail::read_document(j, a);
+}
+
+// Indexes
+void from_json(const nlohmann::json &j, Indexes &i) {
+    detail::read_document(j, i);
+}
+
+// views to owning models
+ArtistID3 to_owned(const ArtistID3View &a) {
+    return ArtistID3{std::string(a.id),
+                     std::string(a.name),
+                     std::string(a.coverArt),
+                     std::string(a.artistImageUrl),
+                     a.albumCount,
+                     a.userRating,
+                     std::string(a.starred),
+                     std::string(a.musicBrainzId),
+                     std::string(a.sortName),
+                     detail::to_owned(a.roles)};
 }
 } // namespace uboat::artist
 
@@ -567,24 +1602,35 @@ namespace uboat::misc {
 // json parsers
 // Genres
 void from_json(const nlohmann::json &j, Genres &g) {
-    set_if_contains(j, "genre", g.genre);
+    detail::read_document(j, g);
+}
+
+// MusicFolders
+void from_json(const nlohmann::json &j, MusicFolders &m) {
+    detail::read_document(j, m);
 }
 
 // ItemDate
 void from_json(const nlohmann::json &j, ItemDate &i) {
-    set_if_contains(j, "year", i.year);
-    set_if_contains(j, "month", i.month);
-    set_if_contains(j, "day", i.day);
+    detail::read_document(j, i);
 }
 
 // ReplayGain
 void from_json(const nlohmann::json &j, ReplayGain &r) {
-    set_if_contains(j, "trackGain", r.trackGain);
-    set_if_contains(j, "albumGain", r.albumGain);
-    set_if_contains(j, "trackPeak", r.trackPeak);
-    set_if_contains(j, "albumPeak", r.albumPeak);
-    set_if_contains(j, "baseGain", r.baseGain);
-    set_if_contains(j, "fallbackGain", r.fallbackGain);
+    detail::read_document(j, r);
+}
+
+// views to owning models
+RecordLabel to_owned(const RecordLabelView &r) {
+    return RecordLabel{std::string(r.name)};
+}
+
+ItemGenre to_owned(const ItemGenreView &i) {
+    return ItemGenre{Symbol(i.name)};
+}
+
+DiscTitle to_owned(const DiscTitleView &d) {
+    return DiscTitle{d.disc, std::string(d.title)};
 }
 } // namespace uboat::misc
 
@@ -592,87 +1638,88 @@ namespace uboat::media {
 // json parser
 // Child
 void from_json(const nlohmann::json &j, Child &c) {
-    j.at("id").get_to(c.id);
-
-    set_if_contains(j, "parent", c.parent);
-
-    j.at("isDir").get_to(c.isDir);
-    j.at("title").get_to(c.title);
-
-    set_if_contains(j, "album", c.album);
-    set_if_contains(j, "artist", c.artist);
-    set_if_contains(j, "track", c.track);
-    set_if_contains(j, "year", c.year);
-    set_if_contains(j, "genre", c.genre);
-    set_if_contains(j, "coverArt", c.coverArt);
-    set_if_contains(j, "size", c.size);
-    set_if_contains(j, "contentType", c.contentType);
-    set_if_contains(j, "suffix", c.suffix);
-    set_if_contains(j, "transcodedContentType", c.transcodedContentType);
-    set_if_contains(j, "transcodedSuffix", c.transcodedSuffix);
-    set_if_contains(j, "duration", c.duration);
-    set_if_contains(j, "bitRate", c.bitRate);
-    set_if_contains(j, "bitDepth", c.bitDepth);
-    set_if_contains(j, "samplingRate", c.samplingRate);
-    set_if_contains(j, "channelCount", c.channelCount);
-    set_if_contains(j, "path", c.path);
-    set_if_contains(j, "isVideo", c.isVideo);
-    set_if_contains(j, "userRating", c.userRating);
-    set_if_contains(j, "averageRating", c.averageRating);
-    set_if_contains(j, "playCount", c.playCount);
-    set_if_contains(j, "discNumber", c.discNumber);
-    set_if_contains(j, "created", c.created);
-    set_if_contains(j, "starred", c.starred);
-    set_if_contains(j, "albumId", c.albumId);
-    set_if_contains(j, "artistId", c.artistId);
-    set_if_contains(j, "type", c.type);
-    set_if_contains(j, "mediaType", c.mediaType);
-    set_if_contains(j, "bookmarkPosition", c.bookmarkPosition);
-    set_if_contains(j, "originalWidth", c.originalWidth);
-    set_if_contains(j, "originalHeight", c.originalHeight);
-    set_if_contains(j, "played", c.played);
-    set_if_contains(j, "bpm", c.bpm);
-    set_if_contains(j, "comment", c.comment);
-    set_if_contains(j, "sortName", c.sortName);
-    set_if_contains(j, "musicBrainzId", c.musicBrainzId);
-    set_if_contains(j, "genres", c.genres);
-    set_if_contains(j, "artists", c.artists);
-    set_if_contains(j, "displayArtist", c.displayArtist);
-    set_if_contains(j, "albumArtists", c.albumArtists);
-    set_if_contains(j, "displayAlbumArtist", c.displayAlbumArtist);
-    set_if_contains(j, "replayGain", c.replayGain);
+    detail::read_document(j, c);
 }
 
 // NowPlayingEntry
 void from_json(const nlohmann::json &j, NowPlayingEntry &n) {
-
-    from_json(j, static_cast<Child &>(n));
-
-    j.at("username").get_to(n.username);
-
-    set_if_contains(j, "minutesAgo", n.minutesAgo);
-    set_if_contains(j, "playerId", n.playerId);
-    set_if_contains(j, "playerName", n.playerName);
+    detail::read_document(j, n);
 }
 
 // RandomSongs
 void from_json(const nlohmann::json &j, RandomSongs &r) {
-    set_if_contains(j, "song", r.song);
+    detail::read_document(j, r);
 }
 
 // NowPlaying
 void from_json(const nlohmann::json &j, NowPlaying &n) {
-    set_if_contains(j, "entry", n.entry);
+    detail::read_document(j, n);
 }
 
 // SimilarSongs2
 void from_json(const nlohmann::json &j, SimilarSongs2 &s) {
-    set_if_contains(j, "song", s.song);
+    detail::read_document(j, s);
 }
 
 // TopSongs
 void from_json(const nlohmann::json &j, TopSongs &t) {
-    set_if_contains(j, "song", t.song);
+    detail::read_document(j, t);
+}
+
+// views to owning models
+Child to_owned(const ChildView &c) {
+    Child o;
+    o.id = c.id;
+    o.parent = c.parent;
+    o.isDir = c.isDir;
+    o.title = c.title;
+    o.album = c.album;
+    o.artist = c.artist;
+    o.track = c.track;
+    o.year = c.year;
+    o.genre = c.genre;
+    o.coverArt = c.coverArt;
+    o.size = c.size;
+    o.contentType = c.contentType;
+    o.suffix = c.suffix;
+    o.transcodedContentType = c.transcodedContentType;
+    o.transcodedSuffix = c.transcodedSuffix;
+    o.duration = c.duration;
+    o.bitRate = c.bitRate;
+    o.bitDepth = c.bitDepth;
+    o.samplingRate = c.samplingRate;
+    o.channelCount = c.channelCount;
+    o.path = c.path;
+    o.isVideo = c.isVideo;
+    o.userRating = c.userRating;
+    o.averageRating = c.averageRating;
+    o.playCount = c.playCount;
+    o.discNumber = c.discNumber;
+    o.created = c.created;
+    o.starred = c.starred;
+    o.albumId = c.albumId;
+    o.artistId = c.artistId;
+    o.type = c.type;
+    o.mediaType = c.mediaType;
+    o.bookmarkPosition = c.bookmarkPosition;
+    o.originalWidth = c.originalWidth;
+    o.originalHeight = c.originalHeight;
+    o.played = c.played;
+    o.bpm = c.bpm;
+    o.comment = c.comment;
+    o.sortName = c.sortName;
+    o.musicBrainzId = c.musicBrainzId;
+    o.genres = detail::to_owned(c.genres);
+    o.artists = detail::to_owned(c.artists);
+    o.displayArtist = c.displayArtist;
+    o.albumArtists = detail::to_owned(c.albumArtists);
+    o.displayAlbumArtist = c.displayAlbumArtist;
+    o.replayGain = c.replayGain;
+    return o;
+}
+
+RandomSongs to_owned(const RandomSongsView &r) {
+    return RandomSongs{detail::to_owned(r.song)};
 }
 } // namespace uboat::media
 
@@ -680,82 +1727,80 @@ namespace uboat::album {
 // json parsers
 // AlbumID3
 void from_json(const nlohmann::json &j, AlbumID3 &a) {
-    j.at("id").get_to(a.id);
-    j.at("name").get_to(a.name);
-
-    set_if_contains(j, "artist", a.artist);
-    set_if_contains(j, "artistId", a.artistId);
-    set_if_contains(j, "coverArt", a.coverArt);
-
-    j.at("songCount").get_to(a.songCount);
-    j.at("duration").get_to(a.duration);
-
-    set_if_contains(j, "playCount", a.playCount);
-
-    j.at("created").get_to(a.created);
-
-    set_if_contains(j, "starred", a.starred);
-    set_if_contains(j, "year", a.year);
-    set_if_contains(j, "played", a.played);
-    set_if_contains(j, "userRating", a.userRating);
-    set_if_contains(j, "recordLabels", a.recordLabels);
-    set_if_contains(j, "musicBrainzId", a.musicBrainzId);
-    set_if_contains(j, "genres", a.genres);
-    set_if_contains(j, "artists", a.artists);
-    set_if_contains(j, "displayArtist", a.displayArtist);
-    set_if_contains(j, "releaseTypes", a.releaseTypes);
-    set_if_contains(j, "moods", a.moods);
-    set_if_contains(j, "sortName", a.sortName);
-    set_if_contains(j, "originalReleaseDate", a.originalReleaseDate);
-    set_if_contains(j, "rCeleaseDate", a.releaseDate);
-    set_if_contains(j, "isCompilation", a.isCompilation);
-    set_if_contains(j, "discTitles", a.discTitles);
+    detail::read_document(j, a);
 }
 
 // AlbumID3WithSongs
 void from_json(const nlohmann::json &j, AlbumID3WithSongs &a) {
-    from_json(j, static_cast<AlbumID3 &>(a));
-    set_if_contains(j, "song", a.song);
+    detail::read_document(j, a);
 }
 
 // AlbumInfo
 void from_json(const nlohmann::json &j, AlbumInfo &a) {
-    set_if_contains(j, "notes", a.notes);
-    set_if_contains(j, "musicBrainzId", a.musicBrainzId);
-    set_if_contains(j, "lastFmUrl", a.lastFmUrl);
-    set_if_contains(j, "smallImageUrl", a.smallImageUrl);
-    set_if_contains(j, "mediumImageUrl", a.mediumImageUrl);
-    set_if_contains(j, "largeImageUrl", a.largeImageUrl);
+    detail::read_document(j, a);
 }
 
 // AlbumList2
 void from_json(const nlohmann::json &j, AlbumList2 &a) {
-    set_if_contains(j, "album", a.album);
+    detail::read_document(j, a);
+}
+
+// views to owning models
+AlbumID3 to_owned(const AlbumID3View &a) {
+    AlbumID3 o;
+    o.id = a.id;
+    o.name = a.name;
+    o.artist = a.artist;
+    o.artistId = a.artistId;
+    o.coverArt = a.coverArt;
+    o.songCount = a.songCount;
+    o.duration = a.duration;
+    o.playCount = a.playCount;
+    o.created = a.created;
+    o.starred = a.starred;
+    o.year = a.year;
+    o.genre = a.genre;
+    o.played = a.played;
+    o.changed = a.changed;
+    o.userRating = a.userRating;
+    o.recordLabels = detail::to_owned(a.recordLabels);
+    o.musicBrainzId = a.musicBrainzId;
+    o.genres = detail::to_owned(a.genres);
+    o.artists = detail::to_owned(a.artists);
+    o.displayArtist = a.displayArtist;
+    o.releaseTypes = detail::to_owned(a.releaseTypes);
+    o.moods = detail::to_owned(a.moods);
+    o.sortName = a.sortName;
+    o.originalReleaseDate = a.originalReleaseDate;
+    o.releaseDate = a.releaseDate;
+    o.isCompilation = a.isCompilation;
+    o.discTitles = detail::to_owned(a.discTitles);
+    return o;
+}
+
+AlbumID3WithSongs to_owned(const AlbumID3WithSongsView &a) {
+    AlbumID3WithSongs o;
+    static_cast<AlbumID3 &>(o) = to_owned(static_cast<const AlbumID3View &>(a));
+    o.song = detail::to_owned(a.song);
+    return o;
+}
+
+AlbumList2 to_owned(const AlbumList2View &a) {
+    return AlbumList2{detail::to_owned(a.album)};
 }
 } // namespace uboat::album
 
 namespace uboat::playlist {
 void from_json(const nlohmann::json &j, Playlist &p) {
-    j.at("id").get_to(p.id);
-    j.at("name").get_to(p.name);
-    set_if_contains(j, "comment", p.comment);
-    set_if_contains(j, "owner", p.owner);
-    set_if_contains(j, "public", p.isPublic);
-    j.at("songCount").get_to(p.songCount);
-    j.at("duration").get_to(p.duration);
-    j.at("created").get_to(p.created);
-    j.at("changed").get_to(p.changed);
-    set_if_contains(j, "coverArt", p.coverArt);
-    set_if_contains(j, "allowedUser", p.allowedUser);
+    detail::read_document(j, p);
 }
 
 void from_json(const nlohmann::json &j, Playlists &p) {
-    set_if_contains(j, "playlist", p.playlist);
+    detail::read_document(j, p);
 }
 
 void from_json(const nlohmann::json &j, PlaylistWithSongs &p) {
-    from_json(j, static_cast<Playlist &>(p));
-    set_if_contains(j, "entry", p.entry);
+    detail::read_document(j, p);
 }
 } // namespace uboat::playlist
 
@@ -763,9 +1808,13 @@ namespace uboat::search {
 
 // SearchResult3
 void from_json(const nlohmann::json &j, SearchResult3 &s) {
-    set_if_contains(j, "artist", s.artist);
-    set_if_contains(j, "album", s.album);
-    set_if_contains(j, "song", s.song);
+    detail::read_document(j, s);
+}
+
+// views to owning models
+SearchResult3 to_owned(const SearchResult3View &s) {
+    return SearchResult3{detail::to_owned(s.artist), detail::to_owned(s.album),
+                         detail::to_owned(s.song)};
 }
 } // namespace uboat::search
 
@@ -773,32 +1822,18 @@ namespace uboat::server {
 // json parsers
 // License
 void from_json(const nlohmann::json &j, License &l) {
-    j.at("valid").get_to(l.valid);
+    detail::read_document(j, l);
+}
 
-    set_if_contains(j, "email", l.email);
-    set_if_contains(j, "licenseExpires", l.licenseExpires);
-    set_if_contains(j, "trialExpires", l.trialExpires);
+// OpenSubsonicExtension
+void from_json(const nlohmann::json &j, OpenSubsonicExtension &o) {
+    detail::read_document(j, o);
 }
 
 // SubsonicResponse
 
 template <class Data>
 void from_json(const nlohmann::json &j, SubsonicResponse<Data> &s) {
-    j.at("status").get_to(s.status);
-    j.at("version").get_to(s.version);
-    j.at("type").get_to(s.type);
-    j.at("serverVersion").get_to(s.serverVersion);
-    j.at("openSubsonic").get_to(s.openSubsonic);
-
-    set_if_contains(j, "error", s.error);
+    detail::read_document(j, s);
 }
 } // namespace uboat::server
-
-namespace uboat {
-
-void set_if_contains(const nlohmann::json &j, const std::string &key, auto &v) {
-    if (j.contains(key))
-        j.at(key).get_to(v);
-}
-
-} // namespace uboat
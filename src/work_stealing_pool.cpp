@@ -0,0 +1,108 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <utility>
+
+using namespace uboat::detail;
+
+namespace {
+
+// the pool and the queue of the calling thread, if it is a thread of a pool
+thread_local const WorkStealingPool *t_pool = nullptr;
+thread_local std::size_t t_queue = 0;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(std::size_t threads) {
+    threads = std::max<std::size_t>(threads, 1);
+    for (std::size_t i = 0; i < threads; ++i)
+        m_queues.push_back(std::make_unique<Queue>());
+    for (std::size_t i = 0; i < threads; ++i)
+        m_threads.emplace_back([this, i] { run(i); });
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_queued_cv.notify_all();
+}
+
+void WorkStealingPool::submit(Task task) {
+    auto index = t_pool == this ? t_queue : m_next++ % m_queues.size();
+    // counted before it is queued, a thread may take and run it at once
+    {
+        std::lock_guard lock(m_mutex);
+        ++m_queued;
+        ++m_unfinished;
+    }
+    {
+        auto &queue = *m_queues[index];
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    m_queued_cv.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock lock(m_mutex);
+    m_idle_cv.wait(lock, [this] { return m_unfinished == 0; });
+}
+
+std::optional<WorkStealingPool::Task>
+WorkStealingPool::take(std::size_t index) {
+    auto counted = [this](Task task) {
+        std::lock_guard lock(m_mutex);
+        --m_queued;
+        return std::optional(std::move(task));
+    };
+
+    {
+        auto &own = *m_queues[index];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            auto task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return counted(std::move(task));
+        }
+    }
+
+    for (std::size_t i = 1; i < m_queues.size(); ++i) {
+        auto &other = *m_queues[(index + i) % m_queues.size()];
+        std::lock_guard lock(other.mutex);
+        if (!other.tasks.empty()) {
+            auto task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            ++m_steals;
+            return counted(std::move(task));
+        }
+    }
+    return std::nullopt;
+}
+
+void WorkStealingPool::run(std::size_t index) {
+    t_pool = this;
+    t_queue = index;
+    for (;;) {
+        auto task = take(index);
+        if (!task) {
+            std::unique_lock lock(m_mutex);
+            m_queued_cv.wait(lock, [this] { return m_stop || m_queued > 0; });
+            if (m_stop && m_queued == 0)
+                return;
+            continue;
+        }
+
+        (*task)();
+        task.reset();
+
+        std::lock_guard lock(m_mutex);
+        if (--m_unfinished == 0)
+            m_idle_cv.notify_all();
+    }
+}
@@ -0,0 +1,75 @@
+//
+// SPDX-License-Identifier: GPL-3.0-only
+//
+/// \work_stealing_pool.h
+/// A fixed pool of threads, each running the tasks of its own queue and
+/// taking the oldest tasks of the others once its queue is empty, so a
+/// thread stuck on a slow task does not hold up the tasks queued behind it.
+//
+
+#ifndef UBOAT_WORK_STEALING_POOL_H
+#define UBOAT_WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace uboat::detail {
+
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(std::size_t threads);
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+    /// runs the queued tasks, then joins the threads
+    ~WorkStealingPool();
+
+    /// queue a task, on the queue of the calling thread if it is a thread of
+    /// the pool, spread over the queues otherwise. Tasks must not throw.
+    void submit(Task task);
+
+    /// block until the submitted tasks, and the ones they submit, have run
+    void wait();
+
+    std::size_t threads() const { return m_queues.size(); }
+
+    /// number of tasks taken from the queue of another thread
+    std::size_t steals() const { return m_steals; }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(std::size_t index);
+    /// the newest task of queue index, or the oldest of another queue
+    std::optional<Task> take(std::size_t index);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+
+    std::mutex m_mutex;
+    std::condition_variable m_queued_cv; /* a task was queued or stopping */
+    std::condition_variable m_idle_cv;   /* all tasks have run */
+    std::size_t m_queued = 0;            /* tasks in the queues */
+    std::size_t m_unfinished = 0;        /* tasks queued or running */
+    bool m_stop = false;
+
+    std::atomic<std::size_t> m_next = 0; /* queue of the next outside task */
+    std::atomic<std::size_t> m_steals = 0;
+
+    std::vector<std::jthread> m_threads; /* joined first on destruction */
+};
+
+} // namespace uboat::detail
+
+#endif /* UBOAT_WORK_STEALING_POOL_H */
@@ -7,5 +7,6 @@ static constexpr std::string TEST_SERVER = "127.0.0.1:4533";
 static constexpr std::string TEST_USERNAME = "karl";
 static constexpr std::string TEST_PASSWORD = "donitz";
 static constexpr std::string TEST_CLIENT_NAME = "uboat_test";
+static constexpr std::string TEST_API_KEY = "uboat-test-key";
 
 #endif /* COMMON_H */
@@ -0,0 +1,195 @@
+#include "uboat/uboat.h"
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "common.h"
+
+namespace {
+
+uboat::task<std::size_t> count_songs(const uboat::OSClient &client) {
+    auto albums = co_await client.getAlbumList2Async("random");
+    if (!albums)
+        co_return 0;
+
+    std::size_t songs = 0;
+    for (const auto &album : albums.value().album) {
+        auto result = co_await client.getAlbumAsync(album.id);
+        if (result)
+            songs += result.value().song.size();
+    }
+    co_return songs;
+}
+
+uboat::task<std::string> genres_error(const uboat::OSClient &client) {
+    auto result = co_await client.getGenresAsync();
+    co_return result ? "" : result.error().message;
+}
+
+uboat::task<std::string> nested_genres_error(const uboat::OSClient &client) {
+    co_return co_await genres_error(client);
+}
+
+} // namespace
+
+TEST_SUITE("Asynchronous requests") {
+    auto client = uboat::OSClient(TEST_SERVER, TEST_USERNAME, TEST_PASSWORD,
+                                  TEST_CLIENT_NAME);
+
+    TEST_CASE("test env check") {
+        SUBCASE("server alive") {
+            auto ping_result = client.pingAsync().get();
+            CHECK(ping_result.has_value());
+            CHECK_EQ(ping_result.value().error.code, 40);
+        }
+
+        SUBCASE("auth successful") {
+            auto auth_result = client.authenticate();
+            REQUIRE(auth_result.has_value());
+        }
+    }
+
+    TEST_CASE("many requests in flight") {
+        auto albums = client.getAlbumList2Async("random").get();
+        REQUIRE(albums.has_value());
+        REQUIRE_FALSE(albums.value().album.empty());
+
+        auto list = albums.value().album;
+
+        std::vector<uboat::OSClient::Future<uboat::album::AlbumID3WithSongs>>
+            futures;
+        for (std::size_t i = 0; i < 100; ++i) {
+            auto id = list.at(i % list.size()).id;
+            futures.push_back(client.getAlbumAsync(id));
+        }
+
+        for (std::size_t i = 0; i < futures.size(); ++i) {
+            auto result = futures[i].get();
+            REQUIRE(result.has_value());
+            CHECK_EQ(result.value().id, list.at(i % list.size()).id);
+        }
+    }
+
+    TEST_CASE("with wrong id") {
+        auto result = client.getAlbumAsync("wrong").get();
+        CHECK_FALSE(result.has_value());
+        CHECK_EQ(result.error().code, 70);
+    }
+
+    TEST_CASE("server not found") {
+        auto client_wrong = uboat::OSClient("127.0.0.666", TEST_USERNAME,
+                                            TEST_PASSWORD, TEST_CLIENT_NAME);
+        auto result = client_wrong.pingAsync().get();
+        CHECK_FALSE(result.has_value());
+        CHECK_EQ(result.error().code, 0);
+    }
+
+    TEST_CASE("event loop released by its own callback") {
+        auto loop = std::make_shared<uboat::EventLoop>();
+        std::promise<void> scheduled;
+        std::promise<void> released;
+        // the last reference goes on the thread of the loop, once this one
+        // is done with it
+        loop->call_after(std::chrono::milliseconds(0),
+                         [&, go = scheduled.get_future().share()] {
+                             go.wait();
+                             loop.reset();
+                             released.set_value();
+                         });
+        scheduled.set_value();
+        auto future = released.get_future();
+        REQUIRE_EQ(future.wait_for(std::chrono::seconds(5)),
+                   std::future_status::ready);
+        CHECK_FALSE(loop);
+
+        // and by the caller's poll()
+        loop = std::make_shared<uboat::EventLoop>(false);
+        bool called = false;
+        loop->call_after(std::chrono::milliseconds(0), [&] {
+            loop.reset();
+            called = true;
+        });
+        loop->poll(std::chrono::milliseconds(0));
+        CHECK(called);
+        CHECK_FALSE(loop);
+    }
+
+    TEST_CASE("caller driven event loop") {
+        auto loop = std::make_shared<uboat::EventLoop>(false);
+        uboat::ClientOptions options;
+        options.event_loop = loop;
+
+        auto driven = uboat::OSClient(TEST_SERVER, TEST_USERNAME,
+                                      TEST_PASSWORD, TEST_CLIENT_NAME, options);
+        auto future = driven.getGenresAsync();
+        CHECK_EQ(loop->in_flight(), 1);
+
+        while (loop->in_flight() > 0)
+            loop->poll(std::chrono::milliseconds(100));
+
+        REQUIRE_EQ(future.wait_for(std::chrono::seconds(0)),
+                   std::future_status::ready);
+        auto result = future.get();
+        // not authenticated
+        CHECK_FALSE(result.has_value());
+        CHECK_EQ(result.error().code, 40);
+    }
+
+    TEST_CASE("coroutines") {
+        auto albums = client.getAlbumList2("random");
+        REQUIRE(albums.has_value());
+
+        std::size_t songs = 0;
+        for (const auto &album : albums.value().album)
+            songs += album.songCount;
+
+        CHECK_EQ(uboat::sync_wait(count_songs(client)), songs);
+    }
+
+    TEST_CASE("cancellation") {
+        auto loop = std::make_shared<uboat::EventLoop>(false);
+        uboat::ClientOptions options;
+        options.event_loop = loop;
+
+        auto driven = uboat::OSClient(TEST_SERVER, TEST_USERNAME,
+                                      TEST_PASSWORD, TEST_CLIENT_NAME, options);
+
+        // drive the loop from another thread, starting after delay
+        auto drive = [&loop](std::chrono::milliseconds delay) {
+            return std::jthread([&loop, delay](std::stop_token stop) {
+                std::this_thread::sleep_for(delay);
+                while (!stop.stop_requested())
+                    loop->poll(std::chrono::milliseconds(10));
+            });
+        };
+
+        SUBCASE("cancel future") {
+            // the request starts at once, the loop must not finish it
+            // before it is cancelled
+            auto future = driven.getGenresAsync();
+            future.cancel();
+            auto driver = drive(std::chrono::milliseconds(0));
+            auto result = future.get();
+            CHECK_FALSE(result.has_value());
+            CHECK_EQ(result.error().message, "request cancelled");
+        }
+
+        SUBCASE("cancel task") {
+            auto driver = drive(std::chrono::milliseconds(0));
+            auto task = nested_genres_error(driven);
+            task.cancel();
+            CHECK_EQ(uboat::sync_wait(std::move(task)), "request cancelled");
+        }
+
+        SUBCASE("task timeout") {
+            // the timer is due before the request gets started
+            auto driver = drive(std::chrono::milliseconds(50));
+            auto task = nested_genres_error(driven);
+            task.cancel_after(*loop, std::chrono::milliseconds(0));
+            CHECK_EQ(uboat::sync_wait(std::move(task)), "request cancelled");
+        }
+    }
+}
@@ -1,4 +1,7 @@
 #include "uboat/uboat.h"
+#include <memory_resource>
+#include <string>
+#include <string_view>
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 
@@ -21,6 +24,32 @@ TEST_SUITE("Browsing") {
         }
     }
 
+    TEST_CASE("getMusicFolders") {
+        auto result = client.getMusicFolders();
+        REQUIRE(result.has_value());
+        REQUIRE_EQ(result.value().musicFolder.size(), 1);
+        CHECK_EQ(result.value().musicFolder[0].name, "Music");
+    }
+
+    TEST_CASE("getIndexes") {
+        SUBCASE("get all") {
+            auto result = client.getIndexes();
+            REQUIRE(result.has_value());
+            CHECK_EQ(result.value().index.size(), 2);
+            CHECK_GT(result.value().lastModified, 0);
+        }
+
+        SUBCASE("not modified since") {
+            auto all = client.getIndexes();
+            REQUIRE(all.has_value());
+            auto since = std::to_string(all.value().lastModified);
+            auto result = client.getIndexes("", since);
+            REQUIRE(result.has_value());
+            CHECK(result.value().index.empty());
+            CHECK_EQ(result.value().lastModified, all.value().lastModified);
+        }
+    }
+
     TEST_CASE("getGenres") {
         SUBCASE("get all") {
             auto result = client.getGenres();
@@ -35,6 +64,24 @@ TEST_SUITE("Browsing") {
             CHECK(result.has_value());
             CHECK_EQ(result.value().index.size(), 2);
         }
+
+        SUBCASE("allocating from a resource") {
+            auto result = client.getArtists();
+            REQUIRE(result.has_value());
+            std::pmr::monotonic_buffer_resource arena;
+            auto pmrResult = client.getArtists(&arena);
+            REQUIRE(pmrResult.has_value());
+            REQUIRE_EQ(pmrResult.value().index.size(), 2);
+            auto &artist = pmrResult.value().index.at(0).artist.at(0);
+            CHECK_EQ(std::string_view(artist.name),
+                     result.value().index.at(0).artist.at(0).name);
+            CHECK_EQ(artist.name.get_allocator().resource(), &arena);
+
+            auto indexes = client.getIndexes(&arena);
+            REQUIRE(indexes.has_value());
+            CHECK_EQ(indexes.value().index.size(), 2);
+            CHECK_EQ(indexes.value().index.get_allocator().resource(), &arena);
+        }
     }
 
     TEST_CASE("getAlbum") {
@@ -60,6 +107,23 @@ TEST_SUITE("Browsing") {
             CHECK_FALSE(result.has_value());
             CHECK_EQ(result.error().code, 70);
         }
+
+        SUBCASE("as view") {
+            auto id = albumlist.at(0).id;
+            auto owned = client.getAlbum(id);
+            auto view = client.getAlbumView(id);
+            REQUIRE(owned.has_value());
+            REQUIRE(view.has_value());
+            CHECK_EQ((*view)->id, id);
+            REQUIRE_EQ((*view)->song.size(), owned.value().song.size());
+            CHECK_EQ((*view)->song.at(0).title, owned.value().song.at(0).title);
+            CHECK_EQ(to_owned(**view).song.at(0).path,
+                     owned.value().song.at(0).path);
+
+            auto wrong = client.getAlbumView("wrong");
+            CHECK_FALSE(wrong.has_value());
+            CHECK_EQ(wrong.error().code, 70);
+        }
     }
 
     TEST_CASE("getArtistInfo2") {
@@ -113,6 +177,11 @@ TEST_SUITE("Browsing") {
         auto result = client.getSimilarSongs2(id);
 
         CHECK(result.has_value());
+
+        std::pmr::monotonic_buffer_resource arena;
+        auto pmrResult = client.getSimilarSongs2(&arena, id);
+        REQUIRE(pmrResult.has_value());
+        CHECK_EQ(pmrResult.value().song.get_allocator().resource(), &arena);
     }
 
     TEST_CASE("getTopSongs") {
@@ -124,5 +193,11 @@ TEST_SUITE("Browsing") {
         auto result = client.getTopSongs(artist);
 
         CHECK(result.has_value());
+
+        std::pmr::monotonic_buffer_resource arena;
+        auto pmrResult = client.getTopSongs(&arena, artist);
+        REQUIRE(pmrResult.has_value());
+        CHECK_EQ(pmrResult.value().song.size(), result.value().song.size());
+        CHECK_EQ(pmrResult.value().song.get_allocator().resource(), &arena);
     }
 }
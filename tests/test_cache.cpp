@@ -0,0 +1,707 @@
+#include "uboat/uboat.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "common.h"
+#include "cache_dependencies.h"
+#include "disk_cache.h"
+#include "response_cache.h"
+
+using uboat::detail::DiskCache;
+using uboat::detail::Entity;
+using uboat::detail::ResponseCache;
+
+namespace {
+
+uboat::CacheOptions options(std::size_t max_bytes) {
+    uboat::CacheOptions o;
+    o.max_bytes = max_bytes;
+    o.ttl = {{"getGenres", std::chrono::minutes(1)}};
+    o.stale = {};
+    return o;
+}
+
+// a lifetime without a stale period
+ResponseCache::Lifetime fresh(ResponseCache::clock::duration ttl) {
+    return {ttl, ttl};
+}
+
+// an empty directory, removed at the end of the test
+struct TempDirectory {
+    std::filesystem::path path =
+        std::filesystem::temp_directory_path() /
+        ("uboat_test_cache_" + std::to_string(::getpid()));
+    TempDirectory() { std::filesystem::remove_all(path); }
+    ~TempDirectory() { std::filesystem::remove_all(path); }
+};
+
+// the decoded body of a stored one
+std::optional<std::string> text(std::optional<uboat::detail::Body> body) {
+    if (!body)
+        return std::nullopt;
+    auto decoded = uboat::detail::decode(*body);
+    if (!decoded)
+        return std::nullopt;
+    return *decoded;
+}
+
+// getAlbum response of an album with two songs by one artist
+uboat::server::SubsonicResponse<uboat::album::AlbumID3WithSongs> album() {
+    uboat::server::SubsonicResponse<uboat::album::AlbumID3WithSongs> r{};
+    r.status = "ok";
+    r.data.id = "al1";
+    r.data.artists.push_back(uboat::artist::ArtistID3{.id = "ar1"});
+    for (auto id : {"s1", "s2"}) {
+        auto &song = r.data.song.emplace_back();
+        song.id = id;
+        song.albumId = "al1";
+        song.artists.push_back(uboat::artist::ArtistID3{.id = "ar1"});
+    }
+    return r;
+}
+
+template <class Data>
+void insert(ResponseCache &cache, const std::string &key,
+            const std::string &endpoint,
+            const std::multimap<std::string, std::string> &params,
+            uboat::server::SubsonicResponse<Data> r) {
+    auto deps = uboat::detail::dependencies(endpoint, params, r.data);
+    cache.insert(key,
+                 std::make_shared<const decltype(r)>(std::move(r)), 100,
+                 fresh(std::chrono::minutes(1)), std::move(deps),
+                 &uboat::detail::patch<Data>);
+}
+
+} // namespace
+
+TEST_SUITE("ResponseCache") {
+    TEST_CASE("keys") {
+        auto a = ResponseCache::key<int>("getAlbum", {{"id", "1"}});
+        CHECK_EQ(a, ResponseCache::key<int>("getAlbum", {{"id", "1"}}));
+        CHECK_NE(a, ResponseCache::key<int>("getAlbum", {{"id", "2"}}));
+        CHECK_NE(a, ResponseCache::key<int>("getAlbumInfo2", {{"id", "1"}}));
+        // the same request read into another model
+        CHECK_NE(a, ResponseCache::key<long>("getAlbum", {{"id", "1"}}));
+
+        // empty params are left out, names are ordered by the multimap
+        CHECK_EQ(ResponseCache::key<int>("getArtistInfo2",
+                                         {{"id", "1"}, {"count", ""}}),
+                 ResponseCache::key<int>("getArtistInfo2", {{"id", "1"}}));
+        CHECK_EQ(
+            ResponseCache::key<int>("search3", {{"query", "a"}, {"n", "1"}}),
+            ResponseCache::key<int>("search3", {{"n", "1"}, {"query", "a"}}));
+
+        // repeated params keep their order
+        CHECK_NE(ResponseCache::key<int>("updatePlaylist",
+                                         {{"songIdToAdd", "1"},
+                                          {"songIdToAdd", "2"}}),
+                 ResponseCache::key<int>("updatePlaylist",
+                                         {{"songIdToAdd", "2"},
+                                          {"songIdToAdd", "1"}}));
+    }
+
+    TEST_CASE("hits and misses") {
+        ResponseCache cache(options(1 << 20));
+        CHECK_EQ(cache.lifetime("getGenres", {}).soft,
+                 std::chrono::minutes(1));
+        CHECK_EQ(cache.lifetime("getRandomSongs", {}).soft,
+                 ResponseCache::clock::duration{});
+
+        CHECK_FALSE(cache.find<std::string>("a"));
+        cache.insert("a", std::make_shared<const std::string>("A"), 10,
+                     fresh(std::chrono::minutes(1)));
+        auto a = cache.find<std::string>("a");
+        REQUIRE(a);
+        CHECK_EQ(*a, "A");
+
+        auto stats = cache.stats();
+        CHECK_EQ(stats.hits, 1);
+        CHECK_EQ(stats.misses, 1);
+        CHECK_EQ(stats.entries, 1);
+        CHECK_GT(stats.bytes, 10);
+
+        cache.clear();
+        CHECK_FALSE(cache.find<std::string>("a"));
+        CHECK_EQ(cache.stats().bytes, 0);
+        // the value outlives the cache entry
+        CHECK_EQ(*a, "A");
+    }
+
+    TEST_CASE("a ttl replaces the default stale policy of its endpoint") {
+        uboat::CacheOptions o;
+        o.ttl["getArtists"] = std::chrono::minutes(1);
+        o.ttl["getAlbumList2"] = std::chrono::seconds(30);
+        ResponseCache cache(o);
+
+        auto artists = cache.lifetime("getArtists", {});
+        CHECK_EQ(artists.soft, std::chrono::minutes(1));
+        CHECK_EQ(artists.hard, std::chrono::minutes(1));
+        auto newest = cache.lifetime("getAlbumList2", {{"type", "newest"}});
+        CHECK_EQ(newest.soft, std::chrono::seconds(30));
+        CHECK_EQ(newest.hard, std::chrono::seconds(30));
+        // the others keep theirs
+        auto genres = cache.lifetime("getGenres", {});
+        CHECK_EQ(genres.soft, std::chrono::minutes(10));
+        CHECK_EQ(genres.hard, std::chrono::hours(24));
+    }
+
+    TEST_CASE("expiry") {
+        ResponseCache cache(options(1 << 20));
+        cache.insert("a", std::make_shared<const int>(1), 10,
+                     fresh(std::chrono::milliseconds(1)));
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        CHECK_FALSE(cache.find<int>("a"));
+        CHECK_EQ(cache.stats().entries, 0);
+        CHECK_EQ(cache.stats().evictions, 0);
+    }
+
+    TEST_CASE("stale entries are served until the hard TTL") {
+        auto o = options(1 << 20);
+        o.stale = {{"getArtists", {std::chrono::minutes(1),
+                                   std::chrono::hours(1)}},
+                   {"getAlbumList2?type=newest",
+                    {std::chrono::seconds(10), std::chrono::minutes(1)}}};
+        ResponseCache cache(o);
+
+        auto artists = cache.lifetime("getArtists", {});
+        CHECK_EQ(artists.soft, std::chrono::minutes(1));
+        CHECK_EQ(artists.hard, std::chrono::hours(1));
+        CHECK_EQ(cache.lifetime("getAlbumList2", {{"type", "newest"}}).soft,
+                 std::chrono::seconds(10));
+        CHECK_EQ(cache.lifetime("getAlbumList2", {{"type", "random"}}).soft,
+                 ResponseCache::clock::duration{});
+        // the ttl of the endpoint is both
+        auto genres = cache.lifetime("getGenres", {});
+        CHECK_EQ(genres.soft, genres.hard);
+        // an explicit stale entry wins over a ttl
+        o.ttl["getArtists"] = std::chrono::seconds(5);
+        CHECK_EQ(ResponseCache(o).lifetime("getArtists", {}).hard,
+                 std::chrono::hours(1));
+
+        cache.insert("a", std::make_shared<const int>(1), 10,
+                     {std::chrono::milliseconds(1), std::chrono::minutes(1)});
+        cache.insert("b", std::make_shared<const int>(2), 10,
+                     {std::chrono::milliseconds(1),
+                      std::chrono::milliseconds(2)});
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        bool stale = false;
+        auto a = cache.find<int>("a", &stale);
+        REQUIRE(a);
+        CHECK_EQ(*a, 1);
+        CHECK(stale);
+        CHECK_FALSE(cache.find<int>("b", &stale));
+        CHECK_EQ(cache.stats().stale_hits, 1);
+
+        // replaced by the refreshed response
+        cache.insert("a", std::make_shared<const int>(3), 10,
+                     fresh(std::chrono::minutes(1)));
+        CHECK_EQ(*cache.find<int>("a", &stale), 3);
+        CHECK_FALSE(stale);
+    }
+
+    TEST_CASE("one refresh of a key at a time") {
+        ResponseCache cache(options(1 << 20));
+        CHECK(cache.begin_refresh("a"));
+        CHECK_FALSE(cache.begin_refresh("a"));
+        CHECK(cache.begin_refresh("b"));
+        cache.end_refresh("a");
+        CHECK(cache.begin_refresh("a"));
+        CHECK_EQ(cache.stats().refreshes, 3);
+    }
+
+    TEST_CASE("least recently used entries are evicted") {
+        ResponseCache cache(options(4096));
+        auto insert = [&](const std::string &key) {
+            cache.insert(key, std::make_shared<const int>(0), 1000,
+                         fresh(std::chrono::minutes(1)));
+        };
+
+        insert("a");
+        insert("b");
+        insert("c");
+        CHECK(cache.find<int>("a")); /* b is now the oldest */
+        insert("d");
+
+        CHECK_EQ(cache.stats().evictions, 1);
+        CHECK_FALSE(cache.find<int>("b"));
+        CHECK(cache.find<int>("a"));
+        CHECK(cache.find<int>("c"));
+        CHECK(cache.find<int>("d"));
+        CHECK_LE(cache.stats().bytes, 4096);
+
+        // too large to be cached at all
+        insert("e");
+        cache.insert("f", std::make_shared<const int>(0), 5000,
+                     fresh(std::chrono::minutes(1)));
+        CHECK_FALSE(cache.find<int>("f"));
+    }
+}
+
+TEST_SUITE("Cache dependencies") {
+    using Album =
+        uboat::server::SubsonicResponse<uboat::album::AlbumID3WithSongs>;
+
+    TEST_CASE("entities of a response") {
+        auto r = album();
+        auto deps =
+            uboat::detail::dependencies("getAlbum", {{"id", "al1"}}, r.data);
+        CHECK_EQ(deps, std::vector<std::string>{"album:al1", "artist:ar1",
+                                                "song:s1", "song:s2"});
+
+        uboat::playlist::Playlists playlists;
+        playlists.playlist.push_back(uboat::playlist::Playlist{.id = "p1"});
+        CHECK_EQ(uboat::detail::dependencies("getPlaylists", {}, playlists),
+                 std::vector<std::string>{"playlist:p1", "playlists"});
+    }
+
+    TEST_CASE("patches only the entities changed") {
+        ResponseCache cache(options(1 << 20));
+        insert(cache, "a", "getAlbum", {{"id", "al1"}}, album());
+        auto before = cache.find<Album>("a");
+
+        cache.patch({ResponseCache::dependency(Entity::Song, "s2")},
+                    uboat::detail::Change{.id = "s2", .userRating = 4});
+
+        auto after = cache.find<Album>("a");
+        REQUIRE(after);
+        CHECK_EQ(after->data.song[0].userRating, 0);
+        CHECK_EQ(after->data.song[1].userRating, 4);
+        CHECK_EQ(cache.stats().patches, 1);
+        // readers of the previous value are not affected
+        CHECK_EQ(before->data.song[1].userRating, 0);
+
+        cache.patch({ResponseCache::dependency(Entity::Artist, "ar1")},
+                    uboat::detail::Change{.id = "ar1", .starred = ""});
+        CHECK_EQ(cache.stats().patches, 2);
+        CHECK_EQ(cache.stats().invalidations, 0);
+    }
+
+    TEST_CASE("invalidates only the dependents") {
+        ResponseCache cache(options(1 << 20));
+        for (auto id : {"p1", "p2"}) {
+            uboat::server::SubsonicResponse<uboat::playlist::PlaylistWithSongs>
+                r{};
+            r.status = "ok";
+            r.data.id = id;
+            insert(cache, id, "getPlaylist", {{"id", id}}, std::move(r));
+        }
+        insert(cache, "a", "getAlbum", {{"id", "al1"}}, album());
+
+        cache.invalidate({ResponseCache::dependency(Entity::Playlist, "p1")});
+        CHECK_FALSE(cache.find<int>("p1"));
+        CHECK(cache.find<int>("p2"));
+        CHECK(cache.find<int>("a"));
+        CHECK_EQ(cache.stats().invalidations, 1);
+
+        // removed entries leave no dependency behind
+        cache.invalidate({ResponseCache::dependency(Entity::Song, "s1"),
+                          ResponseCache::dependency(Entity::Album, "al1")});
+        CHECK_FALSE(cache.find<int>("a"));
+        CHECK_EQ(cache.stats().invalidations, 2);
+        cache.invalidate({ResponseCache::dependency(Entity::Song, "s2")});
+        CHECK_EQ(cache.stats().invalidations, 2);
+        CHECK_EQ(cache.stats().entries, 1);
+    }
+
+    TEST_CASE("the cache directory is used within the lifetime") {
+        TempDirectory dir;
+        auto o = options(1 << 20);
+        o.directory = dir.path;
+        ResponseCache cache(o);
+
+        auto request = ResponseCache::request_key("getGenres", {});
+        cache.save(request, {"body"});
+        ResponseCache::clock::duration age;
+        CHECK_EQ(text(cache.load(request, fresh(std::chrono::minutes(1)),
+                                 &age)),
+                 "body");
+        CHECK_LT(age, std::chrono::seconds(2));
+        CHECK_FALSE(cache.load(request, fresh({}), &age));
+    }
+
+    TEST_CASE("write requests reach the cache directory") {
+        TempDirectory dir;
+        auto o = options(1 << 20);
+        o.directory = dir.path;
+        auto lifetime = fresh(std::chrono::minutes(1));
+        std::multimap<std::string, std::string> params{{"id", "al1"}};
+        auto request = ResponseCache::request_key("getAlbum", params);
+        auto key = ResponseCache::key<uboat::album::AlbumID3WithSongs>(
+            "getAlbum", params);
+        auto song = ResponseCache::dependency(Entity::Song, "s1");
+        ResponseCache::clock::duration age;
+
+        {
+            ResponseCache cache(o);
+            insert(cache, key, "getAlbum", params, album());
+            cache.save(request, {"body"});
+            cache.patch({song},
+                        uboat::detail::Change{.id = "s1", .userRating = 4});
+            CHECK(cache.find<int>(key));
+        }
+
+        // the memory tier is gone, and the body of before the write with it
+        ResponseCache cache(o);
+        CHECK_FALSE(cache.load(request, lifetime, &age));
+
+        // a body stored while its response is not in memory is dropped when
+        // it is read after a write changing it
+        cache.save(request, {"body"});
+        cache.invalidate({song});
+        REQUIRE(cache.load(request, lifetime, &age));
+        auto r = album();
+        auto deps = uboat::detail::dependencies("getAlbum", params, r.data);
+        CHECK_FALSE(cache.restore(key, std::make_shared<const decltype(r)>(r),
+                                  100, lifetime, age, deps,
+                                  &uboat::detail::patch<decltype(r.data)>));
+        CHECK_FALSE(cache.find<int>(key));
+        CHECK_FALSE(cache.load(request, lifetime, &age));
+        CHECK_EQ(cache.stats().disk_hits, 0);
+
+        // the responses not holding the entity are still restored
+        uboat::server::SubsonicResponse<uboat::playlist::PlaylistWithSongs> p{};
+        p.status = "ok";
+        p.data.id = "p1";
+        auto playlist = ResponseCache::request_key("getPlaylist", {{"id", "p1"}});
+        cache.save(playlist, {"body"});
+        REQUIRE(cache.load(playlist, lifetime, &age));
+        CHECK(cache.restore(
+            "p1", std::make_shared<const decltype(p)>(p), 100, lifetime, age,
+            uboat::detail::dependencies("getPlaylist", {{"id", "p1"}}, p.data),
+            &uboat::detail::patch<decltype(p.data)>));
+        CHECK(cache.find<int>("p1"));
+        CHECK_EQ(cache.stats().disk_hits, 1);
+    }
+
+    TEST_CASE("writes are forgotten once no body before them is read") {
+        TempDirectory dir;
+        auto o = options(1 << 20);
+        o.directory = dir.path;
+        auto s1 = ResponseCache::dependency(Entity::Song, "s1");
+        auto s2 = ResponseCache::dependency(Entity::Song, "s2");
+
+        {
+            ResponseCache cache(o);
+            cache.invalidate({s1});
+            cache.invalidate({s2});
+            CHECK_EQ(cache.writes(), 2);
+        }
+
+        // every body is too old to be read, a write forgets the earlier ones
+        o.max_disk_age = std::chrono::hours(-1);
+        ResponseCache cache(o);
+        cache.invalidate({s1});
+        cache.invalidate({s2});
+        CHECK_EQ(cache.writes(), 1);
+    }
+}
+
+TEST_SUITE("DiskCache") {
+    constexpr auto WEEK = std::chrono::hours(24 * 7);
+
+    TEST_CASE("bodies survive a restart") {
+        TempDirectory dir;
+        std::string body(10000, 'x');
+        {
+            DiskCache disk(dir.path, 1 << 20, WEEK);
+            CHECK_FALSE(disk.find("a"));
+            disk.store("a", {body});
+            disk.store("b", {"B"});
+            disk.store("b", {"BB"});
+            CHECK_EQ(text(disk.find("a")), body);
+            CHECK_EQ(text(disk.find("b")), "BB");
+            // compressed
+            CHECK_LT(disk.bytes(), body.size());
+        }
+
+        DiskCache disk(dir.path, 1 << 20, WEEK);
+        CHECK_EQ(text(disk.find("a")), body);
+        CHECK_EQ(text(disk.find("b")), "BB");
+        CHECK_FALSE(disk.find("c"));
+
+        disk.clear();
+        CHECK_FALSE(disk.find("a"));
+        CHECK_EQ(disk.bytes(), 0);
+    }
+
+    TEST_CASE("compressed bodies are stored as received") {
+        TempDirectory dir;
+        DiskCache disk(dir.path, 1 << 20, WEEK);
+        disk.store("a", {std::string(1000, 'x')});
+        auto compressed = disk.find("a");
+        REQUIRE(compressed);
+        CHECK_NE(compressed->coding, uboat::detail::ContentCoding::Identity);
+        CHECK_LT(compressed->bytes.size(), 1000);
+
+        disk.store("b", *compressed);
+        auto b = disk.find("b");
+        REQUIRE(b);
+        CHECK_EQ(b->coding, compressed->coding);
+        CHECK_EQ(b->bytes, compressed->bytes);
+        CHECK_EQ(text(b), std::string(1000, 'x'));
+    }
+
+    TEST_CASE("erased bodies stay erased") {
+        TempDirectory dir;
+        {
+            DiskCache disk(dir.path, 1 << 20, WEEK);
+            disk.store("a", {"A"});
+            disk.store("b", {"B"});
+            disk.erase("a");
+            disk.erase("c");
+            CHECK_FALSE(disk.find("a"));
+            CHECK_EQ(text(disk.find("b")), "B");
+        }
+
+        DiskCache disk(dir.path, 1 << 20, WEEK);
+        CHECK_FALSE(disk.find("a"));
+        CHECK_EQ(text(disk.find("b")), "B");
+        disk.store("a", {"AA"});
+        CHECK_EQ(text(disk.find("a")), "AA");
+    }
+
+    TEST_CASE("old bodies are not read") {
+        TempDirectory dir;
+        DiskCache disk(dir.path, 1 << 20, std::chrono::seconds(-1));
+        disk.store("a", {"A"});
+        CHECK_FALSE(disk.find("a"));
+    }
+
+    TEST_CASE("compaction keeps the newest bodies within max_bytes") {
+        TempDirectory dir;
+        constexpr std::size_t MAX_BYTES = 64 << 10;
+        DiskCache disk(dir.path, MAX_BYTES, WEEK);
+
+        // incompressible bodies of about 1 KiB
+        std::mt19937 random(1);
+        auto body = [&] {
+            std::string s(1024, '\0');
+            for (auto &c : s)
+                c = static_cast<char>(random());
+            return s;
+        };
+
+        std::vector<std::string> bodies;
+        for (int i = 0; i < 500; ++i) {
+            bodies.push_back(body());
+            disk.store(std::to_string(i), {bodies.back()});
+            CHECK_LE(disk.bytes(), MAX_BYTES);
+        }
+        CHECK_EQ(text(disk.find("499")), bodies[499]);
+        CHECK_FALSE(disk.find("0"));
+
+        // many keys grow the index
+        for (int i = 0; i < 3000; ++i)
+            disk.store("k" + std::to_string(i), {"v"});
+        CHECK_EQ(text(disk.find("k2999")), "v");
+
+        std::size_t segments = 0;
+        for (auto const &entry : std::filesystem::directory_iterator(dir.path))
+            segments += entry.path().filename().string().starts_with("seg");
+        CHECK_LE(segments, 4);
+    }
+
+    TEST_CASE("a failed compaction refuses new bodies") {
+        TempDirectory dir;
+        DiskCache disk(dir.path, 1 << 20, WEEK);
+        // the segment the compaction writes cannot be opened
+        std::filesystem::create_directory(dir.path / "segment-1");
+
+        for (int i = 0; i < 2000; ++i)
+            disk.store("k" + std::to_string(i), {"v"});
+        CHECK_EQ(text(disk.find("k0")), "v");
+        CHECK_FALSE(disk.find("k1999"));
+        CHECK_FALSE(disk.find("missing"));
+
+        std::filesystem::remove(dir.path / "segment-1");
+        disk.store("k1999", {"v"});
+        CHECK_EQ(text(disk.find("k1999")), "v");
+    }
+
+    TEST_CASE("a damaged index starts an empty cache") {
+        TempDirectory dir;
+        {
+            DiskCache disk(dir.path, 1 << 20, WEEK);
+            disk.store("a", {"A"});
+        }
+        std::ofstream(dir.path / "index", std::ios::trunc) << "garbage";
+
+        DiskCache disk(dir.path, 1 << 20, WEEK);
+        CHECK_FALSE(disk.find("a"));
+        disk.store("a", {"A"});
+        CHECK_EQ(text(disk.find("a")), "A");
+    }
+}
+
+TEST_SUITE("OSClient cache") {
+    TEST_CASE("read endpoints are served from the cache") {
+        uboat::ClientOptions o;
+        o.cache.max_bytes = 1 << 20;
+        auto client = uboat::OSClient(TEST_SERVER, TEST_USERNAME,
+                                      TEST_PASSWORD, TEST_CLIENT_NAME, o);
+        REQUIRE(client.authenticate().has_value());
+
+        auto first = client.getGenres();
+        REQUIRE(first.has_value());
+        auto second = client.getGenres();
+        REQUIRE(second.has_value());
+        CHECK_EQ(second->genre.size(), first->genre.size());
+
+        auto stats = client.cache_stats();
+        CHECK_EQ(stats.misses, 1);
+        CHECK_EQ(stats.hits, 1);
+        CHECK_EQ(stats.entries, 1);
+
+        // not cached by default
+        CHECK(client.getRandomSongs().has_value());
+        CHECK_EQ(client.cache_stats().entries, 1);
+
+        client.clear_cache();
+        CHECK(client.getGenres().has_value());
+        CHECK_EQ(client.cache_stats().misses, 2);
+    }
+
+    TEST_CASE("write requests update the cached responses") {
+        uboat::ClientOptions o;
+        o.cache.max_bytes = 1 << 20;
+        o.cache.ttl["getPlaylist"] = std::chrono::minutes(1);
+        auto client = uboat::OSClient(TEST_SERVER, TEST_USERNAME,
+                                      TEST_PASSWORD, TEST_CLIENT_NAME, o);
+        REQUIRE(client.authenticate().has_value());
+
+        SUBCASE("setRating patches the songs of getAlbum") {
+            auto list = client.getAlbumList2("random");
+            REQUIRE(list.has_value());
+            auto id = list->album.at(0).id;
+            auto album = client.getAlbum(id);
+            REQUIRE(album.has_value());
+            auto song = album->song.at(0).id;
+
+            REQUIRE(client.setRating(song, "4").has_value());
+            CHECK_EQ(client.cache_stats().patches, 1);
+
+            auto cached = client.getAlbum(id);
+            REQUIRE(cached.has_value());
+            CHECK_EQ(client.cache_stats().hits, 1);
+            CHECK_EQ(cached->song.at(0).userRating, 4);
+
+            REQUIRE(client.setRating(song, "0").has_value());
+            CHECK_EQ(client.getAlbum(id)->song.at(0).userRating, 0);
+        }
+
+        SUBCASE("updatePlaylist drops only that playlist") {
+            auto a = client.createPlaylist("", "cache a");
+            auto b = client.createPlaylist("", "cache b");
+            REQUIRE(a.has_value());
+            REQUIRE(b.has_value());
+            REQUIRE(client.getPlaylist(a->id).has_value());
+            REQUIRE(client.getPlaylist(b->id).has_value());
+
+            REQUIRE(client.updatePlaylist(a->id, "cache c").has_value());
+            CHECK_EQ(client.cache_stats().invalidations, 1);
+
+            auto hits = client.cache_stats().hits;
+            auto updated = client.getPlaylist(a->id);
+            REQUIRE(updated.has_value());
+            CHECK_EQ(updated->name, "cache c");
+            CHECK(client.getPlaylist(b->id).has_value());
+            CHECK_EQ(client.cache_stats().hits, hits + 1);
+
+            CHECK(client.deletePlaylist(a->id).has_value());
+            CHECK(client.deletePlaylist(b->id).has_value());
+            CHECK_FALSE(client.getPlaylist(a->id).has_value());
+        }
+    }
+
+    TEST_CASE("a restarted client answers from the cache directory") {
+        TempDirectory dir;
+        uboat::ClientOptions o;
+        o.cache.max_bytes = 1 << 20;
+        o.cache.directory = dir.path;
+
+        std::size_t genres;
+        {
+            auto client = uboat::OSClient(TEST_SERVER, TEST_USERNAME,
+                                          TEST_PASSWORD, TEST_CLIENT_NAME, o);
+            REQUIRE(client.authenticate().has_value());
+            auto result = client.getGenres();
+            REQUIRE(result.has_value());
+            genres = result->genre.size();
+            CHECK_GT(client.cache_stats().disk_bytes, 0);
+        }
+
+        auto client = uboat::OSClient(TEST_SERVER, TEST_USERNAME,
+                                      TEST_PASSWORD, TEST_CLIENT_NAME, o);
+        REQUIRE(client.authenticate().has_value());
+        auto result = client.getGenres();
+        REQUIRE(result.has_value());
+        CHECK_EQ(result->genre.size(), genres);
+        CHECK_EQ(client.cache_stats().disk_hits, 1);
+
+        // then from memory, it is still fresh
+        CHECK(client.getGenres().has_value());
+        CHECK_EQ(client.cache_stats().hits, 1);
+        CHECK_EQ(client.cache_stats().disk_hits, 1);
+
+        // another user does not see the responses
+        auto other = uboat::OSClient(TEST_SERVER, "someone", TEST_PASSWORD,
+                                     TEST_CLIENT_NAME, o);
+        CHECK_FALSE(other.getGenres().has_value());
+        CHECK_EQ(other.cache_stats().disk_hits, 0);
+    }
+
+    TEST_CASE("stale responses are refreshed in the background") {
+        // the refreshes complete when the test drives the loop
+        auto loop = std::make_shared<uboat::EventLoop>(false);
+        uboat::ClientOptions o;
+        o.event_loop = loop;
+        o.cache.max_bytes = 1 << 20;
+        o.cache.stale["getGenres"] = {std::chrono::milliseconds(200),
+                                      std::chrono::minutes(1)};
+        auto client = uboat::OSClient(TEST_SERVER, TEST_USERNAME,
+                                      TEST_PASSWORD, TEST_CLIENT_NAME, o);
+        REQUIRE(client.authenticate().has_value());
+
+        auto first = client.getGenres();
+        REQUIRE(first.has_value());
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+        // answered without waiting, and refreshed once for both requests
+        auto second = client.getGenres();
+        auto third = client.getGenres();
+        REQUIRE(second.has_value());
+        REQUIRE(third.has_value());
+        CHECK_EQ(second->genre.size(), first->genre.size());
+        auto stats = client.cache_stats();
+        CHECK_EQ(stats.misses, 1);
+        CHECK_GE(stats.stale_hits, 1);
+        CHECK_EQ(stats.refreshes, 1);
+
+        // the refreshed response is fresh once it arrives
+        while (loop->in_flight() > 0)
+            loop->poll(std::chrono::milliseconds(100));
+        REQUIRE(client.getGenres().has_value());
+        stats = client.cache_stats();
+        CHECK_EQ(stats.hits - stats.stale_hits, 1);
+        CHECK_EQ(stats.misses, 1);
+    }
+
+    TEST_CASE("disabled by default") {
+        auto client = uboat::OSClient(TEST_SERVER, TEST_USERNAME,
+                                      TEST_PASSWORD, TEST_CLIENT_NAME);
+        REQUIRE(client.authenticate().has_value());
+        CHECK(client.getGenres().has_value());
+        CHECK(client.getGenres().has_value());
+        CHECK_EQ(client.cache_stats().hits, 0);
+        CHECK_EQ(client.cache_stats().entries, 0);
+    }
+}
@@ -0,0 +1,146 @@
+#include "uboat/uboat.h"
+#include <string>
+#include <zlib.h>
+#ifdef UBOAT_USE_ZSTD
+#include <zstd.h>
+#endif
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "common.h"
+#include "content_coding.h"
+#include "json_reader.h"
+
+using uboat::detail::Body;
+using uboat::detail::ContentCoding;
+
+namespace {
+
+// \param window_bits as for deflateInit2()
+std::string compress(const std::string &text, int window_bits) {
+    z_stream stream{};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, 8,
+                 Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, text.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(text.data()));
+    stream.avail_in = static_cast<uInt>(text.size());
+    stream.next_out = reinterpret_cast<Bytef *>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+// a genres response of n genres, larger than a chunk of the decoder
+std::string genres(std::size_t n) {
+    std::string body = R"({"subsonic-response": {"status": "ok", )"
+                       R"("version": "1.16.1", "type": "navidrome", )"
+                       R"("serverVersion": "0.53.3", "openSubsonic": true, )"
+                       R"("genres": {"genre": [)";
+    for (std::size_t i = 0; i < n; ++i) {
+        if (i)
+            body += ", ";
+        body += R"({"value": "Genre )" + std::to_string(i) +
+                R"(", "songCount": 1, "albumCount": 1})";
+    }
+    return body + "]}}}";
+}
+
+} // namespace
+
+TEST_SUITE("ContentCoding") {
+    TEST_CASE("codings") {
+        CHECK_EQ(uboat::detail::content_coding(""), ContentCoding::Identity);
+        CHECK_EQ(uboat::detail::content_coding("gzip"), ContentCoding::Gzip);
+        CHECK_EQ(uboat::detail::content_coding("deflate"),
+                 ContentCoding::Deflate);
+        CHECK_FALSE(uboat::detail::content_coding("compress").has_value());
+        CHECK(std::string(uboat::detail::accept_encoding()).contains("gzip"));
+    }
+
+    TEST_CASE("decoded while read") {
+        auto text = genres(5000);
+        REQUIRE_GT(text.size(), 64 * 1024);
+
+        for (auto [coding, window_bits] :
+             {std::pair{ContentCoding::Gzip, 16 + MAX_WBITS},
+              std::pair{ContentCoding::Deflate, MAX_WBITS},
+              std::pair{ContentCoding::Deflate, -MAX_WBITS}}) {
+            CAPTURE(window_bits);
+            Body body{compress(text, window_bits), coding};
+            CHECK_LT(body.bytes.size(), text.size() / 4);
+            CHECK_EQ(uboat::detail::decode(body).value(), text);
+
+            std::size_t decoded = 0;
+            auto response = uboat::detail::read_response<uboat::misc::Genres>(
+                body, "genres", {}, &decoded);
+            REQUIRE(response.has_value());
+            CHECK_EQ(response->data.genre.size(), 5000);
+            CHECK_EQ(response->data.genre.back().value, "Genre 4999");
+            CHECK_EQ(decoded, text.size());
+        }
+    }
+
+    TEST_CASE("bodies cut short or corrupt fail") {
+        auto text = genres(100);
+        auto gzip = compress(text, 16 + MAX_WBITS);
+
+        Body cut{gzip.substr(0, gzip.size() - 8), ContentCoding::Gzip};
+        CHECK_FALSE(uboat::detail::decode(cut).has_value());
+        CHECK_FALSE(uboat::detail::read_response<uboat::misc::Genres>(
+                        cut, "genres")
+                        .has_value());
+
+        Body plain{text, ContentCoding::Gzip};
+        CHECK_FALSE(uboat::detail::decode(plain).has_value());
+    }
+
+#ifdef UBOAT_USE_ZSTD
+    TEST_CASE("zstd") {
+        auto text = genres(5000);
+        std::string zstd(ZSTD_compressBound(text.size()), '\0');
+        zstd.resize(ZSTD_compress(zstd.data(), zstd.size(), text.data(),
+                                  text.size(), 3));
+        Body body{zstd, ContentCoding::Zstd};
+        CHECK_EQ(uboat::detail::decode(body).value(), text);
+
+        body.bytes.resize(body.bytes.size() - 4);
+        CHECK_FALSE(uboat::detail::decode(body).has_value());
+    }
+#endif
+}
+
+TEST_SUITE("Compressed responses") {
+    auto client = uboat::OSClient(TEST_SERVER, TEST_USERNAME, TEST_PASSWORD,
+                                  TEST_CLIENT_NAME);
+    auto plain = uboat::OSClient(TEST_SERVER, TEST_USERNAME, TEST_PASSWORD,
+                                 TEST_CLIENT_NAME, {.compression = false});
+
+    TEST_CASE("auth successful") {
+        REQUIRE(client.authenticate().has_value());
+        REQUIRE(plain.authenticate().has_value());
+    }
+
+    TEST_CASE("counted as received and decoded") {
+        auto album = client.getAlbum("al1");
+        REQUIRE(album.has_value());
+        CHECK_EQ(album->song.size(), 4);
+        auto async = client.getAlbumAsync("al2").get();
+        REQUIRE(async.has_value());
+        CHECK_EQ(async->song.size(), 4);
+
+        auto stats = client.request_stats();
+        auto getAlbum = stats.endpoints.at("getAlbum");
+        CHECK_EQ(getAlbum.responses, 2);
+        CHECK_LT(getAlbum.wire_bytes, getAlbum.decoded_bytes);
+        CHECK_GE(stats.total.responses, 2);
+        CHECK_GE(stats.total.decoded_bytes, getAlbum.decoded_bytes);
+
+        REQUIRE(plain.getAlbum("al1").has_value());
+        REQUIRE(plain.getAlbumAsync("al2").get().has_value());
+        auto uncompressed = plain.request_stats().endpoints.at("getAlbum");
+        CHECK_EQ(uncompressed.wire_bytes, uncompressed.decoded_bytes);
+        CHECK_EQ(uncompressed.decoded_bytes, getAlbum.decoded_bytes);
+    }
+}
@@ -0,0 +1,329 @@
+#include "uboat/crawler.h"
+#include "uboat/library_sync.h"
+#include "uboat/uboat.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "common.h"
+#include "concurrency_limit.h"
+#include "model_fields.h"
+#include "work_stealing_pool.h"
+
+using uboat::detail::ConcurrencyLimit;
+using uboat::detail::WorkStealingPool;
+
+TEST_SUITE("WorkStealingPool") {
+    TEST_CASE("runs every task") {
+        std::atomic<int> done = 0;
+        WorkStealingPool pool(4);
+        for (int i = 0; i < 1000; ++i)
+            pool.submit([&] { ++done; });
+        pool.wait();
+        CHECK_EQ(done, 1000);
+
+        // tasks queued by tasks
+        for (int i = 0; i < 10; ++i)
+            pool.submit([&] {
+                for (int j = 0; j < 10; ++j)
+                    pool.submit([&] { ++done; });
+            });
+        pool.wait();
+        CHECK_EQ(done, 1100);
+    }
+
+    TEST_CASE("idle threads take the tasks of a busy one") {
+        WorkStealingPool pool(4);
+        std::atomic<int> done = 0;
+        // one task queues the others on its own thread, then blocks it
+        pool.submit([&] {
+            for (int i = 0; i < 100; ++i)
+                pool.submit([&] { ++done; });
+            while (done < 100)
+                std::this_thread::yield();
+        });
+        pool.wait();
+        CHECK_EQ(done, 100);
+        CHECK_GT(pool.steals(), 0);
+    }
+
+    TEST_CASE("waits for the tasks queued by running tasks") {
+        WorkStealingPool pool(4);
+        std::atomic<int> done = 0;
+        for (int i = 1; i <= 1000; ++i) {
+            pool.submit([&] { pool.submit([&] { ++done; }); });
+            pool.wait();
+            REQUIRE_EQ(done, i);
+        }
+    }
+}
+
+TEST_SUITE("ConcurrencyLimit") {
+    using namespace std::chrono_literals;
+
+    TEST_CASE("grows while requests are fast, halves when they are slow") {
+        ConcurrencyLimit limit(1, 16, 1h);
+        CHECK_EQ(limit.limit(), 4);
+        for (int i = 0; i < 200; ++i)
+            limit.release(limit.acquire());
+        CHECK_EQ(limit.limit(), 16);
+
+        ConcurrencyLimit slow(2, 16, 0ns);
+        CHECK_EQ(slow.limit(), 4);
+        auto a = slow.acquire();
+        auto b = slow.acquire();
+        slow.release(a);
+        CHECK_EQ(slow.limit(), 2);
+        // b was sent before the decrease
+        slow.release(b);
+        CHECK_EQ(slow.limit(), 2);
+        // never below the minimum
+        slow.release(slow.acquire());
+        CHECK_EQ(slow.limit(), 2);
+    }
+
+    TEST_CASE("blocks above the limit") {
+        ConcurrencyLimit limit(1, 1, 1h);
+        auto first = limit.acquire();
+        std::atomic<bool> second = false;
+        std::thread t([&] {
+            limit.release(limit.acquire());
+            second = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        CHECK_FALSE(second);
+        limit.release(first);
+        t.join();
+        CHECK(second);
+    }
+}
+
+TEST_SUITE("Crawler") {
+    auto client = uboat::OSClient(TEST_SERVER, TEST_USERNAME, TEST_PASSWORD,
+                                  TEST_CLIENT_NAME);
+    auto checkpoint = std::filesystem::temp_directory_path() /
+                      ("uboat_test_crawler_" + std::to_string(::getpid()));
+
+    TEST_CASE("auth successful") {
+        REQUIRE(client.authenticate().has_value());
+    }
+
+    TEST_CASE("albums written back read the same") {
+        auto album = client.getAlbum("al1");
+        REQUIRE(album.has_value());
+        uboat::album::AlbumID3WithSongs copy{};
+        uboat::detail::read_document(
+            uboat::detail::write_document(album.value()), copy);
+        CHECK_EQ(copy.id, album.value().id);
+        CHECK_EQ(copy.name, album.value().name);
+        CHECK_EQ(copy.genres.size(), album.value().genres.size());
+        REQUIRE_EQ(copy.song.size(), album.value().song.size());
+        CHECK_EQ(copy.song.back().path, album.value().song.back().path);
+        CHECK_EQ(copy.song.back().artists.size(),
+                 album.value().song.back().artists.size());
+    }
+
+    TEST_CASE("snapshot of the library") {
+        std::vector<uboat::CrawlProgress> reports;
+        uboat::Crawler crawler(
+            client, {.page_size = 2, .on_progress = [&](auto &p) {
+                         reports.push_back(p);
+                     }});
+        auto snapshot = crawler.run();
+        REQUIRE(snapshot.has_value());
+        CHECK(snapshot->complete);
+        CHECK_EQ(snapshot->artists.size(), 2);
+        REQUIRE_EQ(snapshot->albums.size(), 3);
+        CHECK(snapshot->missing.empty());
+        CHECK_GT(snapshot->lastModified, 0);
+
+        auto list = client.getAlbumList2("alphabeticalByName");
+        REQUIRE(list.has_value());
+        for (std::size_t i = 0; i < 3; ++i) {
+            CHECK_EQ(snapshot->albums[i].id, list.value().album.at(i).id);
+            CHECK_EQ(snapshot->albums[i].song.size(), 4);
+        }
+
+        REQUIRE_EQ(reports.size(), 3);
+        CHECK_EQ(reports.back().listed, 3);
+        CHECK_EQ(reports.back().fetched, 3);
+        CHECK_EQ(reports.back().failed, 0);
+        CHECK_GE(reports.back().concurrency, 1);
+    }
+
+    TEST_CASE("a stopped crawl resumes from its checkpoint") {
+        std::filesystem::remove(checkpoint);
+        {
+            uboat::Crawler *self = nullptr;
+            uboat::Crawler crawler(
+                client, {.max_concurrency = 1,
+                         .page_size = 1,
+                         .checkpoint = checkpoint,
+                         .on_progress = [&](auto &) { self->stop(); }});
+            self = &crawler;
+            auto snapshot = crawler.run();
+            REQUIRE(snapshot.has_value());
+            CHECK_FALSE(snapshot->complete);
+            CHECK_LT(snapshot->albums.size(), 3);
+            CHECK_GE(snapshot->albums.size(), 1);
+            CHECK(std::filesystem::exists(checkpoint));
+        }
+
+        // an interruption while writing leaves a partial line
+        std::ofstream(checkpoint, std::ios::app) << "{\"id\": \"al";
+
+        uboat::Crawler crawler(client, {.checkpoint = checkpoint});
+        auto snapshot = crawler.run();
+        REQUIRE(snapshot.has_value());
+        CHECK(snapshot->complete);
+        CHECK_EQ(snapshot->albums.size(), 3);
+        for (auto &album : snapshot->albums)
+            CHECK_EQ(album.song.size(), 4);
+        auto progress = crawler.progress();
+        CHECK_GE(progress.resumed, 1);
+        CHECK_EQ(progress.resumed + progress.fetched, 3);
+        CHECK_FALSE(std::filesystem::exists(checkpoint));
+    }
+
+    TEST_CASE("crawls are not answered from the cache") {
+        uboat::ClientOptions o;
+        o.cache.max_bytes = 1 << 20;
+        auto cached = uboat::OSClient(TEST_SERVER, TEST_USERNAME,
+                                      TEST_PASSWORD, TEST_CLIENT_NAME, o);
+        REQUIRE(cached.authenticate().has_value());
+
+        // the cache has a copy of everything the crawl reads
+        for (auto const &album : client.getAlbumList2("alphabeticalByName")
+                                     .value_or(uboat::album::AlbumList2{})
+                                     .album)
+            REQUIRE(cached.getAlbum(album.id).has_value());
+        REQUIRE(cached.getArtists().has_value());
+        auto before = cached.cache_stats();
+
+        auto snapshot = uboat::Crawler(cached).run();
+        REQUIRE(snapshot.has_value());
+        REQUIRE_EQ(snapshot->albums.size(), 3);
+
+        auto after = cached.cache_stats();
+        CHECK_EQ(after.hits, before.hits);
+        CHECK_EQ(after.stale_hits, before.stale_hits);
+        CHECK_EQ(after.disk_hits, before.disk_hits);
+    }
+}
+
+TEST_SUITE("LibrarySync") {
+    auto client = uboat::OSClient(TEST_SERVER, TEST_USERNAME, TEST_PASSWORD,
+                                  TEST_CLIENT_NAME);
+
+    TEST_CASE("auth successful") {
+        REQUIRE(client.authenticate().has_value());
+    }
+
+    TEST_CASE("an unchanged library gives an empty diff") {
+        auto snapshot = uboat::Crawler(client).run();
+        REQUIRE(snapshot.has_value());
+        auto before = snapshot->albums.size();
+        auto diff = uboat::LibrarySync(client).sync(*snapshot);
+        REQUIRE(diff.has_value());
+        CHECK(diff->empty());
+        CHECK_EQ(snapshot->albums.size(), before);
+    }
+
+    TEST_CASE("only the changed albums are fetched") {
+        auto snapshot = uboat::Crawler(client).run();
+        REQUIRE(snapshot.has_value());
+        REQUIRE_EQ(snapshot->albums.size(), 3);
+        auto lastModified = snapshot->lastModified;
+
+        // the snapshot was taken before the library changed
+        snapshot->lastModified = lastModified - 1;
+        auto added = snapshot->albums[0].id;
+        snapshot->albums.erase(snapshot->albums.begin());
+        auto updated = snapshot->albums[0].id;
+        snapshot->albums[0].songCount = 1;
+        snapshot->albums[0].song.resize(1);
+        auto removed = snapshot->albums[1];
+        removed.id = "gone";
+        snapshot->albums.push_back(removed);
+
+        uboat::LibrarySync sync(client, {.page_size = 2});
+        auto diff = sync.sync(*snapshot);
+        REQUIRE(diff.has_value());
+        CHECK_EQ(diff->added, std::vector{added});
+        CHECK_EQ(diff->updated, std::vector{updated});
+        CHECK_EQ(diff->removed, std::vector<std::string>{"gone"});
+
+        REQUIRE_EQ(snapshot->albums.size(), 3);
+        for (auto &album : snapshot->albums)
+            CHECK_EQ(album.song.size(), 4);
+        CHECK_EQ(snapshot->albums.back().id, added);
+        CHECK_EQ(snapshot->artists.size(), 2);
+        CHECK(snapshot->complete);
+        CHECK_EQ(snapshot->lastModified, lastModified);
+
+        // nothing changed since
+        diff = sync.sync(*snapshot);
+        REQUIRE(diff.has_value());
+        CHECK(diff->empty());
+    }
+
+    TEST_CASE("an updated album is not read from the cache") {
+        uboat::ClientOptions o;
+        o.cache.max_bytes = 1 << 20;
+        auto cached = uboat::OSClient(TEST_SERVER, TEST_USERNAME,
+                                      TEST_PASSWORD, TEST_CLIENT_NAME, o);
+        REQUIRE(cached.authenticate().has_value());
+
+        auto snapshot = uboat::Crawler(cached).run();
+        REQUIRE(snapshot.has_value());
+        REQUIRE_EQ(snapshot->albums.size(), 3);
+
+        // the album changed since the snapshot, the cache has a copy of it
+        snapshot->lastModified -= 1;
+        auto updated = snapshot->albums[0].id;
+        snapshot->albums[0].songCount = 1;
+        snapshot->albums[0].song.resize(1);
+        REQUIRE(cached.getAlbum(updated).has_value());
+        REQUIRE(cached.getArtists().has_value());
+        auto before = cached.cache_stats();
+
+        auto diff = uboat::LibrarySync(cached).sync(*snapshot);
+        REQUIRE(diff.has_value());
+        CHECK_EQ(diff->updated, std::vector{updated});
+        CHECK_EQ(snapshot->albums[0].id, updated);
+        CHECK_EQ(snapshot->albums[0].song.size(), 4);
+
+        auto after = cached.cache_stats();
+        CHECK_EQ(after.hits, before.hits);
+        CHECK_EQ(after.stale_hits, before.stale_hits);
+        CHECK_EQ(after.disk_hits, before.disk_hits);
+    }
+
+    TEST_CASE("a sync finishes a stopped crawl") {
+        uboat::Crawler *self = nullptr;
+        uboat::Crawler crawler(client,
+                               {.max_concurrency = 1,
+                                .page_size = 1,
+                                .on_progress = [&](auto &) { self->stop(); }});
+        self = &crawler;
+        auto snapshot = crawler.run();
+        REQUIRE(snapshot.has_value());
+        REQUIRE_LT(snapshot->albums.size(), 3);
+        CHECK_FALSE(snapshot->complete);
+        CHECK_EQ(snapshot->lastModified, 0);
+
+        auto diff = uboat::LibrarySync(client).sync(*snapshot);
+        REQUIRE(diff.has_value());
+        CHECK_FALSE(diff->added.empty());
+        CHECK(snapshot->complete);
+        CHECK_EQ(snapshot->albums.size(), 3);
+        CHECK_GT(snapshot->lastModified, 0);
+    }
+}
@@ -0,0 +1,142 @@
+#include "uboat/uboat.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "common.h"
+#include "credentials.h"
+
+using uboat::detail::Credentials;
+
+namespace {
+
+// the value of name in an encoded query
+std::string param(const std::string &query, const std::string &name) {
+    auto begin = ("&" + query).find("&" + name + "=");
+    if (begin == std::string::npos)
+        return {};
+    begin += name.size() + 1;
+    return query.substr(begin, query.find('&', begin) - begin);
+}
+
+} // namespace
+
+TEST_SUITE("Credentials") {
+    TEST_CASE("token of the password and the salt") {
+        // the example of the Subsonic API documentation
+        CHECK_EQ(uboat::detail::md5_token("sesame", "c19b2d"),
+                 "26719a1196d2a940705a59634eb18eab");
+    }
+
+    TEST_CASE("no salt nor token before the first rotation") {
+        Credentials credentials("karl", "donitz", "", "c", std::nullopt);
+        auto query = *credentials.query();
+        CHECK_EQ(param(query, "u"), "karl");
+        CHECK(param(query, "s").empty());
+        CHECK(param(query, "t").empty());
+    }
+
+    TEST_CASE("each rotation replaces the salt") {
+        Credentials credentials("karl", "donitz", "", "c", std::nullopt);
+        credentials.rotate();
+        auto first = *credentials.query();
+        CHECK_EQ(*credentials.query(), first);
+
+        credentials.rotate();
+        auto second = *credentials.query();
+        CHECK_NE(param(second, "s"), param(first, "s"));
+        CHECK_EQ(param(second, "s").size(), param(first, "s").size());
+        CHECK_EQ(param(second, "t"),
+                 uboat::detail::md5_token("donitz", param(second, "s")));
+    }
+
+    TEST_CASE("tokens are rotated once their lifetime is over") {
+        Credentials credentials("karl", "donitz", "", "c",
+                                std::chrono::milliseconds(50));
+        credentials.rotate();
+        auto first = *credentials.query();
+        CHECK_EQ(*credentials.query(), first);
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        CHECK_NE(*credentials.query(), first);
+    }
+
+    TEST_CASE("a token per request") {
+        Credentials credentials("karl", "donitz", "", "c",
+                                std::chrono::seconds(0));
+        credentials.rotate();
+        CHECK_NE(*credentials.query(), *credentials.query());
+    }
+
+    TEST_CASE("an API key replaces the username and the password") {
+        Credentials credentials("karl", "donitz", "k e y", "c",
+                                std::chrono::seconds(0));
+        auto query = *credentials.query();
+        CHECK_EQ(param(query, "apiKey"), "k%20e%20y");
+        CHECK(param(query, "u").empty());
+        credentials.rotate();
+        CHECK_EQ(*credentials.query(), query);
+    }
+
+    TEST_CASE("the identity tells apart the API keys") {
+        Credentials a("", "", "key a", "c", std::nullopt);
+        Credentials b("", "", "key b", "c", std::nullopt);
+        CHECK_NE(a.identity(), b.identity());
+        CHECK_EQ(a.identity(),
+                 Credentials("", "", "key a", "c", std::nullopt).identity());
+        CHECK_EQ(a.identity().find("key a"), std::string::npos);
+
+        CHECK_NE(Credentials("karl", "", "", "c", std::nullopt).identity(),
+                 Credentials("erich", "", "", "c", std::nullopt).identity());
+    }
+}
+
+TEST_SUITE("Authentication") {
+    TEST_CASE("authenticate again") {
+        auto client = uboat::OSClient(TEST_SERVER, TEST_USERNAME,
+                                      TEST_PASSWORD, TEST_CLIENT_NAME);
+        REQUIRE(client.authenticate().has_value());
+        REQUIRE(client.authenticate().has_value());
+        CHECK(client.getLicense().has_value());
+    }
+
+    TEST_CASE("rotated tokens need no new authenticate()") {
+        auto client = uboat::OSClient(
+            TEST_SERVER, TEST_USERNAME, TEST_PASSWORD, TEST_CLIENT_NAME,
+            {.token_lifetime = std::chrono::seconds(0)});
+        REQUIRE(client.authenticate().has_value());
+
+        // every request has its own salt, read while others rotate it
+        std::vector<std::jthread> threads;
+        std::atomic<int> failures = 0;
+        for (int t = 0; t < 8; ++t)
+            threads.emplace_back([&] {
+                for (int i = 0; i < 10; ++i)
+                    if (!client.getLicense().has_value())
+                        ++failures;
+            });
+        threads.clear();
+        CHECK_EQ(failures.load(), 0);
+        CHECK(client.getLicenseAsync().get().has_value());
+    }
+
+    TEST_CASE("API key") {
+        auto client = uboat::OSClient(TEST_SERVER, "", "", TEST_CLIENT_NAME,
+                                      {.api_key = TEST_API_KEY});
+        // no authenticate() needed
+        CHECK(client.getLicense().has_value());
+        REQUIRE(client.authenticate().has_value());
+        CHECK(client.getLicense().has_value());
+    }
+
+    TEST_CASE("wrong API key") {
+        auto client = uboat::OSClient(TEST_SERVER, "", "", TEST_CLIENT_NAME,
+                                      {.api_key = "wrong"});
+        auto result = client.authenticate();
+        REQUIRE_FALSE(result.has_value());
+        CHECK_EQ(result.error().code, 44);
+    }
+}
@@ -0,0 +1,277 @@
+#include "uboat/uboat.h"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "json_reader.h"
+#include "string_arena.h"
+#include <memory_resource>
+
+using uboat::detail::read_response;
+
+TEST_SUITE("JSON reader") {
+    static const std::string ENVELOPE =
+        R"("status": "ok", "version": "1.16.1", "type": "navidrome",
+           "serverVersion": "0.53.0", "openSubsonic": true)";
+
+    TEST_CASE("search result") {
+        std::string body = R"({"subsonic-response": {)" + ENVELOPE + R"(,
+            "searchResult3": {
+                "artist": [{"id": "ar1", "name": "George Harrison",
+                            "albumCount": 2, "roles": ["artist"]}],
+                "album": [{"id": "al1", "name": "Brainwashed",
+                           "songCount": 12, "duration": 2940,
+                           "created": "2002-11-18T00:00:00Z",
+                           "releaseDate": {"year": 2002, "month": 11},
+                           "genres": [{"name": "Rock"}]}],
+                "song": [{"id": "s1", "isDir": false, "title": "Any Road",
+                          "track": 1, "size": 9453125, "bitRate": 320,
+                          "replayGain": {"trackGain": -6.5},
+                          "contributors": [{"role": "producer",
+                                            "artist": {"id": "x"}}],
+                          "artists": [{"id": "ar1",
+                                       "name": "George Harrison"}]}]
+            }}})";
+
+        auto result =
+            read_response<uboat::search::SearchResult3>(body, "searchResult3");
+        REQUIRE(result.has_value());
+        CHECK_EQ(result->status, "ok");
+        CHECK(result->openSubsonic);
+
+        auto &data = result->data;
+        REQUIRE_EQ(data.artist.size(), 1);
+        CHECK_EQ(data.artist[0].name, "George Harrison");
+        CHECK_EQ(data.artist[0].albumCount, 2);
+        CHECK_EQ(data.artist[0].roles, std::vector<std::string>{"artist"});
+
+        REQUIRE_EQ(data.album.size(), 1);
+        CHECK_EQ(data.album[0].releaseDate.year, 2002);
+        CHECK_EQ(data.album[0].releaseDate.month, 11);
+        CHECK_EQ(data.album[0].genres[0].name, "Rock");
+
+        REQUIRE_EQ(data.song.size(), 1);
+        CHECK_EQ(data.song[0].title, "Any Road");
+        CHECK_EQ(data.song[0].size, 9453125);
+        CHECK_EQ(data.song[0].artists[0].id, "ar1");
+        CHECK_EQ(data.song[0].userRating, 0);
+    }
+
+    TEST_CASE("views") {
+        std::string body = R"({"subsonic-response": {)" + ENVELOPE + R"(,
+            "searchResult3": {
+                "album": [{"id": "al1", "name": "Brainwashed",
+                           "songCount": 12, "duration": 2940,
+                           "created": "2002-11-18T00:00:00Z",
+                           "releaseTypes": ["Album"],
+                           "discTitles": [{"disc": 1, "title": "One"}]}],
+                "song": [{"id": "s1", "isDir": false,
+                          "title": "Marwa Blues \u00e9",
+                          "path": "a\/b.flac",
+                          "artists": [{"id": "ar1", "name": "G"}]}]
+            }}})";
+
+        uboat::detail::StringArena strings;
+        auto result = read_response<uboat::search::SearchResult3View>(
+            body, "searchResult3", uboat::detail::ReadContext{&strings});
+        REQUIRE(result.has_value());
+
+        auto &data = result->data;
+        REQUIRE_EQ(data.song.size(), 1);
+        CHECK_EQ(data.song[0].title, "Marwa Blues \u00e9");
+        CHECK_EQ(data.song[0].path, "a/b.flac");
+        CHECK_EQ(data.song[0].artists[0].name, "G");
+        CHECK_EQ(data.album[0].discTitles[0].title, "One");
+        CHECK_GT(strings.capacity(), 0);
+
+        auto owned = to_owned(data);
+        auto expected = read_response<uboat::search::SearchResult3>(
+            body, "searchResult3");
+        REQUIRE(expected.has_value());
+        CHECK_EQ(owned.song[0].title, expected->data.song[0].title);
+        CHECK_EQ(owned.song[0].path, expected->data.song[0].path);
+        CHECK_EQ(owned.song[0].artists[0].id, "ar1");
+        CHECK_EQ(owned.album[0].releaseTypes,
+                 std::vector<std::string>{"Album"});
+        CHECK_EQ(owned.album[0].discTitles[0].disc, 1);
+    }
+
+    TEST_CASE("pmr models") {
+        std::string body = R"({"subsonic-response": {)" + ENVELOPE + R"(,
+            "playlist": {
+                "id": "pl1", "name": "A rather long playlist name",
+                "songCount": 2, "duration": 490, "public": true,
+                "created": "2024-01-18T20:17:42.471Z",
+                "changed": "2024-01-18T20:17:42.471Z",
+                "allowedUser": ["someone with a long user name"],
+                "entry": [{"id": "s1", "isDir": false,
+                           "title": "Any Road, with a long title",
+                           "genres": [{"name": "Rock and more rock"}]},
+                          {"id": "s2", "isDir": false, "title": "P2"}]
+            }}})";
+
+        std::pmr::monotonic_buffer_resource arena;
+        auto result = read_response<uboat::pmr::PlaylistWithSongs>(
+            body, "playlist", uboat::detail::ReadContext{.resource = &arena});
+        REQUIRE(result.has_value());
+
+        auto &data = result->data;
+        CHECK_EQ(data.name, "A rather long playlist name");
+        CHECK(data.isPublic);
+        CHECK_EQ(data.name.get_allocator().resource(), &arena);
+        CHECK_EQ(data.allowedUser.get_allocator().resource(), &arena);
+        CHECK_EQ(data.allowedUser.at(0).get_allocator().resource(), &arena);
+        REQUIRE_EQ(data.entry.size(), 2);
+        CHECK_EQ(data.entry.get_allocator().resource(), &arena);
+        CHECK_EQ(data.entry[0].title, "Any Road, with a long title");
+        CHECK_EQ(data.entry[0].title.get_allocator().resource(), &arena);
+        CHECK_EQ(data.entry[0].genres.at(0).name.get_allocator().resource(),
+                 &arena);
+        CHECK_EQ(data.entry[1].title, "P2");
+        // and so are the members left empty
+        CHECK(data.comment.empty());
+        CHECK_EQ(data.comment.get_allocator().resource(), &arena);
+        CHECK(data.entry[1].genres.empty());
+        CHECK_EQ(data.entry[1].genres.get_allocator().resource(), &arena);
+        CHECK_EQ(data.entry[1].artist.get_allocator().resource(), &arena);
+    }
+
+    TEST_CASE("pmr models of the other lists") {
+        std::string body = R"({"subsonic-response": {)" + ENVELOPE + R"(,
+            "nowPlaying": {"entry": [
+                {"id": "s1", "isDir": false, "title": "Any Road",
+                 "username": "someone with a long user name",
+                 "minutesAgo": 1, "playerId": 2,
+                 "playerName": "a player with a long name"}]}}})";
+
+        std::pmr::monotonic_buffer_resource arena;
+        auto result = read_response<uboat::pmr::NowPlaying>(
+            body, "nowPlaying", uboat::detail::ReadContext{.resource = &arena});
+        REQUIRE(result.has_value());
+        REQUIRE_EQ(result->data.entry.size(), 1);
+        auto &entry = result->data.entry[0];
+        CHECK_EQ(entry.title, "Any Road");
+        CHECK_EQ(entry.username, "someone with a long user name");
+        CHECK_EQ(entry.minutesAgo, 1);
+        CHECK_EQ(entry.username.get_allocator().resource(), &arena);
+        CHECK_EQ(entry.title.get_allocator().resource(), &arena);
+        CHECK_EQ(entry.genres.get_allocator().resource(), &arena);
+
+        body = R"({"subsonic-response": {)" + ENVELOPE + R"(,
+            "artists": {"ignoredArticles": "The El La",
+                        "index": [{"name": "A", "artist": [
+                            {"id": "ar1", "name": "An artist of a long name",
+                             "albumCount": 3}]}]}}})";
+        auto artists = read_response<uboat::pmr::Artists>(
+            body, "artists", uboat::detail::ReadContext{.resource = &arena});
+        REQUIRE(artists.has_value());
+        REQUIRE_EQ(artists->data.index.size(), 1);
+        auto &artist = artists->data.index[0].artist.at(0);
+        CHECK_EQ(artist.name, "An artist of a long name");
+        CHECK_EQ(artist.albumCount, 3);
+        CHECK_EQ(artist.name.get_allocator().resource(), &arena);
+        CHECK_EQ(artists->data.index.get_allocator().resource(), &arena);
+    }
+
+    TEST_CASE("error response") {
+        std::string body = R"({"subsonic-response": {)" + ENVELOPE + R"(,
+            "status": "failed",
+            "error": {"code": 70, "message": "not found"}}})";
+
+        SUBCASE("data of another key") {
+            auto result = read_response<uboat::album::AlbumID3WithSongs>(
+                body, "album");
+            REQUIRE(result.has_value());
+            CHECK_EQ(result->status, "failed");
+            CHECK_EQ(result->error.code, 70);
+        }
+
+        SUBCASE("error as data") {
+            auto result = read_response<uboat::server::Error>(body, "error");
+            REQUIRE(result.has_value());
+            CHECK_EQ(result->data.code, 70);
+            CHECK_EQ(result->error.message, "not found");
+        }
+    }
+
+    TEST_CASE("invalid responses") {
+        SUBCASE("missing data") {
+            std::string body = R"({"subsonic-response": {)" + ENVELOPE +
+                               R"(, "status": "failed"}})";
+            auto result = read_response<uboat::misc::Genres>(body, "genres");
+            REQUIRE_FALSE(result.has_value());
+            CHECK_EQ(result.error().message, "unknown key");
+        }
+
+        SUBCASE("missing required key") {
+            std::string body = R"({"subsonic-response": {)" + ENVELOPE +
+                               R"(, "genres": {"genre": [{"value": "Rock",
+                               "songCount": 1}]}}})";
+            auto result = read_response<uboat::misc::Genres>(body, "genres");
+            REQUIRE_FALSE(result.has_value());
+            CHECK_EQ(result.error().code, 500);
+            CHECK_EQ(result.error().message, "missing key \"albumCount\"");
+        }
+
+        SUBCASE("wrong type") {
+            std::string body = R"({"subsonic-response": {)" + ENVELOPE +
+                               R"(, "genres": {"genre": [{"value": 1,
+                               "songCount": 1, "albumCount": 1}]}}})";
+            auto result = read_response<uboat::misc::Genres>(body, "genres");
+            REQUIRE_FALSE(result.has_value());
+            CHECK_EQ(result.error().message,
+                     "unexpected number for key \"value\"");
+        }
+
+        SUBCASE("truncated") {
+            std::string body = R"({"subsonic-response": {)" + ENVELOPE;
+            auto result = read_response<uboat::misc::Genres>(body, "genres");
+            CHECK_FALSE(result.has_value());
+        }
+    }
+}
+
+TEST_SUITE("from_json") {
+    TEST_CASE("field lookup") {
+        auto &type = uboat::detail::Type<uboat::media::NowPlayingEntry>::info;
+        for (std::size_t i = 0; i < type.field_count; ++i)
+            CHECK_EQ(type.find(type.fields[i].name), i);
+        CHECK_EQ(type.find("contributors"), type.field_count);
+        CHECK_EQ(type.find(""), type.field_count);
+    }
+
+    TEST_CASE("child") {
+        auto j = nlohmann::json::parse(
+            R"({"id": "s1", "isDir": false, "title": "Any Road",
+                "track": 1, "year": null, "replayGain": {"trackPeak": 1},
+                "genres": [{"name": "Rock"}, null], "moods": ["calm"]})");
+        auto child = j.get<uboat::media::Child>();
+        CHECK_EQ(child.id, "s1");
+        CHECK_EQ(child.track, 1);
+        CHECK_EQ(child.year, 0);
+        CHECK_EQ(child.replayGain.trackPeak, 1);
+        REQUIRE_EQ(child.genres.size(), 1);
+        CHECK_EQ(child.genres[0].name, "Rock");
+    }
+
+    TEST_CASE("errors") {
+        SUBCASE("missing required key") {
+            auto j = nlohmann::json::parse(R"({"id": "s1", "isDir": false})");
+            CHECK_THROWS_AS(j.get<uboat::media::Child>(),
+                            nlohmann::json::out_of_range);
+        }
+
+        SUBCASE("required key is null") {
+            auto j = nlohmann::json::parse(
+                R"({"id": null, "isDir": false, "title": ""})");
+            CHECK_THROWS_AS(j.get<uboat::media::Child>(),
+                            nlohmann::json::type_error);
+        }
+
+        SUBCASE("wrong type") {
+            auto j = nlohmann::json::parse(
+                R"({"id": "s1", "isDir": false, "title": "", "track": "1"})");
+            CHECK_THROWS_AS(j.get<uboat::media::Child>(),
+                            nlohmann::json::type_error);
+        }
+    }
+}
@@ -1,4 +1,8 @@
 #include "uboat/uboat.h"
+#include "uboat/album_pages.h"
+#include <memory_resource>
+#include <string>
+#include <vector>
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 
@@ -38,6 +42,51 @@ TEST_SUITE("Album/Song Lists") {
             auto result = client.getAlbumList2("byGenre", "", "", "", "", " ");
             CHECK(result.has_value());
         }
+        SUBCASE("get a page") {
+            auto all = client.getAlbumList2("alphabeticalByName");
+            auto page = client.getAlbumList2("alphabeticalByName", "1", "2");
+            REQUIRE(all.has_value());
+            REQUIRE(page.has_value());
+            REQUIRE_EQ(page.value().album.size(), 1);
+            CHECK_EQ(page.value().album.at(0).id, all.value().album.at(2).id);
+        }
+    }
+
+    TEST_CASE("AlbumPages") {
+        // the whole list, not only the default size of a request
+        std::vector<std::string> expected;
+        for (std::size_t offset = 0;; offset += 500) {
+            auto page = client.getAlbumList2("alphabeticalByName", "500",
+                                             std::to_string(offset));
+            REQUIRE(page.has_value());
+            for (auto const &album : page.value().album)
+                expected.push_back(album.id);
+            if (page.value().album.size() < 500)
+                break;
+        }
+
+        // pages ending before, at and after the end of the list
+        for (std::size_t page_size : {1, 2, 3, 500})
+            for (std::size_t prefetch : {0, 1, 4}) {
+                CAPTURE(page_size);
+                CAPTURE(prefetch);
+                uboat::AlbumPages albums(
+                    client, {.page_size = page_size, .prefetch = prefetch});
+                std::vector<std::string> ids;
+                for (const uboat::album::AlbumID3 &album : albums)
+                    ids.push_back(album.id);
+                CHECK_EQ(ids, expected);
+                CHECK_FALSE(albums.error());
+            }
+
+        SUBCASE("error") {
+            auto wrong = uboat::OSClient(TEST_SERVER, TEST_USERNAME, "wrong",
+                                         TEST_CLIENT_NAME);
+            uboat::AlbumPages albums(wrong);
+            CHECK_EQ(albums.begin(), albums.end());
+            REQUIRE(albums.error());
+            CHECK_EQ(albums.error()->code, 40);
+        }
     }
 
     TEST_CASE("getRandomSongs") {
@@ -62,6 +111,12 @@ TEST_SUITE("Album/Song Lists") {
         SUBCASE("get empty") {
             auto result = client.getNowPlaying();
             CHECK(result.has_value());
+
+            std::pmr::monotonic_buffer_resource arena;
+            auto pmrResult = client.getNowPlaying(&arena);
+            REQUIRE(pmrResult.has_value());
+            CHECK_EQ(pmrResult.value().entry.size(),
+                     result.value().entry.size());
         }
     }
 }
@@ -1,5 +1,7 @@
 #include "uboat/uboat.h"
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
@@ -59,6 +61,17 @@ TEST_SUITE("Playlists") {
             CHECK(updateResult.has_value());
             CHECK_EQ(updateResult.value().name, "updated");
             CHECK_EQ(updateResult.value().entry.size(), 4);
+
+            std::pmr::monotonic_buffer_resource arena;
+            auto pmrResult = client.getPlaylist(&arena, result.value().id);
+
+            REQUIRE(pmrResult.has_value());
+            CHECK_EQ(pmrResult.value().name, "updated");
+            REQUIRE_EQ(pmrResult.value().entry.size(), 4);
+            CHECK_EQ(std::string_view(pmrResult.value().entry.at(0).id),
+                     updateResult.value().entry.at(0).id);
+            CHECK_EQ(pmrResult.value().entry.get_allocator().resource(),
+                     &arena);
         }
 
         SUBCASE("get and deletePlaylist") {
@@ -67,10 +80,58 @@ TEST_SUITE("Playlists") {
 
             CHECK(getResult.has_value());
 
+            std::pmr::monotonic_buffer_resource arena;
+            auto pmrResult = client.getPlaylists(&arena);
+            REQUIRE(pmrResult.has_value());
+            REQUIRE_EQ(pmrResult.value().playlist.size(),
+                       getResult.value().playlist.size());
+            CHECK_EQ(std::string_view(pmrResult.value().playlist.at(0).id),
+                     getResult.value().playlist.at(0).id);
+
             auto playlistId = getResult.value().playlist.at(0).id;
 
             auto result = client.deletePlaylist(playlistId);
             CHECK(result.has_value());
         }
     }
+
+    TEST_CASE("Playlist of 10000 songs") {
+        // too long for a url, sent as a form once authenticate() found that
+        // the server takes them
+        REQUIRE(client.authenticate().has_value());
+        auto forms = [&](std::string_view endpoint) {
+            auto stats = client.request_stats();
+            auto it = stats.endpoints.find(endpoint);
+            return it == stats.endpoints.end() ? 0 : it->second.forms;
+        };
+        auto songResult = client.getRandomSongs("5");
+        REQUIRE(songResult.has_value());
+        REQUIRE_FALSE(songResult.value().song.empty());
+        auto &songs = songResult.value().song;
+
+        std::vector<std::string> ids;
+        for (std::size_t i = 0; i < 10000; ++i)
+            ids.emplace_back(songs.at(i % songs.size()).id);
+
+        auto result = client.createPlaylist("", "large", ids);
+        REQUIRE(result.has_value());
+        CHECK_EQ(result.value().songCount, 10000);
+        CHECK_EQ(result.value().entry.size(), 10000);
+        CHECK_EQ(forms("createPlaylist"), 1);
+
+        auto update = client
+                          .updatePlaylistAsync(result.value().id, "", "", "",
+                                               {ids.begin(), ids.end()})
+                          .get();
+        CHECK(update.has_value());
+        CHECK_EQ(forms("updatePlaylist"), 1);
+        // the short requests stay in the url
+        CHECK_EQ(forms("getRandomSongs"), 0);
+
+        auto getResult = client.getPlaylist(result.value().id);
+        REQUIRE(getResult.has_value());
+        CHECK_EQ(getResult.value().entry.size(), 20000);
+
+        CHECK(client.deletePlaylist(result.value().id).has_value());
+    }
 }
@@ -0,0 +1,47 @@
+#include "uboat/uboat.h"
+#include <map>
+#include <string>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "common.h"
+#include "request_query.h"
+
+using namespace uboat::detail;
+
+TEST_SUITE("Request query") {
+    TEST_CASE("values are percent-encoded") {
+        std::string out = "x=";
+        append_encoded(out, "a b&c=d/é~-_.");
+        CHECK_EQ(out, "x=a%20b%26c%3Dd%2F%C3%A9~-_.");
+    }
+
+    TEST_CASE("the auth params come first, in order") {
+        auto query = auth_query("karl", "0a1b", "s@lt", "my client");
+        CHECK_EQ(query, "u=karl&t=0a1b&s=s%40lt&v=" + uboat::API_VERSION +
+                            "&c=my%20client&f=json");
+    }
+
+    TEST_CASE("params without a value are left out") {
+        std::multimap<std::string, std::string> params{
+            {"type", "byGenre"}, {"genre", "Rock & Roll"}, {"fromYear", ""},
+            {"songId", "2"},     {"songId", ""},           {"songId", "1"}};
+        std::string out = "u=karl";
+        append_params(out, params);
+        CHECK_EQ(out, "u=karl&genre=Rock%20%26%20Roll&songId=2&songId=1"
+                      "&type=byGenre");
+
+        out.clear();
+        append_params(out, {{"comment", ""}, {"name", ""}, {"public", ""}},
+                      empty_param("updatePlaylist"));
+        CHECK_EQ(out, "");
+    }
+
+    TEST_CASE("search3 sends an empty query") {
+        // which returns everything
+        std::string out;
+        append_params(out, {{"query", ""}, {"artistOffset", ""}},
+                      empty_param("search3"));
+        CHECK_EQ(out, "&query=");
+    }
+}
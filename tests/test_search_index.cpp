@@ -0,0 +1,200 @@
+#include "uboat/crawler.h"
+#include "uboat/search_index.h"
+#include "uboat/uboat.h"
+#include <chrono>
+#include <string>
+#include <vector>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "common.h"
+#include "inverted_index.h"
+
+using uboat::detail::InvertedIndex;
+
+namespace {
+
+std::vector<std::uint32_t> search(const InvertedIndex &index,
+                                  std::string_view query) {
+    return index.search(query, 100);
+}
+
+uboat::Snapshot library() {
+    uboat::Snapshot snapshot{};
+    for (auto [id, name, sortName] :
+         {std::array{"ar1", "George Harrison", "Harrison, George"},
+          std::array{"ar2", "Bach", ""}}) {
+        uboat::artist::ArtistID3 artist{};
+        artist.id = id;
+        artist.name = name;
+        artist.sortName = sortName;
+        snapshot.artists.push_back(artist);
+    }
+    for (auto [id, name] : {std::array{"al1", "All Things Must Pass"},
+                            std::array{"al2", "Goldberg Variations"}}) {
+        uboat::album::AlbumID3WithSongs album{};
+        album.id = id;
+        album.name = name;
+        for (int track = 1; track <= 3; ++track) {
+            uboat::media::Child song{};
+            song.id = album.id + "s" + std::to_string(track);
+            song.title = album.name + " " + std::to_string(track);
+            album.song.push_back(song);
+        }
+        snapshot.albums.push_back(album);
+    }
+    snapshot.complete = true;
+    snapshot.lastModified = 1;
+    return snapshot;
+}
+
+} // namespace
+
+TEST_SUITE("InvertedIndex") {
+    TEST_CASE("tokens") {
+        CHECK_EQ(InvertedIndex::tokenize("Sgt. Pepper's Lonely-Hearts 2"),
+                 std::vector<std::string>{"sgt", "pepper", "s", "lonely",
+                                          "hearts", "2"});
+        CHECK_EQ(InvertedIndex::tokenize("Ëlo Ünder"),
+                 std::vector<std::string>{"Ëlo", "Ünder"});
+        CHECK(InvertedIndex::tokenize(" - ").empty());
+    }
+
+    TEST_CASE("token and prefix queries") {
+        InvertedIndex index;
+        index.add({"Let It Be"});
+        index.add({"Let It Bleed"});
+        index.add({"Abbey Road", "abbey road"});
+        index.build();
+
+        CHECK_EQ(search(index, "let it be"), std::vector<std::uint32_t>{0});
+        CHECK_EQ(search(index, "let it b"), std::vector<std::uint32_t>{0, 1});
+        CHECK_EQ(search(index, "BLE"), std::vector<std::uint32_t>{1});
+        CHECK_EQ(search(index, "road abb"), std::vector<std::uint32_t>{2});
+        CHECK(search(index, "let road").empty());
+        CHECK(search(index, "xyz").empty());
+        CHECK_EQ(search(index, ""), std::vector<std::uint32_t>{0, 1, 2});
+        CHECK_EQ(index.search("", 2), std::vector<std::uint32_t>{0, 1});
+    }
+
+    TEST_CASE("ranking") {
+        InvertedIndex index;
+        index.add({"The Bells of Rhymney"});
+        index.add({"Bell Bottom Blues"});
+        index.add({"Bell"});
+        index.build();
+
+        // whole tokens, then tokens starting a field, then shorter names
+        CHECK_EQ(search(index, "bell"), std::vector<std::uint32_t>{2, 1, 0});
+        CHECK_EQ(index.search("bell", 1), std::vector<std::uint32_t>{2});
+    }
+
+    TEST_CASE("documents added after a build") {
+        InvertedIndex index;
+        index.add({"Abbey Road"});
+        index.build();
+        index.add({"Abbey Lane"});
+        index.build();
+        CHECK_EQ(index.size(), 2);
+        CHECK_EQ(search(index, "abbey"), std::vector<std::uint32_t>{0, 1});
+        CHECK_EQ(search(index, "lane"), std::vector<std::uint32_t>{1});
+    }
+}
+
+TEST_SUITE("SearchIndex") {
+    TEST_CASE("search3 from the snapshot") {
+        uboat::SearchIndex index(library());
+
+        auto result = index.search3("harr");
+        REQUIRE_EQ(result.artist.size(), 1);
+        CHECK_EQ(result.artist[0].id, "ar1");
+        CHECK(result.album.empty());
+        CHECK(result.song.empty());
+
+        // the sort name is searched too
+        CHECK_EQ(index.search3("george").artist.size(), 1);
+
+        result = index.search3("goldberg var 2");
+        CHECK(result.album.empty());
+        REQUIRE_EQ(result.song.size(), 1);
+        CHECK_EQ(result.song[0].id, "al2s2");
+
+        result = index.search3("goldberg");
+        REQUIRE_EQ(result.album.size(), 1);
+        CHECK_EQ(result.album[0].id, "al2");
+        CHECK_EQ(result.song.size(), 3);
+    }
+
+    TEST_CASE("counts and offsets") {
+        uboat::SearchIndex index(library());
+
+        auto result = index.search3("", {.artistCount = 0,
+                                         .albumCount = 1,
+                                         .albumOffset = 1,
+                                         .songCount = 2,
+                                         .songOffset = 3});
+        CHECK(result.artist.empty());
+        REQUIRE_EQ(result.album.size(), 1);
+        CHECK_EQ(result.album[0].id, "al2");
+        REQUIRE_EQ(result.song.size(), 2);
+        CHECK_EQ(result.song[0].id, "al2s1");
+        CHECK_EQ(result.song[1].id, "al2s2");
+
+        CHECK(index.search3("goldberg", {.songOffset = 10}).song.empty());
+    }
+
+    TEST_CASE("answers well under a millisecond") {
+        auto snapshot = library();
+        auto album = snapshot.albums[0];
+        for (int i = 0; i < 2000; ++i) {
+            album.id = "bulk" + std::to_string(i);
+            album.name = "Album " + std::to_string(i);
+            for (auto &song : album.song)
+                song.title = "Song " + std::to_string(i);
+            snapshot.albums.push_back(album);
+        }
+        uboat::SearchIndex index(std::move(snapshot));
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 100; ++i)
+            index.search3("goldberg variat");
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        CHECK_LT(elapsed / 100, std::chrono::milliseconds(1));
+    }
+}
+
+TEST_SUITE("SearchIndex fallback") {
+    auto client = uboat::OSClient(TEST_SERVER, TEST_USERNAME, TEST_PASSWORD,
+                                  TEST_CLIENT_NAME);
+
+    TEST_CASE("auth successful") {
+        REQUIRE(client.authenticate().has_value());
+    }
+
+    TEST_CASE("an up to date snapshot answers") {
+        auto snapshot = uboat::Crawler(client).run();
+        REQUIRE(snapshot.has_value());
+        uboat::SearchIndex index(std::move(*snapshot));
+
+        auto result = index.search3(client, "cloud");
+        REQUIRE(result.has_value());
+        CHECK_FALSE(index.stale());
+        REQUIRE_EQ(result->album.size(), 1);
+        CHECK_EQ(result->album[0].id, "al2");
+        CHECK_EQ(result->song.size(), 4);
+    }
+
+    TEST_CASE("an out of date snapshot asks the server") {
+        auto snapshot = library();
+        uboat::SearchIndex index(std::move(snapshot));
+        CHECK_FALSE(index.stale());
+
+        // the local library has no "Cloud Nine"
+        CHECK(index.search3("cloud").album.empty());
+        auto result = index.search3(client, "cloud");
+        REQUIRE(result.has_value());
+        CHECK(index.stale());
+        REQUIRE_EQ(result->album.size(), 1);
+        CHECK_EQ(result->album[0].id, "al2");
+    }
+}
@@ -1,4 +1,7 @@
 #include "uboat/uboat.h"
+#include "uboat/search_cursor.h"
+#include <string>
+#include <vector>
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 
@@ -23,8 +26,13 @@ TEST_SUITE("Searching") {
 
     TEST_CASE("search3") {
         SUBCASE("search all") {
+            // the empty query is sent, the other empty params are not
             auto result = client.search3("");
-            CHECK(result.has_value());
+            REQUIRE(result.has_value());
+            CHECK_FALSE(result.value().song.empty());
+            auto async = client.search3Async("").get();
+            REQUIRE(async.has_value());
+            CHECK_EQ(async.value().song.size(), result.value().song.size());
         }
 
         SUBCASE("search all with count limit") {
@@ -38,4 +46,42 @@ TEST_SUITE("Searching") {
             CHECK(result.has_value());
         }
     }
+
+    TEST_CASE("SearchCursor") {
+        auto all = client.search3("", "100", "", "100", "", "100");
+        REQUIRE(all.has_value());
+
+        for (std::size_t page_size : {1, 5, 12, 20})
+            for (std::size_t prefetch : {0, 2}) {
+                CAPTURE(page_size);
+                CAPTURE(prefetch);
+                uboat::SearchCursor search(
+                    client, "", {.page_size = page_size, .prefetch = prefetch});
+
+                std::vector<std::string> songs;
+                for (const uboat::media::Child &song : search.songs())
+                    songs.push_back(song.id);
+                REQUIRE_EQ(songs.size(), all.value().song.size());
+                for (std::size_t i = 0; i < songs.size(); ++i)
+                    CHECK_EQ(songs[i], all.value().song[i].id);
+
+                // the other kinds start at their own first page
+                std::size_t albums = 0;
+                for (auto it = search.albums().begin();
+                     it != search.albums().end(); ++it)
+                    CHECK_EQ(it->id, all.value().album.at(albums++).id);
+                CHECK_EQ(albums, all.value().album.size());
+
+                auto artists = search.artists().begin();
+                REQUIRE_NE(artists, search.artists().end());
+                CHECK_EQ(artists->id, all.value().artist.at(0).id);
+                CHECK_FALSE(search.artists().error());
+            }
+
+        SUBCASE("no results") {
+            uboat::SearchCursor search(client, "no such thing");
+            CHECK_EQ(search.songs().begin(), search.songs().end());
+            CHECK_FALSE(search.songs().error());
+        }
+    }
 }
@@ -0,0 +1,74 @@
+#include "uboat/uboat.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "common.h"
+
+// Run under ThreadSanitizer with a build configured with UBOAT_ENABLE_TSAN,
+// see the threads label in CMakeLists.txt
+TEST_SUITE("Shared client") {
+    TEST_CASE("64 threads share one client") {
+        constexpr int THREADS = 64;
+        constexpr int ROUNDS = 16;
+
+        // the cache, the coalesced requests and a token per request are
+        // shared as well
+        uboat::ClientOptions options;
+        options.cache.max_bytes = 1 << 20;
+        options.token_lifetime = std::chrono::seconds(0);
+        auto client = uboat::OSClient(TEST_SERVER, TEST_USERNAME,
+                                      TEST_PASSWORD, TEST_CLIENT_NAME, options);
+        REQUIRE(client.authenticate().has_value());
+
+        std::atomic<int> failures = 0;
+        auto expect = [&](bool ok) {
+            if (!ok)
+                ++failures;
+        };
+
+        std::vector<std::jthread> threads;
+        for (int t = 0; t < THREADS; ++t)
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < ROUNDS; ++i) {
+                    switch ((t + i) % 8) {
+                    case 0:
+                        expect(client.getAlbum("al1").has_value());
+                        break;
+                    case 1:
+                        expect(client.getArtists().has_value());
+                        break;
+                    case 2:
+                        expect(client.search3("cloud").has_value());
+                        break;
+                    case 3:
+                        expect(client.getAlbumView("al2").has_value());
+                        break;
+                    case 4:
+                        expect(client.getAlbumAsync("al3").get().has_value());
+                        break;
+                    case 5:
+                        expect(client.star("al1s1").has_value());
+                        expect(client.unstar("al1s1").has_value());
+                        break;
+                    case 6:
+                        expect(client.getRandomSongsTable("5").has_value());
+                        break;
+                    case 7:
+                        // while the other threads read the credentials
+                        expect(client.authenticate().has_value());
+                        break;
+                    }
+                }
+            });
+        threads.clear();
+
+        CHECK_EQ(failures.load(), 0);
+        auto album = client.getAlbum("al1");
+        REQUIRE(album.has_value());
+        CHECK_EQ(album.value().song.size(), 4);
+    }
+}
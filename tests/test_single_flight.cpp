@@ -0,0 +1,143 @@
+#include "uboat/uboat.h"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <latch>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "common.h"
+#include "single_flight.h"
+
+using uboat::detail::SingleFlight;
+
+TEST_SUITE("SingleFlight") {
+    TEST_CASE("identical calls in flight share one result") {
+        SingleFlight flights;
+        std::atomic<int> calls = 0;
+        std::promise<void> release;
+        auto released = release.get_future().share();
+
+        auto leader = std::async(std::launch::async, [&] {
+            return flights.run<std::string>("a", [&] {
+                ++calls;
+                released.wait();
+                return std::string("A");
+            });
+        });
+        while (calls == 0)
+            std::this_thread::yield();
+
+        std::vector<std::future<std::string>> followers;
+        for (int i = 0; i < 4; ++i)
+            followers.push_back(std::async(std::launch::async, [&] {
+                return flights.run<std::string>("a", [&] {
+                    ++calls;
+                    return std::string("B");
+                });
+            }));
+        // another key is not held up
+        CHECK_EQ(flights.run<std::string>("b", [] { return std::string("C"); }),
+                 "C");
+        while (flights.coalesced() < 4)
+            std::this_thread::yield();
+        release.set_value();
+
+        CHECK_EQ(leader.get(), "A");
+        for (auto &f : followers)
+            CHECK_EQ(f.get(), "A");
+        CHECK_EQ(calls, 1);
+        CHECK_EQ(flights.coalesced(), 4);
+
+        // the flight is over, the next call is made again
+        CHECK_EQ(flights.run<std::string>("a", [] { return std::string("D"); }),
+                 "D");
+    }
+
+    TEST_CASE("exceptions reach every caller") {
+        SingleFlight flights;
+        std::promise<void> release;
+        auto released = release.get_future().share();
+        std::atomic<bool> started = false;
+
+        auto leader = std::async(std::launch::async, [&] {
+            return flights.run<int>("a", [&]() -> int {
+                started = true;
+                released.wait();
+                throw std::runtime_error("failed");
+            });
+        });
+        while (!started)
+            std::this_thread::yield();
+        auto follower = std::async(std::launch::async, [&] {
+            return flights.run<int>("a", [] { return 1; });
+        });
+        while (flights.coalesced() < 1)
+            std::this_thread::yield();
+        release.set_value();
+
+        CHECK_THROWS_AS(leader.get(), std::runtime_error);
+        CHECK_THROWS_AS(follower.get(), std::runtime_error);
+        CHECK_EQ(flights.run<int>("a", [] { return 2; }), 2);
+    }
+}
+
+TEST_SUITE("OSClient request coalescing") {
+    TEST_CASE("concurrent identical requests") {
+        auto client = uboat::OSClient(TEST_SERVER, TEST_USERNAME,
+                                      TEST_PASSWORD, TEST_CLIENT_NAME);
+        REQUIRE(client.authenticate().has_value());
+        auto list = client.getAlbumList2("random");
+        REQUIRE(list.has_value());
+        auto id = list->album.at(0).id;
+
+        // the threads are released at once, until some of their requests
+        // overlap
+        constexpr int THREADS = 16;
+        auto songs = client.getAlbum(id)->song.size();
+        for (int round = 0;
+             round < 50 && client.request_stats().coalesced == 0; ++round) {
+            std::latch start(THREADS);
+            std::vector<std::future<std::size_t>> results;
+            for (int i = 0; i < THREADS; ++i)
+                results.push_back(std::async(std::launch::async, [&] {
+                    start.arrive_and_wait();
+                    auto album = client.getAlbum(id);
+                    return album ? album->song.size() : 0;
+                }));
+            for (auto &r : results)
+                CHECK_EQ(r.get(), songs);
+        }
+        CHECK_GT(client.request_stats().coalesced, 0);
+
+        // every caller of a random list gets its own
+        auto coalesced = client.request_stats().coalesced;
+        {
+            std::latch start(4);
+            std::vector<std::future<bool>> lists;
+            for (int i = 0; i < 4; ++i)
+                lists.push_back(std::async(std::launch::async, [&] {
+                    start.arrive_and_wait();
+                    return client.getAlbumList2("random").has_value();
+                }));
+            for (auto &l : lists)
+                CHECK(l.get());
+        }
+        CHECK_EQ(client.request_stats().coalesced, coalesced);
+
+        // every call of a write request is sent
+        std::vector<std::future<bool>> stars;
+        for (int i = 0; i < 4; ++i)
+            stars.push_back(std::async(std::launch::async, [&] {
+                return client.star("", id).has_value();
+            }));
+        for (auto &s : stars)
+            CHECK(s.get());
+        CHECK_EQ(client.request_stats().coalesced, coalesced);
+        CHECK(client.unstar("", id).has_value());
+    }
+}
@@ -0,0 +1,157 @@
+#include "uboat/song_table.h"
+#include "uboat/uboat.h"
+#include <string>
+#include <vector>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "common.h"
+#include "json_reader.h"
+
+using uboat::SongTable;
+
+namespace {
+
+uboat::media::Child song(const std::string &id, const std::string &genre,
+                         std::size_t year, std::size_t duration,
+                         std::size_t playCount) {
+    uboat::media::Child c{};
+    c.id = id;
+    c.title = "Song " + id;
+    c.genre = genre;
+    c.year = year;
+    c.duration = duration;
+    c.playCount = playCount;
+    c.suffix = "flac";
+    return c;
+}
+
+} // namespace
+
+TEST_SUITE("SongTable") {
+    TEST_CASE("rows") {
+        SongTable table;
+        table.append(song("s1", "Rock", 2002, 245, 3));
+        table.append(song("s2", "Jazz", 1959, 562, 10));
+        table.append(song("s3", "Rock", 1969, 180, 3));
+
+        REQUIRE_EQ(table.size(), 3);
+        CHECK_EQ(table.id()[1], "s2");
+        CHECK_EQ(table.title()[2], "Song s3");
+        CHECK_EQ(table.genre()[2], "Rock");
+        CHECK_EQ(table.year()[0], 2002);
+
+        // one dictionary entry per distinct value, and ""
+        CHECK_EQ(table.genre().distinct(), 3);
+        CHECK_EQ(table.suffix().distinct(), 2);
+        CHECK_EQ(table.genre().codes()[0], table.genre().codes()[2]);
+
+        auto c = table.row(1);
+        CHECK_EQ(c.id, "s2");
+        CHECK_EQ(c.genre, "Jazz");
+        CHECK_EQ(c.duration, 562);
+        CHECK_EQ(c.album, "");
+    }
+
+    TEST_CASE("queries") {
+        SongTable table;
+        table.append(song("s1", "Rock", 2002, 245, 3));
+        table.append(song("s2", "Jazz", 1959, 562, 10));
+        table.append(song("s3", "Rock", 1969, 180, 3));
+        table.append(song("s4", "Pop", 1985, 200, 7));
+
+        CHECK_EQ(table.totalDuration(), 1187);
+        CHECK_EQ(table.filterByYear(1960, 1990),
+                 std::vector<SongTable::Row>{2, 3});
+        CHECK_EQ(table.filterByGenre("Rock"),
+                 std::vector<SongTable::Row>{0, 2});
+        CHECK(table.filterByGenre("Blues").empty());
+        CHECK_EQ(table.sortByPlayCount(),
+                 std::vector<SongTable::Row>{1, 3, 0, 2});
+        CHECK(SongTable().filterByYear(0, 3000).empty());
+    }
+
+    TEST_CASE("append table") {
+        SongTable a, b;
+        a.append(song("s1", "Rock", 2002, 245, 3));
+        b.append(song("s2", "Jazz", 1959, 562, 10));
+        b.append(song("s3", "Rock", 1969, 180, 3));
+
+        a.append(b);
+        REQUIRE_EQ(a.size(), 3);
+        CHECK_EQ(a.id()[2], "s3");
+        CHECK_EQ(a.genre()[1], "Jazz");
+        CHECK_EQ(a.genre().codes()[0], a.genre().codes()[2]);
+        CHECK_EQ(a.genre().distinct(), 3);
+
+        auto copy = a;
+        a.clear();
+        CHECK(a.empty());
+        CHECK_EQ(copy.genre()[2], "Rock");
+    }
+
+    TEST_CASE("read from a response") {
+        std::string body = R"({"subsonic-response": {"status": "ok",
+            "version": "1.16.1", "type": "navidrome",
+            "serverVersion": "0.53.0", "openSubsonic": true,
+            "playlist": {"id": "pl1", "name": "p", "entry": [
+                {"id": "s1", "isDir": false, "title": "Any Road",
+                 "genre": "Rock", "year": 2002, "duration": 245,
+                 "genres": [{"name": "Rock"}], "replayGain": {}},
+                {"id": "s2", "title": "Marwa Blues", "genre": "Rock",
+                 "playCount": 4, "path": "a/b.flac"}]}}})";
+
+        auto result = uboat::detail::read_response<
+            uboat::detail::SongTableData>(body, "playlist");
+        REQUIRE(result.has_value());
+
+        auto &table = result->data.songs;
+        REQUIRE_EQ(table.size(), 2);
+        CHECK_EQ(table.title()[0], "Any Road");
+        CHECK_EQ(table.path()[0], "");
+        CHECK_EQ(table.path()[1], "a/b.flac");
+        CHECK_EQ(table.year()[0], 2002);
+        CHECK_EQ(table.year()[1], 0);
+        CHECK_EQ(table.playCount()[1], 4);
+        CHECK_EQ(table.filterByGenre("Rock").size(), 2);
+    }
+
+    auto client = uboat::OSClient(TEST_SERVER, TEST_USERNAME, TEST_PASSWORD,
+                                  TEST_CLIENT_NAME);
+
+    TEST_CASE("endpoints") {
+        REQUIRE(client.authenticate().has_value());
+
+        SUBCASE("getRandomSongsTable") {
+            auto songs = client.getRandomSongs("5");
+            auto table = client.getRandomSongsTable("5");
+            REQUIRE(songs.has_value());
+            REQUIRE(table.has_value());
+            CHECK_EQ(table.value().size(), songs.value().song.size());
+        }
+
+        SUBCASE("getAlbumTable") {
+            auto albums = client.getAlbumList2("random");
+            REQUIRE(albums.has_value());
+            auto &album = albums.value().album.at(0);
+
+            auto owned = client.getAlbum(album.id);
+            auto table = client.getAlbumTable(album.id);
+            REQUIRE(owned.has_value());
+            REQUIRE(table.has_value());
+            REQUIRE_EQ(table.value().size(), album.songCount);
+            CHECK_EQ(table.value().id()[0], owned.value().song.at(0).id);
+            CHECK_EQ(table.value().album()[0], owned.value().song.at(0).album);
+
+            auto wrong = client.getAlbumTable("wrong");
+            CHECK_FALSE(wrong.has_value());
+            CHECK_EQ(wrong.error().code, 70);
+        }
+
+        SUBCASE("search3Table") {
+            auto table = client.search3Table("");
+            REQUIRE(table.has_value());
+            CHECK_GT(table.value().size(), 0);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#include "uboat/symbol.h"
+#include "uboat/uboat.h"
+#include <string>
+#include <thread>
+#include <vector>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+using uboat::Symbol;
+
+TEST_SUITE("Symbol") {
+    TEST_CASE("interning") {
+        Symbol a("Progressive Rock");
+        Symbol b(std::string("Progressive ") + "Rock");
+        Symbol c("Rock");
+
+        CHECK_EQ(a, b);
+        CHECK_EQ(a.c_str(), b.c_str());
+        CHECK_NE(a, c);
+        CHECK_EQ(a, "Progressive Rock");
+        CHECK_EQ(a.str(), "Progressive Rock");
+        CHECK_LT(a, c);
+
+        Symbol empty;
+        CHECK(empty.empty());
+        CHECK_EQ(empty, Symbol(""));
+        CHECK_EQ(empty, "");
+
+        empty = c;
+        CHECK_EQ(empty, c);
+        empty = "Jazz";
+        CHECK_EQ(std::string(empty), "Jazz");
+    }
+
+    TEST_CASE("models") {
+        auto j = nlohmann::json::parse(
+            R"([{"id": "s1", "isDir": false, "title": "A", "genre": "Rock",
+                 "suffix": "flac", "genres": [{"name": "Rock"}]},
+                {"id": "s2", "isDir": false, "title": "B", "genre": "Rock",
+                 "suffix": "flac", "genres": [{"name": "Rock"}]}])");
+        auto songs = j.get<std::vector<uboat::media::Child>>();
+        CHECK_EQ(songs[0].genre, "Rock");
+        CHECK_EQ(songs[0].genre.data(), songs[1].genre.data());
+        CHECK_EQ(songs[0].genres[0].name.data(), songs[1].genre.data());
+        CHECK_EQ(songs[0].suffix.data(), songs[1].suffix.data());
+    }
+
+    TEST_CASE("threads") {
+        std::vector<std::vector<Symbol>> symbols(8);
+        std::vector<std::thread> threads;
+        for (auto &s : symbols)
+            threads.emplace_back([&s] {
+                for (int i = 0; i < 2000; ++i)
+                    s.emplace_back("symbol " + std::to_string(i % 500));
+            });
+        for (auto &t : threads)
+            t.join();
+
+        for (auto &s : symbols)
+            for (std::size_t i = 0; i < s.size(); ++i)
+                CHECK_EQ(s[i].c_str(), symbols[0][i].c_str());
+        CHECK_GE(uboat::symbol_stats().count, 500);
+    }
+}
@@ -1,4 +1,5 @@
 #include "uboat/uboat.h"
+#include <algorithm>
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 
@@ -23,6 +24,20 @@ TEST_SUITE("System") {
         }
     }
 
+    TEST_CASE("get OpenSubsonic extensions") {
+        auto result = client.getOpenSubsonicExtensions();
+        REQUIRE(result.has_value());
+        using uboat::server::OpenSubsonicExtension;
+        auto formPost = std::ranges::find(result.value(), "formPost",
+                                          &OpenSubsonicExtension::name);
+        REQUIRE(formPost != result.value().end());
+        CHECK_FALSE(formPost->versions.empty());
+
+        auto async = client.getOpenSubsonicExtensionsAsync().get();
+        REQUIRE(async.has_value());
+        CHECK_EQ(async.value().size(), result.value().size());
+    }
+
     TEST_CASE("server not found") {
         auto client_wrong = uboat::OSClient("127.0.0.666", TEST_USERNAME,
                                             TEST_PASSWORD, TEST_CLIENT_NAME);
@@ -49,4 +64,16 @@ TEST_SUITE("System") {
         CHECK_FALSE(result.has_value());
         CHECK_EQ(result.error().code, 40);
     }
+
+    TEST_CASE("connection reuse") {
+        auto pooled = uboat::OSClient(TEST_SERVER, TEST_USERNAME,
+                                      TEST_PASSWORD, TEST_CLIENT_NAME, {2});
+        for (int i = 0; i < 5; ++i)
+            REQUIRE(pooled.ping().has_value());
+
+        auto stats = pooled.pool_stats();
+        CHECK_EQ(stats.opened, 1);
+        CHECK_EQ(stats.reused, 4);
+        CHECK_EQ(stats.idle, 1);
+    }
 }